@@ -0,0 +1,300 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+
+#include "PacketInfo.hpp"
+#include "PcapngWriter.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The statistics of the capture written with CaptureWriter.
+ */
+struct CaptureStats final {
+    std::string fn;
+    uint64_t packets;
+    uint64_t bytes;
+    unsigned files;
+    // The packets which did not fit in the capture rings
+    uint64_t dropped;
+    // The reason why the writing has stopped or empty
+    std::string error;
+};
+
+/*!
+ * \brief A single producer single consumer ring, through which a receive
+ * thread passes the accepted packets to the capture writer thread.
+ *
+ * A packet is stored as a Record followed by the captured bytes padded
+ * to a multiple of 8 bytes, and never wraps around the end of the ring.
+ * If there is not enough room left at the end of the ring, the producer
+ * marks the rest of it as skipped and stores the packet at the start,
+ * whereas the rest which is too short for a record is always skipped. If
+ * the ring is full, the packet is dropped rather than waiting for the
+ * writer, so the capture never slows down the receive.
+ */
+class CaptureRing final {
+public:
+    struct Record final {
+        uint64_t timestamp;
+        unsigned ifIndex;
+        unsigned capLen;
+        unsigned origLen;
+        // The length of the headers prepended to the received packet
+        unsigned hdrLen;
+    };
+
+    static_assert(sizeof(Record) % 8 == 0);
+
+    explicit CaptureRing(std::size_t size, unsigned snaplen)
+    : buf_(size), snaplen_{snaplen}, head_{0}, tail_{0}
+    , cachedTail_{0}, dropped_{0} {}
+
+    /*!
+     * \brief Copies the packet \p pktInfo into the ring, along with its
+     * IPv4 and UDP headers if it has been received on a UDP socket,
+     * which only receives the payload.
+     *
+     * @return false if the ring is full and the packet is dropped
+     */
+    bool push(PacketInfo const& pktInfo) {
+        auto hdrLen = capturedHeadersLen(pktInfo);
+        auto origLen = hdrLen + pktInfo.receivedSize;
+        auto capLen = std::min(origLen, snaplen_);
+        auto need = sizeof(Record) + pad(capLen);
+
+        auto head = head_.load(std::memory_order_relaxed);
+        auto off = head % buf_.size();
+        auto skip = off + need > buf_.size() ? buf_.size() - off : 0;
+        if (head + skip + need - cachedTail_ > buf_.size()) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (PIMC_UNLIKELY(head + skip + need - cachedTail_ > buf_.size())) {
+                ++dropped_;
+                return false;
+            }
+        }
+
+        if (skip > 0) {
+            if (skip >= sizeof(Record)) {
+                Record r{.timestamp = 0, .ifIndex = 0, .capLen = Skipped,
+                         .origLen = 0, .hdrLen = 0};
+                memcpy(&buf_[off], &r, sizeof(r));
+            }
+            off = 0;
+        }
+
+        Record r{.timestamp = pktInfo.timestamp, .ifIndex = pktInfo.ifIndex,
+                 .capLen = capLen, .origLen = origLen, .hdrLen = hdrLen};
+        memcpy(&buf_[off], &r, sizeof(r));
+        copyCaptured(&buf_[off + sizeof(r)], pktInfo, hdrLen, capLen);
+
+        head_.store(head + skip + need, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+     * \brief Passes each record in the ring along with its captured bytes
+     * to \p f and releases them.
+     *
+     * @return true if the ring was not empty
+     */
+    template <typename F>
+    bool drain(F&& f) {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        auto head = head_.load(std::memory_order_acquire);
+        if (tail == head) return false;
+
+        while (tail != head) {
+            auto off = tail % buf_.size();
+            if (buf_.size() - off < sizeof(Record)) {
+                tail += buf_.size() - off;
+                continue;
+            }
+
+            Record r;
+            memcpy(&r, &buf_[off], sizeof(r));
+            if (r.capLen == Skipped) {
+                tail += buf_.size() - off;
+                continue;
+            }
+
+            f(r, &buf_[off + sizeof(r)]);
+            tail += sizeof(r) + pad(r.capLen);
+        }
+        tail_.store(tail, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+     * @return the number of the packets which did not fit in the ring,
+     * which may only be read once the producer has stopped
+     */
+    [[nodiscard]]
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    static constexpr unsigned Skipped{0xffffffff};
+
+    static constexpr std::size_t pad(std::size_t len) { return (len + 7u) & ~std::size_t{7}; }
+
+private:
+    std::vector<uint8_t> buf_;
+    unsigned snaplen_;
+    // The producer and the consumer positions grow monotonically, so
+    // the ring is empty if they are equal
+    alignas(64) std::atomic<uint64_t> head_;
+    alignas(64) std::atomic<uint64_t> tail_;
+    // The consumer position last seen by the producer
+    alignas(64) uint64_t cachedTail_;
+    uint64_t dropped_;
+};
+
+/*!
+ * \brief Writes the packets accepted by the receive threads to a pcapng
+ * file in a background thread.
+ *
+ * Each receive thread passes its packets through its own CaptureRing,
+ * which the writer thread drains into the file with PcapngWriter. If the
+ * rotation size is set, the writer moves on to the next file once the
+ * current one reaches it.
+ */
+class CaptureWriter final {
+public:
+    /*!
+     * @param fn the name of the capture file
+     * @param rings the number of the rings, one per receive thread
+     * @param snaplen the maximum number of the captured bytes per packet
+     * @param rotate the size of the capture files in bytes or 0 if the
+     * capture is written to a single file
+     */
+    CaptureWriter(std::string fn, unsigned rings, unsigned snaplen, uint64_t rotate)
+    : fn_{std::move(fn)}, rotate_{rotate}, file_{snaplen}
+    , stats_{.fn = fn_, .packets = 0, .bytes = 0, .files = 0,
+             .dropped = 0, .error = {}}
+    , done_{false} {
+        for (unsigned i = 0; i < rings; ++i)
+            rings_.push_back(std::make_unique<CaptureRing>(RingSize, snaplen));
+
+        openFile();
+
+        // The termination signals are delivered to the receive threads
+        sigset_t mask, oldMask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigaddset(&mask, SIGHUP);
+        sigaddset(&mask, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &mask, &oldMask);
+        writer_ = std::thread{[this] { writeLoop(); }};
+        pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+    }
+
+    CaptureWriter(CaptureWriter const&) = delete;
+    CaptureWriter(CaptureWriter&&) = delete;
+    CaptureWriter& operator= (CaptureWriter const&) = delete;
+    CaptureWriter& operator= (CaptureWriter&&) = delete;
+
+    ~CaptureWriter() { stop(); }
+
+    /*!
+     * @return the ring of the receive thread \p i
+     */
+    [[nodiscard]]
+    CaptureRing& ring(unsigned i) { return *rings_[i]; }
+
+    /*!
+     * \brief Writes the packets left in the rings, closes the capture file
+     * and stops the writer thread. Must be called once the receive threads
+     * have stopped.
+     */
+    void stop() {
+        if (not writer_.joinable()) return;
+
+        done_.store(true, std::memory_order_release);
+        writer_.join();
+        for (auto const& ring: rings_)
+            stats_.dropped += ring->dropped();
+    }
+
+    /*!
+     * @return the statistics of the capture, which may only be read once
+     * the writer has stopped
+     */
+    [[nodiscard]]
+    CaptureStats const& stats() const { return stats_; }
+
+private:
+    void writeLoop() {
+        for (;;) {
+            // The rings are drained once more after the receive stops
+            bool done = done_.load(std::memory_order_acquire);
+            bool drained{false};
+            for (auto& ring: rings_)
+                drained |= ring->drain([this] (auto const& r, uint8_t const* data) {
+                    // Once the writing has failed the packets are dropped
+                    if (PIMC_LIKELY(stats_.error.empty()))
+                        guarded([&] { writePacket(r, data); });
+                    else ++stats_.dropped;
+                });
+
+            if (done) break;
+            if (not drained)
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+
+        if (stats_.error.empty())
+            guarded([this] { file_.close(); });
+        stats_.bytes = file_.written();
+    }
+
+    template <typename F>
+    void guarded(F&& f) {
+        try {
+            f();
+        } catch (std::runtime_error const& ex) {
+            stats_.error = ex.what();
+        }
+    }
+
+    void writePacket(CaptureRing::Record const& r, uint8_t const* data) {
+        if (rotate_ > 0 and file_.packets() > 0 and
+            file_.size() + PcapngWriter::blockSize(r.capLen) > rotate_) {
+            file_.close();
+            openFile();
+        }
+
+        file_.writePacket(r.timestamp, r.ifIndex, data, r.capLen, r.origLen);
+        ++stats_.packets;
+    }
+
+    void openFile() {
+        file_.open(numberedFileName(fn_, stats_.files));
+        ++stats_.files;
+    }
+
+private:
+    static constexpr std::size_t RingSize{16u << 20u};
+
+    std::string fn_;
+    uint64_t rotate_;
+    PcapngWriter file_;
+    std::vector<std::unique_ptr<CaptureRing>> rings_;
+    CaptureStats stats_;
+    std::atomic<bool> done_;
+    std::thread writer_;
+};
+
+} // namespace pimc
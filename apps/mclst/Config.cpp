@@ -1,6 +1,10 @@
 #include <unistd.h>
+#include <sched.h>
 #include <tuple>
 #include <string>
+#include <fstream>
+#include <iterator>
+#include <map>
 #include <string_view>
 #include <algorithm>
 
@@ -8,6 +12,7 @@
 #include "pimc/net/IPv4Address.hpp"
 #include "pimc/parsers/NumberParsers.hpp"
 #include "pimc/parsers/IPv4Parsers.hpp"
+#include "pimc/packets/Crc32c.hpp"
 #include "pimc/formatters/MemoryBuffer.hpp"
 #include "pimc/formatters/IPv4Formatters.hpp"
 #include "pimc/formatters/IntfTableFormatter.hpp"
@@ -35,26 +40,79 @@ enum class Options: uint32_t {
     NoColors = 8,
     ShowConfig = 9,
     ShowVersion = 10,
+    Batch = 11,
+    Timestamps = 12,
+    GroupsFile = 13,
+    Threads = 14,
+    Cpus = 15,
+    Ring = 16,
+    DPorts = 17,
+    IOUring = 18,
+    BusyPoll = 19,
+    Gro = 20,
+    Xdp = 21,
+    Zap = 22,
+    JoinRate = 23,
+    LineB = 24,
+    SeqField = 25,
+    RcvBuf = 26,
+    Reflect = 27,
+    Rtt = 28,
+    Pcap = 29,
+    SeqMagic = 30,
+    Fill = 31,
+    DumpCorrupt = 32,
+    Silence = 33,
+    Output = 34,
+    Fifo = 35,
+    Mlock = 36,
+    HugePages = 37,
+    Write = 38,
+    Snaplen = 39,
+    Rotate = 40,
+    Record = 41,
+    RecordDepth = 42,
+    RecordAfter = 43,
 };
 
 char const* header =
-    "[Options] group[:port]\n\n"
+    "[Options] group[:port][@source] ...\n\n"
     "where group[:port] may be specified either as 'group:port', e.g. 239.1.2.3:12345\n"
     "or just as a group, e.g. 239.1.2.3, which implies receiving multicast traffic\n"
-    "destined for all UDP ports";
+    "destined for all UDP ports. The optional '@source' suffix, e.g.\n"
+    "239.1.2.3:12345@10.1.2.3, makes the subscription source specific, and a comma\n"
+    "separated list of sources, e.g. 239.1.2.3:12345@10.1.2.3,10.1.2.4, subscribes\n"
+    "to each of them. The receiver accepts multiple subscriptions, which may also be\n"
+    "loaded from a file";
+
+auto parseSourceAddr(std::string_view ss) -> IPv4Address {
+    auto s = parseIPv4Address(ss);
+    if (not s)
+        raise<CommandLineError>("invalid source address '{}'", ss);
+
+    if (s->isMcast())
+        raise<CommandLineError>("source address may not be multicast ({})", *s);
+
+    if (s->isDefault())
+        raise<CommandLineError>("source address may not be default ({})", *s);
+
+    if (s->isLocalBroadcast())
+        raise<CommandLineError>("source address may not be broadcast ({})", *s);
+
+    return *s;
+}
 
 auto parseGroupPort(
-        std::string const& gp) -> std::tuple<IPv4Address, uint16_t, bool> {
+        std::string_view gp) -> std::tuple<IPv4Address, uint16_t, bool> {
     auto cpos = gp.find(':');
 
     if (cpos != std::string::npos) {
         // Group port version
-        auto sv = std::string_view(gp);
-        auto grpsv = sv.substr(0, cpos);
+        auto grpsv = gp.substr(0, cpos);
         auto grp = parseIPv4Address(grpsv);
         if (not grp)
             raise<CommandLineError>("invalid multicast group '{}'", grpsv);
-        auto portsv = sv.substr(cpos+1);
+        auto portsv = gp.substr(cpos+1);
         auto dport = parseDecimalUInt16(portsv);
         if (not dport)
             raise<CommandLineError>("invalid destination UDP port '{}'", portsv);
@@ -71,25 +129,156 @@ auto parseGroupPort(
     return std::make_tuple(*grp, 0, true);
 }
 
-auto parseSourceOfG(
-        std::vector<std::string> const& sofg) -> IPv4Address {
-    if (sofg.empty()) return IPv4Address{};
+/*!
+ * Parses the comma separated list of the sources 'source[,source...]',
+ * returning the sources sorted and without duplicates.
+ */
+auto parseSources(std::string_view ss) -> std::vector<IPv4Address> {
+    std::vector<IPv4Address> sources;
+    while (true) {
+        auto cpos = ss.find(',');
+        sources.push_back(parseSourceAddr(ss.substr(0, cpos)));
+        if (cpos == std::string_view::npos) break;
+        ss = ss.substr(cpos + 1);
+    }
 
-    auto const& ss = sofg[0];
-    auto s = parseIPv4Address(ss);
-    if (not s)
-        raise<CommandLineError>("invalid source address '{}'", ss);
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+    return sources;
+}
 
-    if (s->isMcast())
-        raise<CommandLineError>("source address may not be multicast ({})", *s);
+/*!
+ * Parses the subscription 'group[:port][@source[,source...]]'. If the
+ * sources are not specified in the subscription, the default source is
+ * used.
+ */
+auto parseSubscription(
+        std::string_view spec,
+        IPv4Address defaultSource) -> std::tuple<Subscription, bool> {
+    auto apos = spec.find('@');
+    std::vector<IPv4Address> sources;
+    if (apos != std::string_view::npos) {
+        sources = parseSources(spec.substr(apos+1));
+        spec = spec.substr(0, apos);
+    } else if (not defaultSource.isDefault())
+        sources.push_back(defaultSource);
 
-    if (s->isDefault())
-        raise<CommandLineError>("source address may not be default ({})", *s);
+    IPv4Address group;
+    uint16_t dport;
+    bool wildcard;
+    std::tie(group, dport, wildcard) = parseGroupPort(spec);
 
-    if (s->isLocalBroadcast())
-        raise<CommandLineError>("source address may not be broadcast ({})", *s);
+    return std::make_tuple(
+            Subscription{.group = group, .dport = dport, .sources = std::move(sources)},
+            wildcard);
+}
 
-    return *s;
+/*!
+ * Loads subscriptions from the file, one per line. Empty lines and
+ * everything following '#' are ignored.
+ */
+void loadSubscriptions(
+        std::string const& fn, IPv4Address defaultSource,
+        std::vector<std::tuple<Subscription, bool>>& subs) {
+    std::ifstream ifs{fn};
+    if (not ifs)
+        raise<CommandLineError>("unable to open groups file '{}'", fn);
+
+    std::string line;
+    unsigned lineNo{0};
+    while (std::getline(ifs, line)) {
+        ++lineNo;
+        std::string_view lsv{line};
+        auto hpos = lsv.find('#');
+        if (hpos != std::string_view::npos)
+            lsv = lsv.substr(0, hpos);
+
+        auto first = lsv.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) continue;
+        auto last = lsv.find_last_not_of(" \t\r");
+        lsv = lsv.substr(first, last - first + 1);
+
+        try {
+            subs.push_back(parseSubscription(lsv, defaultSource));
+        } catch (CommandLineError const& ex) {
+            raise<CommandLineError>("{}:{}: {}", fn, lineNo, ex.what());
+        }
+    }
+}
+
+/*!
+ * Merges the subscriptions to the same group and destination port, which
+ * are all source specific, into one subscription to the union of their
+ * sources.
+ */
+auto mergeSubscriptions(
+        std::vector<std::tuple<Subscription, bool>>& parsedSubs,
+        bool wildcard) -> std::vector<Subscription> {
+    std::vector<Subscription> subscriptions;
+    subscriptions.reserve(parsedSubs.size());
+    std::map<std::tuple<IPv4Address, uint16_t>, std::size_t> seen;
+    for (auto& [sub, subWildcard]: parsedSubs) {
+        if (subWildcard != wildcard)
+            raise<CommandLineError>(
+                    "portless subscriptions may not be mixed with the "
+                    "subscriptions which specify the destination port");
+
+        auto [it, added] = seen.emplace(
+                std::make_tuple(sub.group, sub.dport), subscriptions.size());
+        if (added) {
+            subscriptions.push_back(std::move(sub));
+            continue;
+        }
+
+        auto& sources = subscriptions[it->second].sources;
+        if (sources.empty() or sub.sources.empty()) {
+            if (wildcard)
+                raise<CommandLineError>("duplicate subscription {}", sub.group);
+            raise<CommandLineError>(
+                    "duplicate subscription {}:{}", sub.group, sub.dport);
+        }
+
+        std::vector<IPv4Address> merged;
+        merged.reserve(sources.size() + sub.sources.size());
+        std::set_union(
+                sources.begin(), sources.end(),
+                sub.sources.begin(), sub.sources.end(),
+                std::back_inserter(merged));
+        sources = std::move(merged);
+    }
+
+    return subscriptions;
+}
+
+auto parseDPorts(
+        std::vector<std::string> const& dps, bool wildcard) -> PortRange {
+    if (dps.empty()) return PortRange{.first = 1, .last = 65535};
+
+    if (not wildcard)
+        raise<CommandLineError>(
+                "the option --dports may only be specified with "
+                "the portless subscriptions");
+
+    auto const& dpSpec = dps[0];
+    std::string_view sv{dpSpec};
+    auto dpos = sv.find('-');
+    auto firstsv = sv.substr(0, dpos);
+    auto lastsv = dpos == std::string_view::npos ? firstsv : sv.substr(dpos + 1);
+
+    auto first = parseDecimalUInt16(firstsv);
+    auto last = parseDecimalUInt16(lastsv);
+    if (not first or not last or *first == 0u or *first > *last)
+        raise<CommandLineError>(
+                "invalid destination UDP port range '{}'", dpSpec);
+
+    return PortRange{.first = *first, .last = *last};
+}
+
+auto parseSourceOfG(
+        std::vector<std::string> const& sofg) -> IPv4Address {
+    if (sofg.empty()) return IPv4Address{};
+
+    return parseSourceAddr(sofg[0]);
 }
 
 auto parseTimeoutSecs(std::vector<std::string> const& ts) -> unsigned {
@@ -108,12 +297,14 @@ auto parseTimeoutSecs(std::vector<std::string> const& ts) -> unsigned {
     return timeoutSecs;
 }
 
-auto parseTTL(std::vector<std::string> const& ttls, bool sender) -> uint32_t {
-    if (not sender) {
+auto parseTTL(
+        std::vector<std::string> const& ttls, bool sender,
+        ReturnGroup const& reflect) -> uint32_t {
+    if (not sender and not reflect) {
         if (not ttls.empty())
             raise<CommandLineError>(
                     "the option --ttl may only be specified with "
-                    "the option -s|--sender");
+                    "the options -s|--sender and --reflect");
 
         return 0u;
     }
@@ -143,6 +334,823 @@ auto parseCount(std::vector<std::string> const& counts) -> unsigned {
     return *rCount;
 }
 
+auto parseBatch(std::vector<std::string> const& batches, bool sender) -> unsigned {
+    if (batches.empty()) return 0;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --batch may not be specified with "
+                "the option -s|--sender");
+
+#ifdef __linux__
+    auto const& batchSpec = batches[0];
+    auto rBatch = parseDecimalUInt32(batchSpec);
+    if (not rBatch)
+        raise<CommandLineError>("invalid batch size '{}'", batchSpec);
+
+    auto batch = *rBatch;
+    if (batch < 1 or batch > 1024)
+        raise<CommandLineError>(
+                "invalid batch size {}, valid range is 1-1024", batch);
+
+    return batch;
+#else
+    raise<CommandLineError>("the option --batch is only supported in Linux");
+#endif
+}
+auto parseRxTimestamps(
+        std::vector<std::string> const& tss, bool sender) -> RxTimestamps {
+    if (tss.empty()) return RxTimestamps::Host;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --timestamps may not be specified with "
+                "the option -s|--sender");
+
+#ifdef __linux__
+    auto const& tsSpec = tss[0];
+    if (tsSpec == "sw") return RxTimestamps::Software;
+    if (tsSpec == "hw") return RxTimestamps::Hardware;
+
+    raise<CommandLineError>(
+            "invalid timestamp source '{}', valid values are 'sw' and 'hw'", tsSpec);
+#else
+    raise<CommandLineError>("the option --timestamps is only supported in Linux");
+#endif
+}
+
+auto parseThreads(
+        std::vector<std::string> const& ts,
+        bool sender, std::size_t subscriptions) -> unsigned {
+    if (ts.empty()) return 1;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --threads may not be specified with "
+                "the option -s|--sender");
+
+    auto const& tSpec = ts[0];
+    auto rThreads = parseDecimalUInt32(tSpec);
+    if (not rThreads)
+        raise<CommandLineError>("invalid number of threads '{}'", tSpec);
+
+    auto threads = *rThreads;
+    if (threads < 1 or threads > 256)
+        raise<CommandLineError>(
+                "invalid number of threads {}, valid range is 1-256", threads);
+
+    // Each thread needs at least one subscription
+    return std::min(threads, static_cast<uint32_t>(subscriptions));
+}
+
+/*!
+ * Parses a list of CPUs such as '0-3,8,10'
+ */
+auto parseCpus(std::vector<std::string> const& cs) -> std::vector<unsigned> {
+    if (cs.empty()) return {};
+
+#ifdef __linux__
+    auto const& cSpec = cs[0];
+    std::string_view sv{cSpec};
+    std::vector<unsigned> cpus;
+
+    auto parseCpu = [&cSpec] (std::string_view cpusv) -> unsigned {
+        auto rCpu = parseDecimalUInt32(cpusv);
+        if (not rCpu or *rCpu >= CPU_SETSIZE)
+            raise<CommandLineError>("invalid CPU '{}' in '{}'", cpusv, cSpec);
+        return *rCpu;
+    };
+
+    while (not sv.empty()) {
+        auto cpos = sv.find(',');
+        auto item = sv.substr(0, cpos);
+        sv = cpos == std::string_view::npos ? std::string_view{} : sv.substr(cpos+1);
+
+        auto dpos = item.find('-');
+        if (dpos == std::string_view::npos) {
+            cpus.push_back(parseCpu(item));
+            continue;
+        }
+
+        auto first = parseCpu(item.substr(0, dpos));
+        auto last = parseCpu(item.substr(dpos+1));
+        if (first > last)
+            raise<CommandLineError>("invalid CPU range '{}' in '{}'", item, cSpec);
+
+        for (auto cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+
+    if (cpus.empty())
+        raise<CommandLineError>("empty CPU list '{}'", cSpec);
+
+    return cpus;
+#else
+    raise<CommandLineError>("the option --cpus is only supported in Linux");
+#endif
+}
+
+auto parseRing(
+        std::vector<std::string> const& rs,
+        bool sender, bool wildcard, unsigned batch) -> unsigned {
+    if (rs.empty()) return 0;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --ring may not be specified with "
+                "the option -s|--sender");
+
+#ifdef __linux__
+    if (not wildcard)
+        raise<CommandLineError>(
+                "the option --ring may only be specified with "
+                "the portless subscriptions");
+
+    if (batch > 0)
+        raise<CommandLineError>(
+                "the options --ring and --batch are mutually exclusive");
+
+    auto const& rSpec = rs[0];
+    auto rBlocks = parseDecimalUInt32(rSpec);
+    if (not rBlocks)
+        raise<CommandLineError>("invalid number of ring blocks '{}'", rSpec);
+
+    auto blocks = *rBlocks;
+    if (blocks < 2 or blocks > 1024)
+        raise<CommandLineError>(
+                "invalid number of ring blocks {}, valid range is 2-1024", blocks);
+
+    return blocks;
+#else
+    raise<CommandLineError>("the option --ring is only supported in Linux");
+#endif
+}
+
+bool parseIOUring(bool ioUring, bool sender, unsigned batch, unsigned ring) {
+    if (not ioUring) return false;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --io-uring may not be specified with "
+                "the option -s|--sender");
+
+#ifdef __linux__
+    if (batch > 0)
+        raise<CommandLineError>(
+                "the options --io-uring and --batch are mutually exclusive");
+
+    if (ring > 0)
+        raise<CommandLineError>(
+                "the options --io-uring and --ring are mutually exclusive");
+
+    return true;
+#else
+    raise<CommandLineError>("the option --io-uring is only supported in Linux");
+#endif
+}
+
+auto parseBusyPoll(std::vector<std::string> const& bps, bool sender) -> unsigned {
+    if (bps.empty()) return 0;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --busy-poll may not be specified with "
+                "the option -s|--sender");
+
+    auto const& bpSpec = bps[0];
+    auto rUsecs = parseDecimalUInt32(bpSpec);
+    if (not rUsecs)
+        raise<CommandLineError>("invalid busy poll time '{}'", bpSpec);
+
+    auto usecs = *rUsecs;
+    if (usecs < 1 or usecs > 1'000'000)
+        raise<CommandLineError>(
+                "invalid busy poll time {}, valid range is 1-1000000", usecs);
+
+    return usecs;
+}
+
+bool parseGro(bool gro, bool sender, bool wildcard) {
+    if (not gro) return false;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --gro may not be specified with "
+                "the option -s|--sender");
+
+#ifdef __linux__
+    if (wildcard)
+        raise<CommandLineError>(
+                "the option --gro may not be specified with "
+                "the portless subscriptions");
+
+    return true;
+#else
+    raise<CommandLineError>("the option --gro is only supported in Linux");
+#endif
+}
+
+auto parseXdp(
+        std::vector<std::string> const& xs, bool sender, bool wildcard,
+        unsigned batch, unsigned ring, bool ioUring, RxTimestamps rxTimestamps) -> XdpMode {
+    if (xs.empty()) return XdpMode::None;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --xdp may not be specified with "
+                "the option -s|--sender");
+
+#ifdef __linux__
+    if (not wildcard)
+        raise<CommandLineError>(
+                "the option --xdp may only be specified with "
+                "the portless subscriptions");
+
+    if (batch > 0 or ring > 0 or ioUring)
+        raise<CommandLineError>(
+                "the option --xdp may not be specified with "
+                "the options --batch, --ring and --io-uring");
+
+    if (rxTimestamps != RxTimestamps::Host)
+        raise<CommandLineError>(
+                "the options --xdp and --timestamps are mutually exclusive");
+
+    auto const& xSpec = xs[0];
+    if (xSpec == "skb") return XdpMode::Skb;
+    if (xSpec == "drv") return XdpMode::Driver;
+
+    raise<CommandLineError>(
+            "invalid XDP mode '{}', valid values are 'skb' and 'drv'", xSpec);
+#else
+    raise<CommandLineError>("the option --xdp is only supported in Linux");
+#endif
+}
+
+auto parseZap(
+        std::vector<std::string> const& zs,
+        bool sender, RxTimestamps rxTimestamps) -> unsigned {
+    if (zs.empty()) return 0;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --zap may not be specified with "
+                "the option -s|--sender");
+
+    // The joins and the leaves are timed with the host clock
+    if (rxTimestamps == RxTimestamps::Hardware)
+        raise<CommandLineError>(
+                "the option --zap may not be specified with "
+                "the option --timestamps hw");
+
+    auto const& zSpec = zs[0];
+    auto rMillis = parseDecimalUInt32(zSpec);
+    if (not rMillis)
+        raise<CommandLineError>("invalid zap dwell time '{}'", zSpec);
+
+    auto millis = *rMillis;
+    if (millis < 10 or millis > 3'600'000)
+        raise<CommandLineError>(
+                "invalid zap dwell time {}, valid range is 10-3600000", millis);
+
+    return millis;
+}
+
+auto parseJoinRate(
+        std::vector<std::string> const& jrs,
+        bool sender, RxTimestamps rxTimestamps, unsigned zap) -> unsigned {
+    if (jrs.empty()) return 0;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --join-rate may not be specified with "
+                "the option -s|--sender");
+
+    // The joins are timed with the host clock
+    if (rxTimestamps == RxTimestamps::Hardware)
+        raise<CommandLineError>(
+                "the option --join-rate may not be specified with "
+                "the option --timestamps hw");
+
+    if (zap > 0)
+        raise<CommandLineError>(
+                "the options --join-rate and --zap are mutually exclusive");
+
+    auto const& jrSpec = jrs[0];
+    auto rRate = parseDecimalUInt32(jrSpec);
+    if (not rRate)
+        raise<CommandLineError>("invalid join rate '{}'", jrSpec);
+
+    auto rate = *rRate;
+    if (rate < 1 or rate > 1'000'000)
+        raise<CommandLineError>(
+                "invalid join rate {}, valid range is 1-1000000", rate);
+
+    return rate;
+}
+
+auto parseRcvBuf(
+        std::vector<std::string> const& rbs, bool sender,
+        unsigned ring, XdpMode xdp) -> unsigned {
+    if (rbs.empty()) return 0;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --rcvbuf may not be specified with "
+                "the option -s|--sender");
+
+    if (ring > 0 or xdp != XdpMode::None)
+        raise<CommandLineError>(
+                "the option --rcvbuf may not be specified with "
+                "the options --ring and --xdp");
+
+    auto const& rbSpec = rbs[0];
+    std::string_view sizesv{rbSpec};
+    uint64_t unit{1};
+    if (sizesv.ends_with('K') or sizesv.ends_with('k')) unit = 1024;
+    else if (sizesv.ends_with('M') or sizesv.ends_with('m')) unit = 1024 * 1024;
+    if (unit > 1) sizesv.remove_suffix(1);
+
+    auto rSize = parseDecimalUInt32(sizesv);
+    if (not rSize)
+        raise<CommandLineError>("invalid receive buffer size '{}'", rbSpec);
+
+    // The kernel doubles the requested size, which must fit in an int
+    auto size = *rSize * unit;
+    if (size < 4096 or size > 1024 * 1024 * 1024)
+        raise<CommandLineError>(
+                "invalid receive buffer size {}, valid range is 4096-1073741824 "
+                "bytes", rbSpec);
+
+    return static_cast<unsigned>(size);
+}
+
+auto parseReturnGroup(
+        std::string const& rgSpec, char const* option) -> ReturnGroup {
+    auto [group, dport, wildcard] = parseGroupPort(rgSpec);
+    if (wildcard)
+        raise<CommandLineError>(
+                "the destination port must be specified with the option {}",
+                option);
+
+    if (not group.isMcast())
+        raise<CommandLineError>(
+                "invalid return group {}, it is not a multicast group", group);
+
+    return ReturnGroup{.group = group, .dport = dport};
+}
+
+auto parseReflect(
+        std::vector<std::string> const& rgs, bool sender, bool wildcard,
+        std::vector<Subscription> const& subs) -> ReturnGroup {
+    if (rgs.empty()) return ReturnGroup{.group = {}, .dport = 0};
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --reflect may not be specified with "
+                "the option -s|--sender");
+
+    auto reflect = parseReturnGroup(rgs[0], "--reflect");
+    // The reflections would be received and reflected again
+    for (auto const& sub: subs) {
+        if (sub.group == reflect.group and (wildcard or sub.dport == reflect.dport))
+            raise<CommandLineError>(
+                    "the beacons may not be reflected to the subscribed "
+                    "group {}", reflect.group);
+    }
+
+    return reflect;
+}
+
+auto parseRtt(
+        std::vector<std::string> const& rgs, bool sender,
+        std::vector<Subscription> const& subs) -> ReturnGroup {
+    if (rgs.empty()) return ReturnGroup{.group = {}, .dport = 0};
+
+    if (not sender)
+        raise<CommandLineError>(
+                "the option --rtt may only be specified with "
+                "the option -s|--sender");
+
+    auto rtt = parseReturnGroup(rgs[0], "--rtt");
+    if (rtt.group == subs.front().group and rtt.dport == subs.front().dport)
+        raise<CommandLineError>(
+                "the reflections may not be received on the destination "
+                "of the beacons");
+
+    return rtt;
+}
+
+auto parseFill(std::vector<std::string> const& fills, bool sender) -> unsigned {
+    if (fills.empty()) return 0;
+
+    if (not sender)
+        raise<CommandLineError>(
+                "the option --fill may only be specified with "
+                "the option -s|--sender");
+
+    auto const& fillSpec = fills[0];
+    auto rFill = parseDecimalUInt32(fillSpec);
+    if (not rFill)
+        raise<CommandLineError>("invalid payload size '{}'", fillSpec);
+
+    // The largest UDP payload of an IPv4 datagram
+    if (*rFill < 64 or *rFill > 65507)
+        raise<CommandLineError>(
+                "invalid payload size {}, valid range is 64-65507 bytes", *rFill);
+
+    return *rFill;
+}
+
+bool parseDumpCorrupt(bool dumpCorrupt, bool sender) {
+    if (not dumpCorrupt) return false;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --dump-corrupt may not be specified with "
+                "the option -s|--sender");
+
+    return true;
+}
+
+auto parseSilence(std::vector<std::string> const& ss, bool sender) -> unsigned {
+    if (ss.empty()) return 0;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --silence may not be specified with "
+                "the option -s|--sender");
+
+    auto const& sSpec = ss[0];
+    auto rMillis = parseDecimalUInt32(sSpec);
+    if (not rMillis)
+        raise<CommandLineError>("invalid silence threshold '{}'", sSpec);
+
+    auto millis = *rMillis;
+    if (millis < 10 or millis > 3'600'000)
+        raise<CommandLineError>(
+                "invalid silence threshold {}, valid range is 10-3600000", millis);
+
+    return millis;
+}
+
+auto parseOutput(
+        std::vector<std::string> const& os, bool sender, bool showPayload,
+        bool dumpCorrupt) -> std::tuple<OutputMode, unsigned> {
+    if (os.empty()) return {OutputMode::Full, 1};
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --output may not be specified with "
+                "the option -s|--sender");
+
+    auto const& oSpec = os[0];
+    if (oSpec == "all") return {OutputMode::Full, 1};
+
+    if (oSpec == "stats") {
+        if (showPayload or dumpCorrupt)
+            raise<CommandLineError>(
+                    "the option --output stats may not be specified with "
+                    "the options -X|--hex-ascii and --dump-corrupt");
+        return {OutputMode::StatsOnly, 0};
+    }
+
+    std::string_view prefix{"sample:"};
+    if (oSpec.starts_with(prefix)) {
+        auto nSpec = std::string_view{oSpec}.substr(prefix.size());
+        auto rEvery = parseDecimalUInt32(nSpec);
+        if (not rEvery)
+            raise<CommandLineError>("invalid sample rate '{}'", nSpec);
+
+        auto every = *rEvery;
+        if (every < 2 or every > 1'000'000'000)
+            raise<CommandLineError>(
+                    "invalid sample rate {}, valid range is 2-1000000000", every);
+
+        return {OutputMode::Sampled, every};
+    }
+
+    raise<CommandLineError>(
+            "invalid output mode '{}', valid values are 'all', 'stats' "
+            "and 'sample:N'", oSpec);
+}
+
+auto parseFifo(std::vector<std::string> const& fs) -> unsigned {
+    if (fs.empty()) return 0;
+
+#ifdef __linux__
+    auto const& fSpec = fs[0];
+    auto rPriority = parseDecimalUInt32(fSpec);
+    if (not rPriority)
+        raise<CommandLineError>("invalid SCHED_FIFO priority '{}'", fSpec);
+
+    auto priority = *rPriority;
+    if (priority < 1 or priority > 99)
+        raise<CommandLineError>(
+                "invalid SCHED_FIFO priority {}, valid range is 1-99", priority);
+
+    return priority;
+#else
+    raise<CommandLineError>("the option --fifo is only supported in Linux");
+#endif
+}
+
+bool parseMlock(bool mlock) {
+    if (not mlock) return false;
+
+#ifdef __linux__
+    return true;
+#else
+    raise<CommandLineError>("the option --mlock is only supported in Linux");
+#endif
+}
+
+bool parseHugePages(bool hugePages, bool sender) {
+    if (not hugePages) return false;
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --huge-pages may not be specified with "
+                "the option -s|--sender");
+
+#ifdef __linux__
+    return true;
+#else
+    raise<CommandLineError>("the option --huge-pages is only supported in Linux");
+#endif
+}
+
+auto parseWrite(std::vector<std::string> const& ws, bool sender) -> std::string {
+    if (ws.empty()) return {};
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --write may not be specified with "
+                "the option -s|--sender");
+
+    return ws[0];
+}
+
+auto parseRecord(std::vector<std::string> const& rs, bool sender) -> std::string {
+    if (rs.empty()) return {};
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --record may not be specified with "
+                "the option -s|--sender");
+
+    return rs[0];
+}
+
+/*!
+ * @return the snapshot lengths of the capture written with --write and
+ * of the flight recorder, whose ring only keeps the start of each packet
+ * by default
+ */
+auto parseSnaplen(
+        std::vector<std::string> const& ss, std::string const& write,
+        std::string const& record) -> std::tuple<unsigned, unsigned> {
+    if (ss.empty()) return {65535, 256};
+
+    if (write.empty() and record.empty())
+        raise<CommandLineError>(
+                "the option --snaplen requires the option --write or --record");
+
+    auto const& sSpec = ss[0];
+    auto rSnaplen = parseDecimalUInt32(sSpec);
+    if (not rSnaplen)
+        raise<CommandLineError>("invalid snapshot length '{}'", sSpec);
+
+    auto snaplen = *rSnaplen;
+    if (snaplen < 64 or snaplen > 65535)
+        raise<CommandLineError>(
+                "invalid snapshot length {}, valid range is 64-65535", snaplen);
+
+    return {snaplen, snaplen};
+}
+
+auto parseRotate(
+        std::vector<std::string> const& rs, std::string const& write) -> unsigned {
+    if (rs.empty()) return 0;
+
+    if (write.empty())
+        raise<CommandLineError>("the option --rotate requires the option --write");
+
+    auto const& rSpec = rs[0];
+    auto rMiB = parseDecimalUInt32(rSpec);
+    if (not rMiB)
+        raise<CommandLineError>("invalid capture file size '{}'", rSpec);
+
+    auto mib = *rMiB;
+    if (mib < 1 or mib > 1'048'576)
+        raise<CommandLineError>(
+                "invalid capture file size {}, valid range is 1-1048576 MiB", mib);
+
+    return mib;
+}
+
+auto parseRecordDepth(
+        std::vector<std::string> const& ds, std::string const& record) -> unsigned {
+    if (ds.empty()) return 1000;
+
+    if (record.empty())
+        raise<CommandLineError>("the option --record-depth requires the option --record");
+
+    auto const& dSpec = ds[0];
+    auto rDepth = parseDecimalUInt32(dSpec);
+    if (not rDepth)
+        raise<CommandLineError>("invalid flight recorder depth '{}'", dSpec);
+
+    auto depth = *rDepth;
+    if (depth < 1 or depth > 1'000'000)
+        raise<CommandLineError>(
+                "invalid flight recorder depth {}, valid range is 1-1000000", depth);
+
+    return depth;
+}
+
+auto parseRecordAfter(
+        std::vector<std::string> const& as, std::string const& record) -> unsigned {
+    if (as.empty()) return 1000;
+
+    if (record.empty())
+        raise<CommandLineError>("the option --record-after requires the option --record");
+
+    auto const& aSpec = as[0];
+    auto rAfter = parseDecimalUInt32(aSpec);
+    if (not rAfter)
+        raise<CommandLineError>("invalid number of packets '{}'", aSpec);
+
+    auto after = *rAfter;
+    if (after > 1'000'000)
+        raise<CommandLineError>(
+                "invalid number of packets {}, valid range is 0-1000000", after);
+
+    return after;
+}
+
+auto parsePcap(std::vector<std::string> const& pcs, bool sender) -> std::string {
+    if (pcs.empty()) return {};
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --pcap may not be specified with "
+                "the option -s|--sender");
+
+    return pcs[0];
+}
+
+/*!
+ * Returns the interface \p intfName which must have an IPv4 address.
+ */
+auto findIntf(
+        IntfTable const& intfTable, std::string const& intfName) -> IntfInfo const& {
+    auto intfInfo = intfTable.byName(intfName);
+    if (not intfInfo) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+        fmt::format_to(bi, "unknown interface '{}'\n\n", intfName);
+        fmt::format_to(bi, "available interfaces:\n");
+        formatIntfTable(bi, intfTable, 0);
+        throw CommandLineError{fmt::to_string(buf)};
+    } else if (not intfInfo->ipv4addr) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+        fmt::format_to(bi, "interface {} has no IPv4 address\n\n", intfName);
+        fmt::format_to(bi, "available interfaces:\n");
+        formatIntfTable(bi, intfTable, 0);
+        throw CommandLineError{fmt::to_string(buf)};
+    }
+
+    return *intfInfo;
+}
+
+auto parseLineB(
+        std::vector<std::string> const& lbs, IntfTable const& intfTable,
+        unsigned lineAIndex, bool sender, RxTimestamps rxTimestamps,
+        unsigned ring, XdpMode xdp) -> LineB {
+    if (lbs.empty()) return LineB{.intf = {}, .intfAddr = {}, .ifIndex = 0};
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --line-b may not be specified with "
+                "the option -s|--sender");
+
+    if (ring > 0 or xdp != XdpMode::None)
+        raise<CommandLineError>(
+                "the option --line-b may not be specified with "
+                "the options --ring and --xdp");
+
+    // The hardware timestamps of the two lines come from different NIC clocks
+    if (rxTimestamps == RxTimestamps::Hardware)
+        raise<CommandLineError>(
+                "the option --line-b may not be specified with "
+                "the option --timestamps hw");
+
+    auto const& intfInfo = findIntf(intfTable, lbs[0]);
+    if (intfInfo.ifindex == lineAIndex)
+        raise<CommandLineError>(
+                "the lines A and B must be received on different interfaces");
+
+    return LineB{
+        .intf = intfInfo.name,
+        .intfAddr = intfInfo.ipv4addr.value(),
+        .ifIndex = intfInfo.ifindex,
+    };
+}
+
+auto parseSeqMagic(std::string const& smSpec, SeqField& sf) {
+    std::string_view offsetsv{smSpec};
+    std::string_view bytessv;
+    if (auto pos = offsetsv.find(':'); pos != std::string_view::npos) {
+        bytessv = offsetsv.substr(pos + 1);
+        offsetsv = offsetsv.substr(0, pos);
+    }
+    if (bytessv.starts_with("0x") or bytessv.starts_with("0X"))
+        bytessv.remove_prefix(2);
+
+    auto rOffset = parseDecimalUInt16(offsetsv);
+    if (not rOffset or bytessv.empty() or bytessv.size() % 2 != 0 or
+        bytessv.size() > sf.magic.size() * 2)
+        raise<CommandLineError>(
+                "invalid magic '{}', expected the offset and 1 to 8 bytes "
+                "in hex, e.g. 0:a1b2c3d4", smSpec);
+
+    auto nibble = [&smSpec] (char c) -> unsigned {
+        if (c >= '0' and c <= '9') return static_cast<unsigned>(c - '0');
+        if (c >= 'a' and c <= 'f') return static_cast<unsigned>(c - 'a' + 10);
+        if (c >= 'A' and c <= 'F') return static_cast<unsigned>(c - 'A' + 10);
+        raise<CommandLineError>("invalid magic '{}', invalid hex digit '{}'", smSpec, c);
+    };
+
+    sf.magicOffset = *rOffset;
+    sf.magicSize = static_cast<uint8_t>(bytessv.size() / 2);
+    for (std::size_t i = 0; i < sf.magicSize; ++i)
+        sf.magic[i] = static_cast<uint8_t>(
+                (nibble(bytessv[i * 2]) << 4u) | nibble(bytessv[i * 2 + 1]));
+}
+
+auto parseSeqField(
+        std::vector<std::string> const& sfs, std::vector<std::string> const& sms,
+        bool sender) -> SeqField {
+    SeqField sf{
+        .offset = 0, .size = 0, .littleEndian = false,
+        .magicOffset = 0, .magicSize = 0, .magic = {}};
+    if (sfs.empty()) {
+        if (not sms.empty())
+            raise<CommandLineError>(
+                    "the option --seq-magic may only be specified with "
+                    "the option --seq-field");
+        return sf;
+    }
+
+    if (sender)
+        raise<CommandLineError>(
+                "the option --seq-field may not be specified with "
+                "the option -s|--sender");
+
+    auto const& sfSpec = sfs[0];
+    std::string_view offsetsv{sfSpec};
+    std::string_view sizesv{"4"};
+    std::string_view endiansv{"be"};
+    if (auto pos = offsetsv.find(':'); pos != std::string_view::npos) {
+        sizesv = offsetsv.substr(pos + 1);
+        offsetsv = offsetsv.substr(0, pos);
+        if (auto epos = sizesv.find(':'); epos != std::string_view::npos) {
+            endiansv = sizesv.substr(epos + 1);
+            sizesv = sizesv.substr(0, epos);
+        }
+    }
+
+    auto rOffset = parseDecimalUInt16(offsetsv);
+    auto rSize = parseDecimalUInt16(sizesv);
+    if (not rOffset or not rSize or (endiansv != "be" and endiansv != "le"))
+        raise<CommandLineError>("invalid sequence number field '{}'", sfSpec);
+
+    auto size = *rSize;
+    if (size != 1 and size != 2 and size != 4 and size != 8)
+        raise<CommandLineError>(
+                "invalid sequence number size {}, valid sizes are 1, 2, 4 and 8",
+                size);
+
+    sf.offset = *rOffset;
+    sf.size = static_cast<uint8_t>(size);
+    sf.littleEndian = endiansv == "le";
+    if (not sms.empty())
+        parseSeqMagic(sms[0], sf);
+
+    return sf;
+}
+
+char const* rxTimestampsName(RxTimestamps rxts) {
+    switch (rxts) {
+    case RxTimestamps::Software:
+        return "kernel software (SO_TIMESTAMPNS)";
+    case RxTimestamps::Hardware:
+        return "NIC hardware (SO_TIMESTAMPING)";
+    default:
+        return "host time after wakeup";
+    }
+}
 
 } // anon.namespace
 
@@ -159,7 +1167,24 @@ Config Config::fromArgs(int argc, char** argv) {
                     "This option implies the use of IGMPv3, which may or may not be "
                     "enabled on the host. If it's not enabled, the host will join (*,G) "
                     "as opposed to (S,G) and filtering by source will be performed by "
-                    "the host")
+                    "the host. The source applies to all the subscriptions "
+                    "which do not specify their own source.")
+            .optional(
+                    OID(GroupsFile), 'f', "groups-file", "File",
+                    "Load the subscriptions from the specified file in addition "
+                    "to the ones on the command line. The file contains one "
+                    "subscription group[:port][@source[,source...]] per line, "
+                    "the sources of the lines with the same group[:port] are "
+                    "merged. Empty lines and text following '#' are ignored. "
+                    "Unless the subscriptions are portless or joined in zap mode "
+                    "or at the join rate, the file is loaded again on SIGUSR1 "
+                    "and the source lists of the groups in it are updated "
+                    "without leaving the groups.")
+            .optional(
+                    OID(DPorts), GetOptLong::LongOnly, "dports", "PortRange",
+                    "Only receive the traffic destined for the UDP ports in the "
+                    "specified range, e.g. 5000-5099, with the portless "
+                    "subscriptions.")
             .optional(
                     OID(Timeout), 't', "timeout", "Seconds",
                     "The timeout in seconds, defaults to 5s. Valid values are "
@@ -182,6 +1207,220 @@ Config Config::fromArgs(int argc, char** argv) {
                     "until interrupted. This option will cause the receiver or the "
                     "sender to stop after the specified number of packet was received "
                     "or sent.")
+            .optional(
+                    OID(Batch), GetOptLong::LongOnly, "batch", "NoOfPkts",
+                    "Drain the socket using recvmmsg() receiving up to the "
+                    "specified number of packets per system call, instead of "
+                    "receiving a single packet per wakeup. Valid values are in "
+                    "range 1-1024. This option is only supported in Linux.")
+            .optional(
+                    OID(Timestamps), GetOptLong::LongOnly, "timestamps", "Source",
+                    "Use the kernel receive timestamps of the packets instead of "
+                    "the host time taken after the wakeup. The value 'sw' selects "
+                    "the kernel software timestamps and the value 'hw' selects "
+                    "the NIC hardware timestamps, which fall back to the software "
+                    "timestamps if not supported by the NIC. This option is only "
+                    "supported in Linux.")
+            .optional(
+                    OID(Threads), GetOptLong::LongOnly, "threads", "NoOfThreads",
+                    "Shard the subscriptions among the specified number of "
+                    "receive threads, each of which has its own sockets and "
+                    "statistics. Valid values are in range 1-256. The number "
+                    "of threads is capped by the number of subscriptions.")
+            .optional(
+                    OID(Cpus), GetOptLong::LongOnly, "cpus", "CpuList",
+                    "Pin the receive threads to the specified CPUs, e.g. "
+                    "0-3,8. The receive thread N is pinned to the N-th CPU "
+                    "in the list, wrapping around if there are more threads "
+                    "than CPUs. The sender is pinned to the first CPU in the "
+                    "list. This option is only supported in Linux.")
+            .optional(
+                    OID(Fifo), GetOptLong::LongOnly, "fifo", "Priority",
+                    "Run the receive threads or the sender under the "
+                    "SCHED_FIFO real-time policy at the specified priority, "
+                    "which requires the CAP_SYS_NICE capability. Valid "
+                    "values are in range 1-99. This option is only "
+                    "supported in Linux.")
+            .flag(OID(Mlock), GetOptLong::LongOnly, "mlock",
+                  "Lock the memory of mclst with mlockall() and prefault the "
+                  "receive buffers and the thread stacks, so that no page "
+                  "faults occur while receiving or sending. This requires "
+                  "the CAP_IPC_LOCK capability unless RLIMIT_MEMLOCK is "
+                  "large enough. This option is only supported in Linux.")
+            .flag(OID(HugePages), GetOptLong::LongOnly, "huge-pages",
+                  "Back the receive buffers with huge pages allocated on the "
+                  "NUMA node of the CPU to which the receive thread is "
+                  "pinned, falling back to the regular pages if no huge "
+                  "pages are available, see vm.nr_hugepages. This option "
+                  "is only supported in Linux.")
+            .optional(
+                    OID(Ring), GetOptLong::LongOnly, "ring", "NoOfBlocks",
+                    "Receive the portless subscriptions from a memory mapped "
+                    "TPACKET_V3 packet ring of the specified number of 1MiB "
+                    "blocks, instead of a raw IP socket. Valid values are in "
+                    "range 2-1024. This option is only supported in Linux.")
+            .flag(OID(IOUring), GetOptLong::LongOnly, "io-uring",
+                  "Receive using multishot recvmsg requests of an io_uring "
+                  "instance with provided buffers, instead of a recvmsg() "
+                  "call per packet. Falls back to recvmsg() if the kernel "
+                  "does not support it. This option is only supported in Linux.")
+            .optional(
+                    OID(BusyPoll), GetOptLong::LongOnly, "busy-poll", "Microseconds",
+                    "Spin on the non-blocking sockets instead of sleeping until "
+                    "the packets arrive, making each receive thread use a whole "
+                    "CPU. In Linux the sockets also busy poll the device queue "
+                    "for up to the specified number of microseconds. Valid "
+                    "values are in range 1-1000000.")
+            .flag(OID(Gro), GetOptLong::LongOnly, "gro",
+                  "Let the kernel coalesce the datagrams of a flow using UDP "
+                  "GRO and split the coalesced datagrams back after they are "
+                  "received, saving the per datagram cost of the socket layer. "
+                  "This option is only supported in Linux.")
+            .optional(
+                    OID(Xdp), GetOptLong::LongOnly, "xdp", "Mode",
+                    "Receive the portless subscriptions from AF_XDP sockets, "
+                    "bypassing the kernel network stack. An XDP program "
+                    "attached to the interface in the generic mode 'skb' or "
+                    "in the native mode 'drv' redirects the traffic for the "
+                    "subscribed groups to the sockets and leaves the rest of "
+                    "the traffic to the kernel. This option is only "
+                    "supported in Linux.")
+            .optional(
+                    OID(Zap), GetOptLong::LongOnly, "zap", "Millis",
+                    "Instead of joining all the subscriptions at once, join "
+                    "them one at a time, each for the specified number of "
+                    "milliseconds, and then leave it and join the next one, "
+                    "measuring the time from the join to the first packet and "
+                    "from the leave to the last packet. A single subscription "
+                    "is left and rejoined. This option may not be specified "
+                    "with --timestamps hw. Valid values are in range "
+                    "10-3600000.")
+            .optional(
+                    OID(JoinRate), GetOptLong::LongOnly, "join-rate", "GroupsPerSec",
+                    "Join the subscriptions at the specified rate rather than "
+                    "all at once, and report the time from the join to the "
+                    "first packet of each subscription and the subscriptions "
+                    "which have received no traffic. This option may not be "
+                    "specified with --timestamps hw. Valid values are in "
+                    "range 1-1000000.")
+            .optional(
+                    OID(LineB), GetOptLong::LongOnly, "line-b", "Interface",
+                    "Also join the subscriptions on the specified interface, "
+                    "which receives the B line of a redundant A/B feed whose "
+                    "A line is received on the interface specified with -i. "
+                    "The packets of the two lines are matched by their "
+                    "sequence numbers, and at exit the loss of each line, the "
+                    "line which won each packet and the arrival time "
+                    "difference between the lines are shown.")
+            .optional(
+                    OID(SeqField), GetOptLong::LongOnly, "seq-field", "Offset",
+                    "Detect the gaps and the duplicates of each flow and "
+                    "match the packets of the A and B lines by the sequence "
+                    "number at the specified offset of the UDP payload "
+                    "instead of the sequence number of the mclst beacon. The "
+                    "offset may be followed by ':' and the size of the "
+                    "sequence number, which is 1, 2, 4 or 8 bytes, 4 by "
+                    "default, and then by ':' and the byte order, which is "
+                    "'be' or 'le', 'be' by default, e.g. 0:8:le.")
+            .optional(
+                    OID(SeqMagic), GetOptLong::LongOnly, "seq-magic", "OffsetBytes",
+                    "Only take the sequence numbers of the packets which have "
+                    "the specified bytes at the specified offset of the UDP "
+                    "payload, e.g. 0:a1b2c3d4. Up to 8 bytes may be specified "
+                    "in hex. Requires --seq-field.")
+            .optional(
+                    OID(RcvBuf), GetOptLong::LongOnly, "rcvbuf", "Bytes",
+                    "Set the receive buffer size of the sockets to the "
+                    "specified number of bytes, which may be followed by K or "
+                    "M for KiB or MiB, e.g. 16M. The size is forced with "
+                    "SO_RCVBUFFORCE, which exceeds net.core.rmem_max but "
+                    "requires the CAP_NET_ADMIN capability, and falls back to "
+                    "SO_RCVBUF capped by net.core.rmem_max otherwise. Valid "
+                    "values are in range 4096-1073741824 bytes.")
+            .optional(
+                    OID(Reflect), GetOptLong::LongOnly, "reflect", "GroupPort",
+                    "Send each received mclst beacon unmodified to the "
+                    "specified group:port right away, so that the sender "
+                    "started with the option --rtt can measure the round trip "
+                    "time without relying on synchronized clocks.")
+            .optional(
+                    OID(Rtt), GetOptLong::LongOnly, "rtt", "GroupPort",
+                    "Sender only: receive the beacons reflected by the "
+                    "receivers started with the option --reflect on the "
+                    "specified group:port and show the round trip time of "
+                    "each reflection and the round trip time percentiles of "
+                    "each reflector at exit.")
+            .optional(
+                    OID(Fill), GetOptLong::LongOnly, "fill", "Bytes",
+                    "Sender only: pad the beacons to the specified UDP payload "
+                    "size with a deterministic pattern and end them with the "
+                    "CRC32C of the payload, which the receivers verify to "
+                    "detect the corruption of the payload. Valid values are "
+                    "in range 64-65507.")
+            .flag(OID(DumpCorrupt), GetOptLong::LongOnly, "dump-corrupt",
+                  "Show the hex dump of the payload of each beacon whose "
+                  "CRC32C does not match.")
+            .optional(
+                    OID(Silence), GetOptLong::LongOnly, "silence", "Milliseconds",
+                    "Report each flow which has received no packets for the "
+                    "specified number of milliseconds, and report it again "
+                    "once it resumes. The longest outage of each flow is "
+                    "shown at exit. Valid values are in range 10-3600000.")
+            .optional(
+                    OID(Output), GetOptLong::LongOnly, "output", "Mode",
+                    "Select which received packets are shown: 'all' shows "
+                    "every packet, which is the default, 'sample:N' shows one "
+                    "of every N packets, e.g. sample:1000, and 'stats' shows "
+                    "no packets, only the statistics at exit. The packets are "
+                    "accounted for in the statistics in all modes.")
+            .optional(
+                    OID(Write), GetOptLong::LongOnly, "write", "File",
+                    "Write every accepted packet with its nanosecond receive "
+                    "timestamp and the interface on which it was received to "
+                    "the specified pcapng file. The file is written by a "
+                    "background thread, and the packets which it cannot keep "
+                    "up with are dropped from the capture rather than slowing "
+                    "down the receive.")
+            .optional(
+                    OID(Snaplen), GetOptLong::LongOnly, "snaplen", "Bytes",
+                    "Write at most the specified number of bytes of each "
+                    "packet with --write and --record, including the IPv4 and "
+                    "UDP headers. Valid values are in range 64-65535, 65535 "
+                    "by default with --write and 256 with --record.")
+            .optional(
+                    OID(Rotate), GetOptLong::LongOnly, "rotate", "MiB",
+                    "Move on to the next capture file with --write once the "
+                    "current one reaches the specified size in MiB. The "
+                    "number of the file is inserted before the extension of "
+                    "the file name, e.g. mclst.pcapng, mclst.1.pcapng, etc. "
+                    "Valid values are in range 1-1048576.")
+            .optional(
+                    OID(Record), GetOptLong::LongOnly, "record", "File",
+                    "Keep the last received packets in memory and dump them "
+                    "to the specified pcapng file along with the packets "
+                    "which follow once an anomaly is detected: a sequence "
+                    "gap, a change of the TTL of a flow, a silent flow, a "
+                    "corrupted beacon or a malformed packet. The number of "
+                    "the dump is inserted before the extension of the file "
+                    "name, e.g. mclst.pcapng, mclst.1.pcapng, etc.")
+            .optional(
+                    OID(RecordDepth), GetOptLong::LongOnly, "record-depth", "NoOfPkts",
+                    "Keep the specified number of the last packets per "
+                    "receive thread with --record. Valid values are in range "
+                    "1-1000000, 1000 by default.")
+            .optional(
+                    OID(RecordAfter), GetOptLong::LongOnly, "record-after", "NoOfPkts",
+                    "Dump the specified number of the packets which follow "
+                    "an anomaly with --record. Valid values are in range "
+                    "0-1000000, 1000 by default.")
+            .optional(
+                    OID(Pcap), GetOptLong::LongOnly, "pcap", "File",
+                    "Read the packets from the specified pcap or pcapng "
+                    "capture file instead of receiving them, e.g. to analyze "
+                    "a capture taken with tcpdump. The packets are dissected "
+                    "and accounted just as if they were received, timestamped "
+                    "with their capture times, and the file is read as fast "
+                    "as possible. The option -i is not required.")
             .flag(OID(NoColors), GetOptLong::LongOnly, "no-colors",
                   "Do not use colored output")
             .flag(OID(ShowConfig), GetOptLong::LongOnly, "show-config",
@@ -197,20 +1436,32 @@ Config Config::fromArgs(int argc, char** argv) {
 
     auto const& gp = args.positional();
     auto const& intf = args.values(OID(Interface));
+    auto const& groupsFile = args.values(OID(GroupsFile));
+    auto const& pcaps = args.values(OID(Pcap));
 
-    if (gp.empty())
+    if (gp.empty() and groupsFile.empty())
         raise<CommandLineError>("no group and destination port specified");
 
-    if (gp.size() > 1)
-        raise<CommandLineError>("too many positional parameters");
-
-    if (intf.empty())
+    // The capture file is analyzed without receiving from any interface
+    if (intf.empty() and pcaps.empty())
         raise<CommandLineError>("interface is required");
 
-    IPv4Address group;
-    uint16_t dport;
-    bool wildcard;
-    std::tie(group, dport, wildcard) = parseGroupPort(gp[0]);
+    auto sourceAddr = parseSourceOfG(args.values(OID(SourceOfG)));
+
+    std::vector<std::tuple<Subscription, bool>> parsedSubs;
+    for (auto const& spec: gp)
+        parsedSubs.push_back(parseSubscription(spec, sourceAddr));
+    if (not groupsFile.empty())
+        loadSubscriptions(groupsFile[0], sourceAddr, parsedSubs);
+
+    if (parsedSubs.empty())
+        raise<CommandLineError>(
+                "no subscriptions found in groups file '{}'", groupsFile[0]);
+
+    bool wildcard = std::get<1>(parsedSubs.front());
+    auto subscriptions = mergeSubscriptions(parsedSubs, wildcard);
+
+    auto dports = parseDPorts(args.values(OID(DPorts)), wildcard);
 
     auto rIntfTable = IntfTable::newTable();
     if (not rIntfTable)
@@ -219,36 +1470,94 @@ Config Config::fromArgs(int argc, char** argv) {
 
     auto intfTable = std::move(rIntfTable).value();
 
-    auto const& intfName = intf[0];
-    auto intfInfo = intfTable.byName(intfName);
-    if (not intfInfo) {
-        auto& buf = getMemoryBuffer();
-        auto bi = std::back_inserter(buf);
-        fmt::format_to(bi, "unknown interface '{}'\n\n", intfName);
-        fmt::format_to(bi, "available interfaces:\n");
-        formatIntfTable(bi, intfTable, 0);
-        throw CommandLineError{fmt::to_string(buf)};
-    } else if (not intfInfo->ipv4addr) {
-        auto& buf = getMemoryBuffer();
-        auto bi = std::back_inserter(buf);
-        fmt::format_to(bi, "interface {} has no IPv4 address\n\n", intfName);
-        fmt::format_to(bi, "available interfaces:\n");
-        formatIntfTable(bi, intfTable, 0);
-        throw CommandLineError{fmt::to_string(buf)};
+    std::string intfName;
+    IPv4Address intfAddr{};
+    unsigned intfIndex{0};
+    if (not intf.empty()) {
+        auto const& intfInfo = findIntf(intfTable, intf[0]);
+        intfName = intfInfo.name;
+        intfAddr = intfInfo.ipv4addr.value();
+        intfIndex = intfInfo.ifindex;
     }
-    auto intfAddr = intfInfo->ipv4addr.value();
 
-    auto sourceAddr = parseSourceOfG(args.values(OID(SourceOfG)));
     auto timeoutSecs = parseTimeoutSecs(args.values(OID(Timeout)));
     bool showPayload = args.flag(OID(ShowPayload));
     auto count = parseCount(args.values(OID(Count)));
 
     bool sender = args.flag(OID(Sender));
-    auto ttl = parseTTL(args.values(OID(SetTTL)), sender);
+    auto reflect = parseReflect(
+            args.values(OID(Reflect)), sender, wildcard, subscriptions);
+    auto ttl = parseTTL(args.values(OID(SetTTL)), sender, reflect);
+    if (sender and subscriptions.size() > 1)
+        raise<CommandLineError>(
+                "exactly one destination must be specified with the option "
+                "-s|--sender");
     if (sender and wildcard)
         raise<CommandLineError>(
                 "the destination port must be specified with the option -s|--sender");
 
+    auto batch = parseBatch(args.values(OID(Batch)), sender);
+    auto rxTimestamps = parseRxTimestamps(args.values(OID(Timestamps)), sender);
+    auto threads = parseThreads(
+            args.values(OID(Threads)), sender, subscriptions.size());
+    auto cpus = parseCpus(args.values(OID(Cpus)));
+    auto ring = parseRing(args.values(OID(Ring)), sender, wildcard, batch);
+    auto ioUring = parseIOUring(args.flag(OID(IOUring)), sender, batch, ring);
+    auto busyPoll = parseBusyPoll(args.values(OID(BusyPoll)), sender);
+    auto gro = parseGro(args.flag(OID(Gro)), sender, wildcard);
+    auto xdp = parseXdp(
+            args.values(OID(Xdp)), sender, wildcard,
+            batch, ring, ioUring, rxTimestamps);
+    auto zap = parseZap(args.values(OID(Zap)), sender, rxTimestamps);
+    auto joinRate = parseJoinRate(
+            args.values(OID(JoinRate)), sender, rxTimestamps, zap);
+    auto lineB = parseLineB(
+            args.values(OID(LineB)), intfTable, intfIndex,
+            sender, rxTimestamps, ring, xdp);
+    auto seqField = parseSeqField(
+            args.values(OID(SeqField)), args.values(OID(SeqMagic)), sender);
+    auto rcvbuf = parseRcvBuf(args.values(OID(RcvBuf)), sender, ring, xdp);
+    auto rtt = parseRtt(args.values(OID(Rtt)), sender, subscriptions);
+    auto fill = parseFill(args.values(OID(Fill)), sender);
+    auto dumpCorrupt = parseDumpCorrupt(args.flag(OID(DumpCorrupt)), sender);
+    auto silence = parseSilence(args.values(OID(Silence)), sender);
+    auto [output, sample] = parseOutput(
+            args.values(OID(Output)), sender, showPayload, dumpCorrupt);
+    auto fifo = parseFifo(args.values(OID(Fifo)));
+    auto mlock = parseMlock(args.flag(OID(Mlock)));
+    auto hugePages = parseHugePages(args.flag(OID(HugePages)), sender);
+    auto write = parseWrite(args.values(OID(Write)), sender);
+    auto record = parseRecord(args.values(OID(Record)), sender);
+    auto [snaplen, recordSnaplen] = parseSnaplen(
+            args.values(OID(Snaplen)), write, record);
+    auto rotate = parseRotate(args.values(OID(Rotate)), write);
+    auto recordDepth = parseRecordDepth(args.values(OID(RecordDepth)), record);
+    auto recordAfter = parseRecordAfter(args.values(OID(RecordAfter)), record);
+    auto pcap = parsePcap(pcaps, sender);
+    if (not pcap.empty() and (
+            batch > 0 or rxTimestamps != RxTimestamps::Host or threads > 1 or
+            ring > 0 or ioUring or busyPoll > 0 or gro or xdp != XdpMode::None or
+            zap > 0 or joinRate > 0 or lineB or rcvbuf > 0 or reflect or
+            fifo > 0 or mlock or hugePages))
+        raise<CommandLineError>(
+                "the option --pcap may not be specified with the options "
+                "which control the receive from the network");
+    // Each raw IP socket receives all the UDP traffic of the host, so
+    // the portless subscriptions can only be sharded among the rings,
+    // which are members of the same fanout group, or among the AF_XDP
+    // sockets of the different receive queues
+    if (wildcard and threads > 1 and ring == 0 and xdp == XdpMode::None)
+        raise<CommandLineError>(
+                "the portless subscriptions may only be received in "
+                "multiple threads with the option --ring or --xdp");
+
+    // The sources are only filtered by the kernel, which allows updating
+    // them in place, if the subscriptions specify the destination port
+    std::string reloadFile;
+    if (not groupsFile.empty() and not sender and not wildcard and
+        pcap.empty() and zap == 0 and joinRate == 0)
+        reloadFile = groupsFile[0];
+
     bool noColors = args.flag(OID(NoColors));
     if (not isatty(fileno(stdout)) or not isatty(fileno(stderr)))
         noColors = true;
@@ -256,45 +1565,190 @@ Config Config::fromArgs(int argc, char** argv) {
     bool showConfig = args.flag(OID(ShowConfig));
 
     return Config{
-        group,
-        dport,
+        std::move(subscriptions),
         wildcard,
+        dports,
         intfName,
         intfAddr,
-        sourceAddr,
+        intfIndex,
         timeoutSecs,
         sender,
         ttl,
         count,
         showPayload,
         not noColors,
+        batch,
+        rxTimestamps,
+        threads,
+        std::move(cpus),
+        ring,
+        ioUring,
+        busyPoll,
+        gro,
+        xdp,
+        zap,
+        joinRate,
+        std::move(lineB),
+        seqField,
+        rcvbuf,
+        reflect,
+        rtt,
+        fill,
+        dumpCorrupt,
+        silence,
+        output,
+        sample,
+        fifo,
+        mlock,
+        hugePages,
+        std::move(write),
+        snaplen,
+        rotate,
+        std::move(record),
+        recordDepth,
+        recordAfter,
+        recordSnaplen,
+        std::move(pcap),
+        std::move(reloadFile),
+        sourceAddr,
         std::move(intfTable),
         showConfig,
     };
 }
 
+std::vector<Subscription> Config::loadGroupsFile() const {
+    std::vector<std::tuple<Subscription, bool>> parsedSubs;
+    loadSubscriptions(reloadFile_, defaultSource_, parsedSubs);
+    return mergeSubscriptions(parsedSubs, wildcard_);
+}
+
 void Config::show() const {
     auto& buf = getMemoryBuffer();
     auto bi = std::back_inserter(buf);
 
     if (not sender_) {
-        fmt::format_to(bi, "Receive from (");
-        if (source_.isDefault()) fmt::format_to(bi, "*, ");
-        else fmt::format_to(bi, "{},", source_);
-        if (not wildcard_) fmt::format_to(bi, "{}:{})", group_, dport_);
-        else fmt::format_to(bi, "{}:*)", group_);
+        fmt::format_to(bi, "Receive from ");
+        bool first{true};
+        for (auto const& sub: subscriptions_) {
+            if (not first) fmt::format_to(bi, ", ");
+            first = false;
+            fmt::format_to(bi, "(");
+            if (sub.sources.empty()) fmt::format_to(bi, "*, ");
+            else {
+                char const* sep = "";
+                for (auto source: sub.sources) {
+                    fmt::format_to(bi, "{}{}", sep, source);
+                    sep = " ";
+                }
+                fmt::format_to(bi, ",");
+            }
+            if (not wildcard_) fmt::format_to(bi, "{}:{})", sub.group, sub.dport);
+            else fmt::format_to(bi, "{}:*)", sub.group);
+        }
+        if (not dports_.all())
+            fmt::format_to(bi, ", UDP ports {}-{}", dports_.first, dports_.last);
         if (count_ > 0)
             fmt::format_to(bi, ", {} packets only", count_);
         fmt::format_to(bi, "\nShow payload: {}", (showPayload_ ? "YES" : "NO"));
+        if (output_ == OutputMode::Sampled)
+            fmt::format_to(bi, "\nOutput: one of every {} packets", sample_);
+        else if (output_ == OutputMode::StatsOnly)
+            fmt::format_to(bi, "\nOutput: statistics only");
+        if (not reloadFile_.empty())
+            fmt::format_to(bi, "\nSources update: on SIGUSR1 from {}", reloadFile_);
+        if (not pcap_.empty())
+            fmt::format_to(bi, "\nReplay: {}", pcap_);
+        if (not write_.empty()) {
+            fmt::format_to(bi, "\nWrite: {}, snaplen {}", write_, snaplen_);
+            if (rotate_ > 0)
+                fmt::format_to(bi, ", rotate at {} MiB", rotate_);
+        }
+        if (not record_.empty())
+            fmt::format_to(
+                    bi, "\nFlight recorder: {}, {} packets before and {} after "
+                    "an anomaly, snaplen {}",
+                    record_, recordDepth_, recordAfter_, recordSnaplen_);
+        if (batch_ > 0)
+            fmt::format_to(bi, "\nBatch receive: up to {} packets", batch_);
+        // The frames in the packet ring are always timestamped by the kernel
+        if (not pcap_.empty())
+            fmt::format_to(bi, "\nTimestamps: capture file");
+        else fmt::format_to(
+                bi, "\nTimestamps: {}",
+                ring_ > 0 and rxTimestamps_ == RxTimestamps::Host
+                ? "kernel software (packet ring)" : rxTimestampsName(rxTimestamps_));
+        if (threads_ > 1)
+            fmt::format_to(bi, "\nReceive threads: {}", threads_);
+        if (not cpus_.empty())
+            fmt::format_to(bi, "\nCPUs: {}", fmt::join(cpus_, ","));
+        if (hugePages_)
+            fmt::format_to(bi, "\nReceive buffers: huge pages");
+        if (ring_ > 0)
+            fmt::format_to(bi, "\nPacket ring: {} x 1MiB blocks", ring_);
+        if (ioUring_)
+            fmt::format_to(bi, "\nReceive: io_uring multishot recvmsg");
+        if (busyPoll_ > 0)
+            fmt::format_to(bi, "\nBusy poll: {}us", busyPoll_);
+        if (gro_)
+            fmt::format_to(bi, "\nUDP GRO: YES");
+        if (xdp_ != XdpMode::None)
+            fmt::format_to(
+                    bi, "\nReceive: AF_XDP, {} mode",
+                    xdp_ == XdpMode::Skb ? "generic" : "native");
+        if (zap_ > 0)
+            fmt::format_to(bi, "\nZap: {}ms per subscription", zap_);
+        if (joinRate_ > 0)
+            fmt::format_to(bi, "\nJoin rate: {} groups/sec", joinRate_);
+        if (seqField_) {
+            fmt::format_to(
+                    bi, "\nSequence number: offset {}, {} bytes, {} endian",
+                    seqField_.offset, seqField_.size,
+                    seqField_.littleEndian ? "little" : "big");
+            if (seqField_.magicSize > 0)
+                fmt::format_to(
+                        bi, ", magic {:02x} at offset {}",
+                        fmt::join(seqField_.magic.begin(),
+                                  seqField_.magic.begin() + seqField_.magicSize, ""),
+                        seqField_.magicOffset);
+        } else fmt::format_to(bi, "\nSequence number: mclst beacon");
+        if (lineB_)
+            fmt::format_to(bi, "\nLine B: {} ({})", lineB_.intf, lineB_.intfAddr);
+        if (rcvbuf_ > 0)
+            fmt::format_to(bi, "\nReceive buffer: {} bytes", rcvbuf_);
+        if (reflect_)
+            fmt::format_to(
+                    bi, "\nReflect beacons to {}:{}, TTL {}",
+                    reflect_.group, reflect_.dport, ttl_);
+        if (silence_ > 0)
+            fmt::format_to(bi, "\nSilence: flows without packets for {}ms", silence_);
+        if (dumpCorrupt_)
+            fmt::format_to(
+                    bi, "\nCRC32C: {}, dump corrupt beacons",
+                    crc32cAccelerated() ? "SSE4.2" : "portable");
     } else {
         fmt::format_to(
                 bi, "Send to {}:{}, 1pps, TTL {}",
-                group_, dport_, ttl_);
+                group(), dport(), ttl_);
         if (count_ > 0)
             fmt::format_to(bi, ", {} packets only", count_);
+        if (fill_ > 0)
+            fmt::format_to(
+                    bi, "\nFill: {} bytes with CRC32C ({})",
+                    fill_, crc32cAccelerated() ? "SSE4.2" : "portable");
+        if (rtt_)
+            fmt::format_to(
+                    bi, "\nRTT: reflections received on {}:{}",
+                    rtt_.group, rtt_.dport);
+        if (not cpus_.empty())
+            fmt::format_to(bi, "\nCPU: {}", cpus_[0]);
     }
+    if (fifo_ > 0)
+        fmt::format_to(bi, "\nScheduling: SCHED_FIFO priority {}", fifo_);
+    if (mlock_)
+        fmt::format_to(bi, "\nMemory: locked");
     fmt::format_to(bi, "\n");
-    fmt::format_to(bi, "Interface: {} ({})\n", intf_, intfAddr_);
+    if (not intf_.empty())
+        fmt::format_to(bi, "Interface: {} ({})\n", intf_, intfAddr_);
     fmt::format_to(bi, "Colors: {}\n", colors_ ? "YES" : "NO");
     fmt::format_to(bi, "\nHost interfaces:\n\n");
     formatIntfTable(bi, intfTable_, 2);
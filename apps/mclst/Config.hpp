@@ -1,13 +1,165 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "pimc/net/IPv4Address.hpp"
 #include "pimc/net/IntfTable.hpp"
 
 namespace pimc {
 
+/*!
+ * The source of the receive timestamps of the packets.
+ */
+enum class RxTimestamps: unsigned {
+    /*!
+     * The host time saved right after the poller returns.
+     */
+    Host = 0,
+
+    /*!
+     * The software timestamp taken by the kernel when the packet
+     * arrives (`SO_TIMESTAMPNS`).
+     */
+    Software = 1,
+
+    /*!
+     * The hardware timestamp taken by the NIC (`SO_TIMESTAMPING`).
+     * If the NIC or the driver do not provide it, the kernel
+     * software timestamp is used instead.
+     */
+    Hardware = 2,
+};
+
+/*!
+ * The mode in which the XDP program of the `AF_XDP` receive is attached.
+ */
+enum class XdpMode: unsigned {
+    /*!
+     * The `AF_XDP` receive is not enabled.
+     */
+    None = 0,
+
+    /*!
+     * The generic mode, in which the program runs on the socket buffers
+     * and the packets are copied into UMEM. Works on any interface.
+     */
+    Skb = 1,
+
+    /*!
+     * The native mode, in which the program runs in the driver, and the
+     * packets are received without a copy if the driver supports it.
+     */
+    Driver = 2,
+};
+
+/*!
+ * The received packets which are shown.
+ */
+enum class OutputMode: unsigned {
+    /*!
+     * Every received packet is shown.
+     */
+    Full = 0,
+
+    /*!
+     * One of every Config::sample() received packets is shown.
+     */
+    Sampled = 1,
+
+    /*!
+     * No packets are shown, they are only accounted for in the statistics
+     * shown at exit.
+     */
+    StatsOnly = 2,
+};
+
+/*!
+ * A single multicast subscription of the receiver, or the destination
+ * of the sender.
+ */
+struct Subscription final {
+    IPv4Address group;
+    // If dport is 0, the subscription is portless
+    uint16_t dport;
+    // If this is empty, we're subscribing to (*,G), otherwise to (S,G)
+    // for each source S, the sources are sorted and unique
+    std::vector<IPv4Address> sources;
+
+    /*!
+     * @return true if the subscription accepts the traffic sent by
+     * \p source
+     */
+    [[nodiscard]]
+    bool accepts(IPv4Address source) const {
+        return sources.empty() or
+               std::binary_search(sources.begin(), sources.end(), source);
+    }
+};
+
+/*!
+ * An inclusive range of the destination UDP ports.
+ */
+struct PortRange final {
+    uint16_t first;
+    uint16_t last;
+
+    /*!
+     * @return true if the range contains all the UDP ports
+     */
+    [[nodiscard]]
+    bool all() const { return first <= 1 and last == 65535; }
+
+    [[nodiscard]]
+    bool contains(uint16_t port) const { return port >= first and port <= last; }
+};
+
+/*!
+ * The interface on which the B line of a redundant A/B feed is received,
+ * whereas the A line is received on the main interface.
+ */
+struct LineB final {
+    std::string intf;
+    IPv4Address intfAddr;
+    // 0 if the B line is not configured
+    unsigned ifIndex;
+
+    explicit operator bool() const { return ifIndex != 0; }
+};
+
+/*!
+ * The location of the sequence number in the UDP payload of the packets
+ * of a feed other than the mclst beacons, and optionally the magic bytes
+ * which identify the packets that carry it.
+ */
+struct SeqField final {
+    uint16_t offset;
+    // 0 if the sequence number of the mclst beacon is used
+    uint8_t size;
+    bool littleEndian;
+    uint16_t magicOffset;
+    // 0 if every packet carries the sequence number
+    uint8_t magicSize;
+    std::array<uint8_t, 8> magic;
+
+    explicit operator bool() const { return size != 0; }
+};
+
+/*!
+ * The group and the destination port to which the receiver reflects the
+ * mclst beacons, and on which the sender receives the reflections.
+ */
+struct ReturnGroup final {
+    IPv4Address group;
+    // 0 if the beacons are not reflected
+    uint16_t dport;
+
+    explicit operator bool() const { return dport != 0; }
+};
+
 class Config final {
 public:
     static Config fromArgs(int argc, char** argv);
@@ -17,31 +169,58 @@ public:
     Config& operator= (Config const&) = delete;
     Config& operator= (Config&&) noexcept = default;
 
+    /*!
+     * Returns the subscriptions of the receiver. In the sender mode there
+     * is exactly one subscription which is the destination of the sent
+     * traffic.
+     *
+     * @return the subscriptions
+     */
+    [[nodiscard]]
+    std::vector<Subscription> const& subscriptions() const {
+        return subscriptions_;
+    }
+
+    /*!
+     * @return the group of the first subscription, which in the sender
+     * mode is the only one
+     */
     [[nodiscard]]
-    IPv4Address group() const { return group_; }
+    IPv4Address group() const { return subscriptions_.front().group; }
 
+    /*!
+     * @return the destination port of the first subscription, which in
+     * the sender mode is the only one
+     */
     [[nodiscard]]
-    uint16_t dport() const { return dport_; }
+    uint16_t dport() const { return subscriptions_.front().dport; }
 
+    /*!
+     * If true, all subscriptions are portless, i.e. the traffic destined
+     * for the subscribed groups and any UDP ports is received.
+     *
+     * @return true if the subscriptions are portless, false otherwise
+     */
     [[nodiscard]]
     bool wildcard() const { return wildcard_; }
 
+    /*!
+     * The destination UDP ports of the traffic received with the portless
+     * subscriptions.
+     *
+     * @return the range of the destination UDP ports
+     */
+    [[nodiscard]]
+    PortRange dports() const { return dports_; }
+
     [[nodiscard]]
     std::string const& intf() const { return intf_; }
 
     [[nodiscard]]
     IPv4Address intfAddr() const { return intfAddr_; }
 
-    /*!
-     * If the returned address is default, the subscription is (*,G),
-     * otherwise it's (S,G) where S is the value returned by this
-     * function
-     *
-     * @return the multicast source for the source specific subscriptions,
-     * or the default address for the any-source subscriptions.
-     */
     [[nodiscard]]
-    IPv4Address source() const { return source_; }
+    unsigned intfIndex() const { return intfIndex_; }
 
     [[nodiscard]]
     unsigned timeoutSec() const { return timeoutSec_; }
@@ -61,6 +240,294 @@ public:
     [[nodiscard]]
     bool colors() const { return colors_; }
 
+    /*!
+     * If the returned value is 0, the receiver reads a single packet
+     * per poller wakeup, otherwise it drains the socket using batches
+     * of the returned number of packets.
+     *
+     * @return the receive batch size or 0 if batching is disabled
+     */
+    [[nodiscard]]
+    unsigned batch() const { return batch_; }
+
+    [[nodiscard]]
+    RxTimestamps rxTimestamps() const { return rxTimestamps_; }
+
+    /*!
+     * The number of the receive threads among which the subscriptions
+     * are sharded. It never exceeds the number of the subscriptions.
+     *
+     * @return the number of the receive threads
+     */
+    [[nodiscard]]
+    unsigned threads() const { return threads_; }
+
+    /*!
+     * If not empty, the receive thread \f$i\f$ is pinned to the CPU
+     * at index \f$i \bmod n\f$ of the returned vector of \f$n\f$ CPUs,
+     * and the sender is pinned to the first CPU.
+     *
+     * @return the CPUs to which the receive threads are pinned
+     */
+    [[nodiscard]]
+    std::vector<unsigned> const& cpus() const { return cpus_; }
+
+    /*!
+     * If true, the sockets are read using multishot receive requests of
+     * an `io_uring` instance, unless the kernel does not support it.
+     *
+     * @return true if the `io_uring` receive is enabled
+     */
+    [[nodiscard]]
+    bool ioUring() const { return ioUring_; }
+
+    /*!
+     * If the returned value is not 0, the receive threads spin on the
+     * non-blocking sockets instead of waiting for them to become readable
+     * and the sockets busy poll the device queue for the returned number
+     * of microseconds.
+     *
+     * @return the socket busy poll time in microseconds or 0 if not enabled
+     */
+    [[nodiscard]]
+    unsigned busyPoll() const { return busyPoll_; }
+
+    /*!
+     * If true, the kernel coalesces the datagrams of a flow into the
+     * UDP GRO super-datagrams, which are split back into the individual
+     * datagrams after they are received.
+     *
+     * @return true if the UDP GRO receive is enabled
+     */
+    [[nodiscard]]
+    bool gro() const { return gro_; }
+
+    /*!
+     * If not XdpMode::None, the portless subscriptions are received from
+     * the `AF_XDP` sockets, to which the packets are redirected by an XDP
+     * program attached in the returned mode.
+     *
+     * @return the mode of the XDP program
+     */
+    [[nodiscard]]
+    XdpMode xdp() const { return xdp_; }
+
+    /*!
+     * If the returned value is not 0, the subscriptions of each receive
+     * thread are joined one at a time for the returned number of
+     * milliseconds each, and the join and leave latencies are measured.
+     *
+     * @return the zap dwell time in milliseconds or 0 if not enabled
+     */
+    [[nodiscard]]
+    unsigned zap() const { return zap_; }
+
+    /*!
+     * If the returned value is not 0, the subscriptions are joined at the
+     * returned rate rather than all at once, and the arrival of the
+     * traffic is accounted for each subscription.
+     *
+     * @return the number of the subscriptions joined per second or 0 if
+     * the subscriptions are joined all at once
+     */
+    [[nodiscard]]
+    unsigned joinRate() const { return joinRate_; }
+
+    /*!
+     * If configured, the subscriptions are also joined on the interface
+     * of the B line and the packets of the A and B lines are arbitrated.
+     *
+     * @return the B line
+     */
+    [[nodiscard]]
+    LineB const& lineB() const { return lineB_; }
+
+    /*!
+     * @return the location of the sequence number by which the gaps and
+     * the duplicates of the flows are detected and the packets of the A
+     * and B lines are matched, unless the mclst beacons are used
+     */
+    [[nodiscard]]
+    SeqField seqField() const { return seqField_; }
+
+    /*!
+     * If the returned value is not 0, the receive buffers of the sockets
+     * are forced to the returned size, regardless of the system limit.
+     *
+     * @return the receive buffer size in bytes or 0 if the default size
+     * is used
+     */
+    [[nodiscard]]
+    unsigned rcvbuf() const { return rcvbuf_; }
+
+    /*!
+     * If configured, the receiver sends each received mclst beacon
+     * unmodified to the returned group, so that its sender can measure
+     * the round trip time.
+     *
+     * @return the group to which the beacons are reflected
+     */
+    [[nodiscard]]
+    ReturnGroup reflect() const { return reflect_; }
+
+    /*!
+     * If configured, the sender receives the beacons reflected by the
+     * receivers on the returned group and measures the round trip time.
+     *
+     * @return the group on which the reflections are received
+     */
+    [[nodiscard]]
+    ReturnGroup rtt() const { return rtt_; }
+
+    /*!
+     * If the returned value is not 0, the portless subscriptions are
+     * received from a memory mapped packet ring of the returned number
+     * of blocks instead of a raw IP socket.
+     *
+     * @return the number of packet ring blocks or 0 if not enabled
+     */
+    [[nodiscard]]
+    unsigned ring() const { return ring_; }
+
+    /*!
+     * If the returned value is not 0, the sender pads the beacons to the
+     * returned UDP payload size with a deterministic pattern and ends them
+     * with the CRC32C of the payload.
+     *
+     * @return the UDP payload size of the beacons or 0 if not padded
+     */
+    [[nodiscard]]
+    unsigned fill() const { return fill_; }
+
+    /*!
+     * @return true if the payload of the beacons whose CRC32C does not
+     * match is shown
+     */
+    [[nodiscard]]
+    bool dumpCorrupt() const { return dumpCorrupt_; }
+
+    /*!
+     * @return the number of milliseconds without packets after which a
+     * flow is reported silent or 0 if the flows are not tracked
+     */
+    [[nodiscard]]
+    unsigned silence() const { return silence_; }
+
+    /*!
+     * @return the received packets which are shown
+     */
+    [[nodiscard]]
+    OutputMode output() const { return output_; }
+
+    /*!
+     * @return the number of the received packets of which one is shown if
+     * output() is OutputMode::Sampled
+     */
+    [[nodiscard]]
+    unsigned sample() const { return sample_; }
+
+    /*!
+     * @return the `SCHED_FIFO` priority of the receive threads or the
+     * sender or 0 if they are run under the default policy
+     */
+    [[nodiscard]]
+    unsigned fifo() const { return fifo_; }
+
+    /*!
+     * @return true if the memory is locked and the receive buffers and
+     * the thread stacks are prefaulted
+     */
+    [[nodiscard]]
+    bool mlock() const { return mlock_; }
+
+    /*!
+     * @return true if the receive buffers are backed by the huge pages
+     */
+    [[nodiscard]]
+    bool hugePages() const { return hugePages_; }
+
+    /*!
+     * If not empty, the accepted packets are written to the returned
+     * pcapng file.
+     *
+     * @return the name of the capture file or an empty string
+     */
+    [[nodiscard]]
+    std::string const& write() const { return write_; }
+
+    /*!
+     * @return the maximum number of the bytes of each packet written to
+     * the capture file
+     */
+    [[nodiscard]]
+    unsigned snaplen() const { return snaplen_; }
+
+    /*!
+     * @return the size in MiB at which the capture file is rotated or 0
+     * if the capture is written to a single file
+     */
+    [[nodiscard]]
+    unsigned rotate() const { return rotate_; }
+
+    /*!
+     * If not empty, the last received packets are kept by the flight
+     * recorder and dumped to the returned pcapng file on an anomaly.
+     *
+     * @return the name of the dump file or an empty string
+     */
+    [[nodiscard]]
+    std::string const& record() const { return record_; }
+
+    /*!
+     * @return the number of the last packets kept by the flight recorder
+     * of each receive thread
+     */
+    [[nodiscard]]
+    unsigned recordDepth() const { return recordDepth_; }
+
+    /*!
+     * @return the number of the packets dumped after an anomaly
+     */
+    [[nodiscard]]
+    unsigned recordAfter() const { return recordAfter_; }
+
+    /*!
+     * @return the maximum number of the bytes of each packet kept by the
+     * flight recorder
+     */
+    [[nodiscard]]
+    unsigned recordSnaplen() const { return recordSnaplen_; }
+
+    /*!
+     * If not empty, the packets are read from the returned pcap or pcapng
+     * capture file instead of being received from the network.
+     *
+     * @return the name of the capture file or an empty string
+     */
+    [[nodiscard]]
+    std::string const& pcap() const { return pcap_; }
+
+    /*!
+     * If not empty, the source lists of the subscriptions loaded from the
+     * returned groups file are updated in place when `SIGUSR1` is
+     * received, see loadGroupsFile().
+     *
+     * @return the name of the groups file or an empty string
+     */
+    [[nodiscard]]
+    std::string const& reloadFile() const { return reloadFile_; }
+
+    /*!
+     * \brief Loads the subscriptions from the groups file returned by
+     * reloadFile() once again.
+     *
+     * @return the subscriptions in the file
+     * @throw CommandLineError if the file cannot be loaded or holds an
+     * invalid subscription
+     */
+    [[nodiscard]]
+    std::vector<Subscription> loadGroupsFile() const;
+
     [[nodiscard]]
     IntfTable const& intfTable() const { return intfTable_; };
 
@@ -71,50 +538,151 @@ public:
 
 private:
     Config(
-        IPv4Address group,
-        uint16_t dport,
+        std::vector<Subscription> subscriptions,
         bool wildcard,
+        PortRange dports,
         std::string intf,
         IPv4Address intfAddr,
-        IPv4Address source,
+        unsigned intfIndex,
         unsigned timeoutSec,
         bool sender,
         unsigned ttl,
         uint64_t count,
         bool showPayload,
         bool colors,
+        unsigned batch,
+        RxTimestamps rxTimestamps,
+        unsigned threads,
+        std::vector<unsigned> cpus,
+        unsigned ring,
+        bool ioUring,
+        unsigned busyPoll,
+        bool gro,
+        XdpMode xdp,
+        unsigned zap,
+        unsigned joinRate,
+        LineB lineB,
+        SeqField seqField,
+        unsigned rcvbuf,
+        ReturnGroup reflect,
+        ReturnGroup rtt,
+        unsigned fill,
+        bool dumpCorrupt,
+        unsigned silence,
+        OutputMode output,
+        unsigned sample,
+        unsigned fifo,
+        bool mlock,
+        bool hugePages,
+        std::string write,
+        unsigned snaplen,
+        unsigned rotate,
+        std::string record,
+        unsigned recordDepth,
+        unsigned recordAfter,
+        unsigned recordSnaplen,
+        std::string pcap,
+        std::string reloadFile,
+        IPv4Address defaultSource,
         IntfTable intfTable,
         bool showConfig)
-        : group_{group}
-        , dport_{dport}
+        : subscriptions_{std::move(subscriptions)}
         , wildcard_{wildcard}
+        , dports_{dports}
         , intf_{std::move(intf)}
         , intfAddr_{intfAddr}
-        , source_{source}
+        , intfIndex_{intfIndex}
         , timeoutSec_{timeoutSec}
         , sender_{sender}
         , ttl_{ttl}
         , count_{count}
         , showPayload_{showPayload}
         , colors_{colors}
+        , batch_{batch}
+        , rxTimestamps_{rxTimestamps}
+        , threads_{threads}
+        , cpus_{std::move(cpus)}
+        , ring_{ring}
+        , ioUring_{ioUring}
+        , busyPoll_{busyPoll}
+        , gro_{gro}
+        , xdp_{xdp}
+        , zap_{zap}
+        , joinRate_{joinRate}
+        , lineB_{std::move(lineB)}
+        , seqField_{seqField}
+        , rcvbuf_{rcvbuf}
+        , reflect_{reflect}
+        , rtt_{rtt}
+        , fill_{fill}
+        , dumpCorrupt_{dumpCorrupt}
+        , silence_{silence}
+        , output_{output}
+        , sample_{sample}
+        , fifo_{fifo}
+        , mlock_{mlock}
+        , hugePages_{hugePages}
+        , write_{std::move(write)}
+        , snaplen_{snaplen}
+        , rotate_{rotate}
+        , record_{std::move(record)}
+        , recordDepth_{recordDepth}
+        , recordAfter_{recordAfter}
+        , recordSnaplen_{recordSnaplen}
+        , pcap_{std::move(pcap)}
+        , reloadFile_{std::move(reloadFile)}
+        , defaultSource_{defaultSource}
         , intfTable_{std::move(intfTable)}
         , showConfig_{showConfig} {}
 
 private:
-    IPv4Address group_;
-    uint16_t dport_;
+    std::vector<Subscription> subscriptions_;
     bool wildcard_;
+    PortRange dports_;
     std::string intf_;
     IPv4Address intfAddr_;
-    // If this is 0.0.0.0, we're subscribing to (*,G)
-    // otherwise to (S,G) where S is the source_
-    IPv4Address source_;
+    unsigned intfIndex_;
     unsigned timeoutSec_;
     bool sender_;
     unsigned ttl_;
     uint64_t count_;
     bool showPayload_;
     bool colors_;
+    unsigned batch_;
+    RxTimestamps rxTimestamps_;
+    unsigned threads_;
+    std::vector<unsigned> cpus_;
+    unsigned ring_;
+    bool ioUring_;
+    unsigned busyPoll_;
+    bool gro_;
+    XdpMode xdp_;
+    unsigned zap_;
+    unsigned joinRate_;
+    LineB lineB_;
+    SeqField seqField_;
+    unsigned rcvbuf_;
+    ReturnGroup reflect_;
+    ReturnGroup rtt_;
+    unsigned fill_;
+    bool dumpCorrupt_;
+    unsigned silence_;
+    OutputMode output_;
+    unsigned sample_;
+    unsigned fifo_;
+    bool mlock_;
+    bool hugePages_;
+    std::string write_;
+    unsigned snaplen_;
+    unsigned rotate_;
+    std::string record_;
+    unsigned recordDepth_;
+    unsigned recordAfter_;
+    unsigned recordSnaplen_;
+    std::string pcap_;
+    std::string reloadFile_;
+    // The source of the subscriptions which do not specify their own
+    IPv4Address defaultSource_;
     IntfTable intfTable_;
     bool showConfig_;
 };
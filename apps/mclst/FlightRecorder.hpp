@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+
+#include "MappedBuffer.hpp"
+#include "PacketInfo.hpp"
+#include "PcapngWriter.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief A dump of the flight recorder started by an anomaly.
+ */
+struct FlightDump final {
+    std::string fn;
+    // The number of the packets preceding the anomaly in the dump
+    unsigned before;
+    // The number of the packets following the anomaly to be dumped
+    unsigned after;
+};
+
+/*!
+ * \brief Keeps the last packets received by a receive thread, so that
+ * the packets around an anomaly can be dumped to a pcapng file.
+ *
+ * The packets are kept in a ring of slots of the snapshot length, which
+ * is mapped and prefaulted once like the receive buffers, so recording a
+ * packet only copies its first bytes and never allocates. Once an anomaly
+ * triggers the recorder, the packets in the ring are written to the next
+ * dump file followed by the packets which arrive after the anomaly.
+ * Another anomaly during a dump extends the dump rather than starting a
+ * new one.
+ *
+ * The dumps are written by the receive thread itself through a large
+ * output buffer, so a dump costs the receive a few `write()` calls, but
+ * the recording of the packets costs nothing else.
+ */
+class FlightRecorder final {
+    struct Slot final {
+        uint64_t timestamp;
+        unsigned ifIndex;
+        unsigned capLen;
+        unsigned origLen;
+    };
+
+public:
+    /*!
+     * @param fn the name of the dump files, into which the number of the
+     * dump is inserted, see numberedFileName()
+     * @param depth the number of the packets kept in the ring
+     * @param after the number of the packets dumped after an anomaly
+     * @param snaplen the maximum number of the kept bytes per packet
+     * @param hugePages true if the ring is backed by the huge pages
+     * @param node the NUMA node on which the ring is allocated or -1
+     * @param dumps the number of the dump files named by all recorders
+     */
+    FlightRecorder(
+            std::string fn, unsigned depth, unsigned after, unsigned snaplen,
+            bool hugePages, int node, std::atomic<unsigned>& dumps)
+    : fn_{std::move(fn)}, depth_{depth}, after_{after}, snaplen_{snaplen}
+    , slots_(depth), data_{std::size_t{depth} * snaplen, hugePages, node}
+    , next_{0}, count_{0}, remaining_{0}, file_{snaplen}, dumps_{dumps} {}
+
+    /*!
+     * \brief Keeps the packet \p pktInfo in the ring and writes it to the
+     * dump if one is in progress.
+     *
+     * @param raw true if the packet has been received with its headers,
+     * even though it has not been dissected
+     */
+    PIMC_ALWAYS_INLINE
+    void record(PacketInfo const& pktInfo, bool raw) {
+        auto hdrLen = raw ? 0 : capturedHeadersLen(pktInfo);
+        auto origLen = hdrLen + pktInfo.receivedSize;
+        auto capLen = std::min(origLen, snaplen_);
+
+        auto& slot = slots_[next_];
+        slot = Slot{.timestamp = pktInfo.timestamp, .ifIndex = pktInfo.ifIndex,
+                    .capLen = capLen, .origLen = origLen};
+        auto* p = data_.data() + std::size_t{next_} * snaplen_;
+        copyCaptured(p, pktInfo, hdrLen, capLen);
+
+        if (++next_ == depth_) next_ = 0;
+        count_ = std::min(count_ + 1, depth_);
+
+        if (PIMC_UNLIKELY(remaining_ > 0)) {
+            file_.writePacket(slot.timestamp, slot.ifIndex, p, capLen, origLen);
+            if (--remaining_ == 0) file_.close();
+        }
+    }
+
+    /*!
+     * \brief Dumps the packets in the ring to the next dump file and
+     * keeps dumping the packets which follow.
+     *
+     * @return the dump which has been started or nothing if the dump in
+     * progress has been extended instead
+     */
+    std::optional<FlightDump> trigger() {
+        if (remaining_ > 0) {
+            remaining_ = after_;
+            return std::nullopt;
+        }
+
+        file_.open(numberedFileName(
+                fn_, dumps_.fetch_add(1, std::memory_order_relaxed)));
+
+        // The oldest packet is the next one to be overwritten
+        auto first = count_ < depth_ ? 0 : next_;
+        for (unsigned i = 0; i < count_; ++i) {
+            auto n = (first + i) % depth_;
+            auto const& slot = slots_[n];
+            auto const* p = data_.data() + std::size_t{n} * snaplen_;
+            file_.writePacket(
+                    slot.timestamp, slot.ifIndex, p, slot.capLen, slot.origLen);
+        }
+
+        remaining_ = after_;
+        if (remaining_ == 0) file_.close();
+
+        return FlightDump{.fn = file_.fileName(), .before = count_, .after = after_};
+    }
+
+    /*!
+     * \brief Closes the dump in progress, which then has fewer packets
+     * after the anomaly than configured.
+     */
+    void stop() {
+        remaining_ = 0;
+        file_.close();
+    }
+
+private:
+    std::string fn_;
+    unsigned depth_;
+    unsigned after_;
+    unsigned snaplen_;
+    std::vector<Slot> slots_;
+    MappedBuffer data_;
+    // The slot in which the next packet is kept
+    unsigned next_;
+    // The number of the packets in the ring
+    unsigned count_;
+    // The number of the packets still to be dumped after the anomaly
+    unsigned remaining_;
+    PcapngWriter file_;
+    std::atomic<unsigned>& dumps_;
+};
+
+} // namespace pimc
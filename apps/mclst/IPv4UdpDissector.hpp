@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/core/Endian.hpp"
+#include "pimc/formatters/Fmt.hpp"
+#include "pimc/packets/PacketView.hpp"
+#include "pimc/packets/IPv4HdrView.hpp"
+#include "pimc/packets/UDPHdrView.hpp"
+
+#include "Config.hpp"
+#include "OutputHandler.hpp"
+#include "PacketInfo.hpp"
+#include "ReceiverBase.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief Dissects the IPv4/UDP headers of the packets received by the
+ * portless receivers, which receive the packets starting with the IPv4
+ * header.
+ *
+ * The packets which are not UDP, are not destined for any of the
+ * subscribed groups, are not sent by the source of a source specific
+ * subscription or are not destined for the configured range of the UDP
+ * ports are filtered out. Normally most of them are already dropped in
+ * the kernel by RxFilter.
+ *
+ * The packets read from a capture file are dissected for the
+ * subscriptions which specify the destination port as well, in which
+ * case the packets are matched by the group, the destination port and
+ * the source of each subscription.
+ */
+class IPv4UdpDissector final {
+public:
+    IPv4UdpDissector(Config const& cfg, OutputHandler& oh)
+    : oh_{oh}, dports_{cfg.dports()} {
+        for (auto const& sub: cfg.subscriptions()) {
+            auto add = [this, &cfg, &sub] (uint32_t sourceNl) {
+                if (cfg.wildcard())
+                    groupsNl_.emplace_back(sub.group.to_nl(), sourceNl);
+                else {
+                    // The source is matched along with the destination port
+                    groupsNl_.emplace_back(sub.group.to_nl(), 0);
+                    flowsNl_.emplace_back(
+                            std::make_pair(sub.group.to_nl(), sub.dport), sourceNl);
+                }
+            };
+
+            if (sub.sources.empty()) add(0);
+            for (auto source: sub.sources)
+                add(source.to_nl());
+        }
+        std::sort(groupsNl_.begin(), groupsNl_.end());
+        groupsNl_.erase(std::unique(groupsNl_.begin(), groupsNl_.end()), groupsNl_.end());
+        std::sort(flowsNl_.begin(), flowsNl_.end());
+    }
+
+    /*!
+     * \brief Dissects the packet in `pktInfo.received` and populates the
+     * source, the ports, the group and the payload in \p pktInfo.
+     *
+     * If \p pktInfo has no TTL, the TTL is taken from the IPv4 header.
+     *
+     * @param pktInfo the received packet
+     * @return the status of the packet
+     */
+    auto dissect(PacketInfo& pktInfo) -> PacketStatus {
+        PacketView pv{pktInfo.received, pktInfo.receivedSize};
+
+        IPv4HdrView ipHdr;
+        if (PIMC_UNLIKELY(not pv.take(IPv4HdrView::HdrSize, [&ipHdr] (auto const* p) {
+            ipHdr = p;
+        }))) {
+            oh_.warningTs(
+                    pktInfo.timestamp,
+                    "received packet size {} is smaller than the minimum "
+                    "IPv4 header size {}",
+                    pktInfo.receivedSize, IPv4HdrView::HdrSize);
+            return PacketStatus::Filtered;
+        }
+
+        if (PIMC_UNLIKELY(not subscribed(ipHdr.daddr(), ipHdr.saddr())))
+            return PacketStatus::Filtered;
+        if (PIMC_UNLIKELY(ipHdr.protocol() != UDPProto)) return PacketStatus::Filtered;
+        pktInfo.group = IPv4Address::from_nl(ipHdr.daddr());
+
+        auto effIPHdrSize = ipHdr.headerSizeBytes();
+        if (PIMC_UNLIKELY(effIPHdrSize < IPv4HdrView::HdrSize)) {
+            // This will really never happen
+            oh_.warningTs(
+                    pktInfo.timestamp,
+                    "corrupted IPv4 header: header size in header is {} "
+                    "whereas the minimum header size is {}",
+                    effIPHdrSize, IPv4HdrView::HdrSize);
+            return PacketStatus::AcceptedNoShow;
+        }
+
+        if (PIMC_UNLIKELY(not pv.skip(effIPHdrSize - IPv4HdrView::HdrSize))) {
+            // This can also not really happen...
+            oh_.warningTs(
+                    pktInfo.timestamp,
+                    "received packet size {} is smaller than the actual "
+                    "IPv4 header size {}",
+                    pktInfo.receivedSize, IPv4HdrView::HdrSize);
+            return PacketStatus::AcceptedNoShow;
+        }
+
+        UDPHdrView udpHdr;
+        if (PIMC_UNLIKELY(not pv.take(UDPHdrView::HdrSize, [&udpHdr] (auto const* p) {
+            udpHdr = p;
+        }))) {
+            oh_.warningTs(
+                    pktInfo.timestamp,
+                    "received packet size {} is insufficient for IPv4 "
+                    "and UDP headers ({} + {} = {})",
+                    pktInfo.receivedSize, effIPHdrSize, UDPHdrView::HdrSize,
+                    effIPHdrSize + UDPHdrView::HdrSize);
+            return PacketStatus::AcceptedNoShow;
+        }
+
+        pktInfo.dport = ntohs(udpHdr.dport());
+        if (PIMC_UNLIKELY(not dports_.contains(pktInfo.dport)))
+            return PacketStatus::Filtered;
+        if (not flowsNl_.empty() and
+            not subscribed(ipHdr.daddr(), pktInfo.dport, ipHdr.saddr()))
+            return PacketStatus::Filtered;
+        pktInfo.source = IPv4Address::from_nl(ipHdr.saddr());
+        pktInfo.sport = ntohs(udpHdr.sport());
+
+        auto ipTTL = static_cast<int16_t>(ipHdr.ttl());
+        if (PIMC_UNLIKELY(pktInfo.ttl != ipTTL)) {
+            if (pktInfo.ttl != -1)
+                oh_.warningTs(
+                        pktInfo.timestamp,
+                        "in packet {}:{}->{}:{} TTL received from recvmsg() is {} "
+                        "whereas the TTL in the IPv4 header is {}, overriding",
+                        pktInfo.source, pktInfo.sport, pktInfo.group, pktInfo.dport,
+                        pktInfo.ttl, ipTTL);
+            pktInfo.ttl = ipTTL;
+        }
+
+        auto remSize = pv.remaining();
+        uint16_t udpSize = ntohs(udpHdr.len());
+
+        if (PIMC_UNLIKELY(udpSize < UDPHdrView::HdrSize)) {
+            oh_.warningTs(
+                    pktInfo.timestamp,
+                    "in packet {}:{}->{}:{} UDP size {} is less than the UDP header size {}",
+                    pktInfo.source, pktInfo.sport, pktInfo.group, pktInfo.dport,
+                    udpSize, UDPHdrView::HdrSize);
+            return PacketStatus::AcceptedNoShow;
+        }
+        // The length in the UDP header includes the size of the UDP headers, thus
+        // to get the UDP payload length we need to subtract the UDP header size
+        // from the original value
+        udpSize -= static_cast<uint16_t>(UDPHdrView::HdrSize);
+
+        if (PIMC_UNLIKELY(udpSize > remSize)) {
+            oh_.warningTs(
+                    pktInfo.timestamp,
+                    "in packet {}:{}->{}:{} UDP size {} is larger than the "
+                    "size of the data after the IPv4 and UDP headers, which is {}",
+                    pktInfo.source, pktInfo.sport, pktInfo.group, pktInfo.dport,
+                    udpSize, remSize);
+            return PacketStatus::AcceptedNoShow;
+        }
+
+        if (PIMC_UNLIKELY(udpSize < remSize)) {
+            oh_.warningTs(
+                    pktInfo.timestamp,
+                    "in packet {}:{}->{}:{} UDP size {} is less than the "
+                    "size of the data after the IPv4 and UDP headers, which is {}",
+                    pktInfo.source, pktInfo.sport, pktInfo.group, pktInfo.dport,
+                    udpSize, remSize);
+        }
+
+        pktInfo.payloadOffset = static_cast<uint16_t>(pv.taken());
+        pktInfo.payloadSize = udpSize;
+
+        return PacketStatus::AcceptedShow;
+    }
+
+private:
+    PIMC_ALWAYS_INLINE
+    bool subscribed(uint32_t daddr, uint32_t saddr) const {
+        auto allowed = [saddr] (auto const& gs) {
+            return gs.second == 0 or gs.second == saddr;
+        };
+
+        if (PIMC_LIKELY(groupsNl_.size() == 1))
+            return daddr == groupsNl_.front().first and allowed(groupsNl_.front());
+
+        // The group is either not source specific, in which case its
+        // only entry has the source 0, or has an entry per source
+        auto it = std::lower_bound(
+                groupsNl_.begin(), groupsNl_.end(), std::make_pair(daddr, 0u));
+        if (it == groupsNl_.end() or it->first != daddr) return false;
+        return it->second == 0 or
+               std::binary_search(it, groupsNl_.end(), std::make_pair(daddr, saddr));
+    }
+
+    PIMC_ALWAYS_INLINE
+    bool subscribed(uint32_t daddr, uint16_t dport, uint32_t saddr) const {
+        auto gp = std::make_pair(daddr, dport);
+        auto it = std::lower_bound(
+                flowsNl_.begin(), flowsNl_.end(), std::make_pair(gp, 0u));
+        if (it == flowsNl_.end() or it->first != gp) return false;
+        return it->second == 0 or
+               std::binary_search(it, flowsNl_.end(), std::make_pair(gp, saddr));
+    }
+
+private:
+    OutputHandler& oh_;
+    PortRange dports_;
+    // The subscribed groups and their sources, 0 if the subscription is
+    // not source specific, in the network byte order, sorted by the group
+    std::vector<std::pair<uint32_t, uint32_t>> groupsNl_;
+    // The subscribed groups and destination ports and their sources if
+    // the subscriptions specify the destination port, sorted likewise,
+    // there is an entry per source of the source specific subscriptions
+    std::vector<std::pair<std::pair<uint32_t, uint16_t>, uint32_t>> flowsNl_;
+};
+
+} // namespace pimc
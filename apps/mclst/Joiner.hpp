@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/net/IPv4Address.hpp"
+#include "pimc/time/TimeUtils.hpp"
+
+#include "Config.hpp"
+#include "LatencyHistogram.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The arrival statistics of the subscriptions joined by the joiners
+ * of the receive threads.
+ */
+struct JoinStats final {
+    // From the join to the first packet of each subscription
+    LatencyHistogram joins;
+    uint64_t subscriptions{0};
+    uint64_t joined{0};
+    // The host times of the first and the last join
+    uint64_t firstJoinAt{std::numeric_limits<uint64_t>::max()};
+    uint64_t lastJoinAt{0};
+    // The joined subscriptions which have received no traffic
+    std::vector<Subscription> silent;
+
+    void merge(JoinStats const& other) {
+        joins.merge(other.joins);
+        subscriptions += other.subscriptions;
+        joined += other.joined;
+        firstJoinAt = std::min(firstJoinAt, other.firstJoinAt);
+        lastJoinAt = std::max(lastJoinAt, other.lastJoinAt);
+        silent.insert(silent.end(), other.silent.begin(), other.silent.end());
+    }
+};
+
+/*!
+ * \brief Joins the subscriptions of a receive thread at a steady rate
+ * rather than all at once, and accounts for the traffic arriving for each
+ * of them.
+ *
+ * Joining thousands of groups in a burst floods the network with the
+ * membership reports and the snooping switches with the state changes,
+ * so the joins are spread evenly over time. If the receive thread falls
+ * behind, the overdue joins are made at once.
+ *
+ * The subscription of a packet is found in a hash table keyed by the
+ * group and the destination port, so the accounting takes constant time
+ * per packet regardless of the number of the subscriptions.
+ */
+class Joiner final {
+public:
+    /*!
+     * @param intervalNs the time between the consecutive joins
+     * @param wildcard if true, the subscriptions are portless and the
+     * packets are matched by the group only
+     */
+    Joiner(uint64_t intervalNs, bool wildcard)
+    : intervalNs_{intervalNs}, wildcard_{wildcard}, next_{0}, startNs_{0} {}
+
+    void add(int fd, Subscription const& sub) {
+        index_.emplace(key(sub.group, sub.dport), static_cast<uint32_t>(arrivals_.size()));
+        arrivals_.push_back(Arrival{.fd = fd, .sub = sub, .joinedAt = 0, .firstAt = 0});
+    }
+
+    /*!
+     * @return the host time in nanoseconds when the next join is due, or
+     * the maximum value if all the subscriptions have been joined
+     */
+    [[nodiscard]]
+    uint64_t deadline() const {
+        if (next_ == arrivals_.size())
+            return std::numeric_limits<uint64_t>::max();
+        return startNs_ + next_ * intervalNs_;
+    }
+
+    /*!
+     * \brief Joins the subscriptions which are due at \p now.
+     *
+     * The first call starts the schedule.
+     *
+     * @param now the current host time in nanoseconds
+     * @param join the callable taking the socket and the Subscription
+     * const& to join on it
+     */
+    template <typename Join>
+    void joinDue(uint64_t now, Join&& join) {
+        if (startNs_ == 0) startNs_ = now;
+
+        while (next_ < arrivals_.size() and deadline() <= now) {
+            auto& arrival = arrivals_[next_++];
+            arrival.joinedAt = gethostnanos();
+            join(arrival.fd, arrival.sub);
+        }
+    }
+
+    /*!
+     * \brief Accounts for a packet destined for \p group and \p dport
+     * received at \p ts.
+     */
+    void onPacket(IPv4Address group, uint16_t dport, uint64_t ts) {
+        auto it = index_.find(key(group, dport));
+        if (PIMC_UNLIKELY(it == index_.end())) return;
+
+        auto& arrival = arrivals_[it->second];
+        if (arrival.firstAt == 0 and arrival.joinedAt != 0 and ts >= arrival.joinedAt)
+            arrival.firstAt = ts;
+    }
+
+    /*!
+     * @return the arrival statistics of the subscriptions
+     */
+    [[nodiscard]]
+    JoinStats stats() const {
+        JoinStats js;
+        js.subscriptions = arrivals_.size();
+        for (auto const& arrival: arrivals_) {
+            if (arrival.joinedAt == 0) continue;
+
+            ++js.joined;
+            js.firstJoinAt = std::min(js.firstJoinAt, arrival.joinedAt);
+            js.lastJoinAt = std::max(js.lastJoinAt, arrival.joinedAt);
+            if (arrival.firstAt != 0)
+                js.joins.record(arrival.firstAt - arrival.joinedAt);
+            else js.silent.push_back(arrival.sub);
+        }
+
+        return js;
+    }
+
+private:
+    struct Arrival final {
+        int fd;
+        Subscription sub;
+        uint64_t joinedAt;
+        uint64_t firstAt;
+    };
+
+    [[nodiscard]]
+    uint64_t key(IPv4Address group, uint16_t dport) const {
+        return (static_cast<uint64_t>(group.value()) << 16u) | (wildcard_ ? 0u : dport);
+    }
+
+private:
+    uint64_t intervalNs_;
+    bool wildcard_;
+    std::size_t next_;
+    uint64_t startNs_;
+    std::vector<Arrival> arrivals_;
+    std::unordered_map<uint64_t, uint32_t> index_;
+};
+
+} // namespace pimc
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace pimc {
+
+/*!
+ * \brief A histogram of the latencies in nanoseconds with the log-linear
+ * buckets.
+ *
+ * The values below 2^SubBits nanoseconds have a bucket each. Above that
+ * every power of two range is split into 2^SubBits equal buckets, so the
+ * relative error of a percentile never exceeds 1/2^SubBits, which is
+ * about 3%, no matter how large the values are. The minimum and the
+ * maximum are tracked exactly.
+ */
+class LatencyHistogram final {
+    static constexpr unsigned SubBits{5};
+    static constexpr uint64_t SubCount{1ul << SubBits};
+    static constexpr std::size_t Buckets{(64 - SubBits + 1) * SubCount};
+
+public:
+    LatencyHistogram()
+    : count_{0}, sum_{0}, min_{std::numeric_limits<uint64_t>::max()}, max_{0}
+    , buckets_{} {}
+
+    void record(uint64_t nanos) {
+        ++buckets_[bucket(nanos)];
+        ++count_;
+        sum_ += nanos;
+        min_ = std::min(min_, nanos);
+        max_ = std::max(max_, nanos);
+    }
+
+    void merge(LatencyHistogram const& other) {
+        for (std::size_t i = 0; i < Buckets; ++i)
+            buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    [[nodiscard]]
+    uint64_t count() const { return count_; }
+
+    [[nodiscard]]
+    uint64_t min() const { return count_ == 0 ? 0 : min_; }
+
+    [[nodiscard]]
+    uint64_t max() const { return max_; }
+
+    [[nodiscard]]
+    uint64_t mean() const { return count_ == 0 ? 0 : sum_ / count_; }
+
+    /*!
+     * \brief Returns the value below which the fraction \p p of the
+     * recorded values falls.
+     *
+     * @param p the fraction in range [0, 1], e.g. 0.99 for p99
+     * @return the upper bound of the bucket of the percentile, which is
+     * clamped to the exact maximum, or 0 if nothing has been recorded
+     */
+    [[nodiscard]]
+    uint64_t percentile(double p) const {
+        if (count_ == 0) return 0;
+
+        auto rank = static_cast<uint64_t>(std::ceil(p * static_cast<double>(count_)));
+        rank = std::clamp(rank, uint64_t{1}, count_);
+
+        uint64_t seen{0};
+        for (std::size_t i = 0; i < Buckets; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank)
+                return std::clamp(upperBound(i), min(), max_);
+        }
+
+        return max_;
+    }
+
+    explicit operator bool() const { return count_ > 0; }
+
+private:
+    static std::size_t bucket(uint64_t v) {
+        if (v < SubCount) return v;
+
+        auto e = static_cast<unsigned>(std::bit_width(v)) - 1;
+        auto sub = (v >> (e - SubBits)) & (SubCount - 1);
+        return (e - SubBits + 1) * SubCount + sub;
+    }
+
+    static uint64_t upperBound(std::size_t i) {
+        if (i < SubCount) return i;
+
+        auto e = static_cast<unsigned>(i / SubCount) + SubBits - 1;
+        auto sub = i % SubCount;
+        auto width = uint64_t{1} << (e - SubBits);
+        return (uint64_t{1} << e) + (sub + 1) * width - 1;
+    }
+
+private:
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+    std::array<uint64_t, Buckets> buckets_;
+};
+
+} // namespace pimc
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/net/IPv4Address.hpp"
+
+#include "Config.hpp"
+#include "LatencyHistogram.hpp"
+#include "PacketInfo.hpp"
+#include "SeqDecoder.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The arbitration results of a flow received on the A and B lines.
+ */
+struct LineFlowStats final {
+    IPv4Address group;
+    uint16_t dport;
+    // The number of the sequence numbers from the first to the last one
+    uint64_t seqs;
+    // The number of the distinct sequence numbers received on each line
+    uint64_t received[2];
+    // The number of the distinct sequence numbers received on any line
+    uint64_t merged;
+    // The number of the packets which arrived first on each line
+    uint64_t won[2];
+    // The number of the packets received more than once on each line
+    uint64_t duplicates[2];
+    // The number of the times the sequence numbers have restarted
+    uint64_t restarts;
+
+    constexpr bool operator< (LineFlowStats const& rhs) const {
+        if (group != rhs.group) return group < rhs.group;
+        return dport < rhs.dport;
+    }
+};
+
+/*!
+ * \brief The arbitration results of all the flows received on the A and
+ * B lines.
+ */
+struct LineStats final {
+    std::set<LineFlowStats> flows;
+    // How much later a packet arrives on the line which has lost it,
+    // for the packets which the A line has won and vice versa
+    LatencyHistogram bAfterA;
+    LatencyHistogram aAfterB;
+
+    void merge(LineStats const& other) {
+        flows.insert(other.flows.begin(), other.flows.end());
+        bAfterA.merge(other.bAfterA);
+        aAfterB.merge(other.aAfterB);
+    }
+};
+
+/*!
+ * \brief Matches the packets of a redundant feed received on the A and
+ * B lines by their sequence numbers.
+ *
+ * The sequence number is extracted by SeqDecoder, and a flow is
+ * identified by the group and the destination port only, as the lines
+ * may be sent from different sources. The packets are matched within a
+ * window of the last sequence numbers of each flow, which is indexed by
+ * the sequence number, so the matching takes constant time per packet.
+ * The packets older than the window are ignored, unless both lines or
+ * RestartRun consecutive packets of one line are older than the window,
+ * which means that the sender has restarted. The window of the flow then
+ * starts over, whereas its counters carry on.
+ *
+ * The loss of a line is the number of the sequence numbers between the
+ * first and the last received ones which the line has not received, and
+ * the sequence numbers which neither line has received are the gaps that
+ * the arbitration of the lines would not hide.
+ */
+class LineArbiter final {
+public:
+    explicit LineArbiter(Config const& cfg)
+    : LineArbiter{cfg.intfIndex(), cfg.lineB().ifIndex, cfg.seqField()} {}
+
+    LineArbiter(unsigned ifIndexA, unsigned ifIndexB, SeqField const& seqField)
+    : ifIndexA_{ifIndexA}, ifIndexB_{ifIndexB}, seqDecoder_{seqField} {}
+
+    void onPacket(PacketInfo const& pktInfo) {
+        unsigned line;
+        if (pktInfo.ifIndex == ifIndexA_) line = 0;
+        else if (pktInfo.ifIndex == ifIndexB_) line = 1;
+        else return;
+
+        uint64_t seq;
+        if (not seqDecoder_.decode(pktInfo, seq)) return;
+
+        auto& flow = this->flow(pktInfo.group, pktInfo.dport);
+        if (PIMC_UNLIKELY(flow.first != NoSeq and flow.last > seq and
+                          flow.last - seq >= WindowSize)) {
+            // A stray late packet or the sender has restarted
+            if (not restarted(flow, line)) return;
+        } else flow.behind[line] = 0;
+
+        auto& slot = flow.window[seq & WindowMask];
+        uint8_t bit = static_cast<uint8_t>(1u << line);
+
+        if (slot.seq != seq) {
+            slot = Slot{.seq = seq, .timestamp = pktInfo.timestamp, .lines = bit};
+            ++flow.stats.received[line];
+            ++flow.stats.merged;
+            ++flow.stats.won[line];
+            flow.first = std::min(flow.first, seq);
+            flow.last = std::max(flow.last, seq);
+            return;
+        }
+
+        if (slot.lines & bit) {
+            ++flow.stats.duplicates[line];
+            return;
+        }
+
+        slot.lines |= bit;
+        ++flow.stats.received[line];
+        auto delay = pktInfo.timestamp > slot.timestamp
+                ? pktInfo.timestamp - slot.timestamp : 0;
+        if (line == 1) stats_.bAfterA.record(delay);
+        else stats_.aAfterB.record(delay);
+    }
+
+    /*!
+     * @return the arbitration results of the flows
+     */
+    [[nodiscard]]
+    LineStats stats() const {
+        auto ls = stats_;
+        for (auto const& [key, flow]: flows_) {
+            auto fs = flow->stats;
+            if (flow->first != NoSeq)
+                fs.seqs += flow->last - flow->first + 1;
+            ls.flows.insert(fs);
+        }
+
+        return ls;
+    }
+
+private:
+    static constexpr uint64_t NoSeq{std::numeric_limits<uint64_t>::max()};
+    static constexpr std::size_t WindowSize{4096};
+    static constexpr uint64_t WindowMask{WindowSize - 1};
+
+    /*!
+     * The number of the consecutive packets of a line older than the
+     * window which are taken as a restart of the sender.
+     */
+    static constexpr unsigned RestartRun{8};
+
+    struct Slot final {
+        uint64_t seq;
+        uint64_t timestamp;
+        uint8_t lines;
+    };
+
+    struct Flow final {
+        Flow(IPv4Address group, uint16_t dport)
+        : stats{.group = group, .dport = dport, .seqs = 0, .received = {0, 0},
+                .merged = 0, .won = {0, 0}, .duplicates = {0, 0}, .restarts = 0}
+        , first{NoSeq}, last{0}, behind{0, 0}
+        , window(WindowSize, Slot{.seq = NoSeq, .timestamp = 0, .lines = 0}) {}
+
+        // The sequence numbers of the flow spanned before the last restart
+        // are accumulated in stats.seqs
+        LineFlowStats stats;
+        uint64_t first;
+        uint64_t last;
+        // The number of the consecutive packets of each line older than
+        // the window
+        unsigned behind[2];
+        std::vector<Slot> window;
+    };
+
+    /*!
+     * \brief Accounts for a packet of the line \p line which is older than
+     * the window of the flow \p flow and starts the window over if the
+     * sender has restarted.
+     *
+     * @return true if the flow has restarted and the packet is accounted
+     * for in the new window, false if the packet is ignored
+     */
+    static bool restarted(Flow& flow, unsigned line) {
+        ++flow.behind[line];
+        if ((flow.behind[0] == 0 or flow.behind[1] == 0) and
+            flow.behind[line] < RestartRun)
+            return false;
+
+        flow.stats.seqs += flow.last - flow.first + 1;
+        ++flow.stats.restarts;
+        flow.first = NoSeq;
+        flow.last = 0;
+        flow.behind[0] = 0;
+        flow.behind[1] = 0;
+        std::fill(
+                flow.window.begin(), flow.window.end(),
+                Slot{.seq = NoSeq, .timestamp = 0, .lines = 0});
+        return true;
+    }
+
+    Flow& flow(IPv4Address group, uint16_t dport) {
+        auto key = (static_cast<uint64_t>(group.value()) << 16u) | dport;
+        auto& flow = flows_[key];
+        if (PIMC_UNLIKELY(not flow))
+            flow = std::make_unique<Flow>(group, dport);
+        return *flow;
+    }
+
+private:
+    unsigned ifIndexA_;
+    unsigned ifIndexB_;
+    SeqDecoder seqDecoder_;
+    std::unordered_map<uint64_t, std::unique_ptr<Flow>> flows_;
+    LineStats stats_;
+};
+
+} // namespace pimc
@@ -5,12 +5,52 @@
 #include "OutputHandler.hpp"
 #include "Receiver.hpp"
 #include "IPRawReceiver.hpp"
+#include "PacketRingReceiver.hpp"
+#include "XdpReceiver.hpp"
 #include "Sender.hpp"
 
 namespace {
 
 bool stopped{false};
 
+template <pimc::Limiter Limit, pimc::OutputPolicy Output>
+void receive(pimc::Config const& cfg, pimc::OutputHandler& oh, char const* progname) {
+    if (not cfg.pcap().empty()) {
+        // The capture file holds the whole IPv4 packets
+        pimc::IPRawReceiver<Limit, Output> r{cfg, oh, stopped};
+        r.run(progname);
+    } else if (not cfg.wildcard()) {
+        pimc::Receiver<Limit, Output> r{cfg, oh, stopped};
+        r.run(progname);
+#ifdef __linux__
+    } else if (cfg.ring() > 0) {
+        pimc::PacketRingReceiver<Limit, Output> r{cfg, oh, stopped};
+        r.run(progname);
+    } else if (cfg.xdp() != pimc::XdpMode::None) {
+        pimc::XdpReceiver<Limit, Output> r{cfg, oh, stopped};
+        r.run(progname);
+#endif
+    } else {
+        pimc::IPRawReceiver<Limit, Output> r{cfg, oh, stopped};
+        r.run(progname);
+    }
+}
+
+template <pimc::Limiter Limit>
+void receive(pimc::Config const& cfg, pimc::OutputHandler& oh, char const* progname) {
+    switch (cfg.output()) {
+    case pimc::OutputMode::Full:
+        receive<Limit, pimc::FullOutput>(cfg, oh, progname);
+        break;
+    case pimc::OutputMode::Sampled:
+        receive<Limit, pimc::SampledOutput>(cfg, oh, progname);
+        break;
+    case pimc::OutputMode::StatsOnly:
+        receive<Limit, pimc::StatsOnlyOutput>(cfg, oh, progname);
+        break;
+    }
+}
+
 } // anon.namespace
 
 int main(int argc, char** argv) {
@@ -28,26 +68,12 @@ int main(int argc, char** argv) {
 
         pimc::OutputHandler oh{cfg};
         if (not cfg.sender()) {
-            if (cfg.count() == 0) {
-                if (not cfg.wildcard()) {
-                    pimc::Receiver<pimc::UnlimitedPackets> r{cfg, oh, stopped};
-                    r.run(progname);
-                } else {
-                    pimc::IPRawReceiver<pimc::UnlimitedPackets> r{cfg, oh, stopped};
-                    r.run(progname);
-                }
-            } else {
-                if (not cfg.wildcard()) {
-                    pimc::Receiver<pimc::LimitedPackets> r{cfg, oh, stopped};
-                    r.run(progname);
-                } else {
-                    pimc::IPRawReceiver<pimc::LimitedPackets> r{cfg, oh, stopped};
-                    r.run(progname);
-                }
-            }
+            if (cfg.count() == 0)
+                receive<pimc::UnlimitedPackets>(cfg, oh, progname);
+            else receive<pimc::LimitedPackets>(cfg, oh, progname);
         } else {
             pimc::Sender s{cfg, oh, stopped};
-            s.run();
+            s.run(progname);
         }
 
         return 0;
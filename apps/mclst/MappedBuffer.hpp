@@ -0,0 +1,171 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+namespace pimc {
+
+/*!
+ * @return the default huge page size in bytes as reported in
+ * `/proc/meminfo`, or 2MiB if it is not reported
+ */
+inline std::size_t hugePageSize() {
+    static std::size_t const size = [] {
+        std::ifstream meminfo{"/proc/meminfo"};
+        std::string line;
+        std::string_view prefix{"Hugepagesize:"};
+        while (std::getline(meminfo, line)) {
+            if (not line.starts_with(prefix)) continue;
+
+            auto kib = std::strtoull(line.c_str() + prefix.size(), nullptr, 10);
+            if (kib > 0) return static_cast<std::size_t>(kib * 1024);
+        }
+        return std::size_t{2} << 20u;
+    }();
+    return size;
+}
+
+/*!
+ * @return the NUMA node of the CPU \p cpu or -1 if it is unknown
+ */
+inline int cpuNode(unsigned cpu) {
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::directory_iterator it{
+        fs::path{"/sys/devices/system/cpu"} / ("cpu" + std::to_string(cpu)), ec};
+    if (ec) return -1;
+
+    for (auto const& entry: it) {
+        auto name = entry.path().filename().string();
+        if (name.size() > 4 and name.starts_with("node"))
+            return std::atoi(name.c_str() + 4);
+    }
+
+    return -1;
+}
+
+/*!
+ * \brief An anonymous memory mapping which is prefaulted when it is
+ * created, so that the receive path never takes a page fault on it.
+ *
+ * If requested, the mapping is backed by the huge pages, which saves the
+ * TLB misses, and falls back to the regular pages if no huge pages are
+ * available. If the NUMA node is specified, the pages are preferably
+ * allocated on that node, whichever CPU faults them in.
+ */
+class MappedBuffer final {
+public:
+    MappedBuffer(std::size_t size, bool hugePages, int node)
+    : data_{nullptr}, size_{size}, mappedSize_{size}
+    , huge_{false}, hugeError_{0}, node_{-1} {
+#ifdef __linux__
+        if (hugePages) {
+            auto hps = hugePageSize();
+            auto hugeSize = (size + hps - 1) / hps * hps;
+            auto* p = mmap(
+                    nullptr, hugeSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<uint8_t*>(p);
+                mappedSize_ = hugeSize;
+                huge_ = true;
+            } else hugeError_ = errno;
+        }
+#else
+        (void)hugePages;
+#endif
+
+        if (data_ == nullptr) {
+            auto* p = mmap(
+                    nullptr, mappedSize_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANON, -1, 0);
+            if (p == MAP_FAILED)
+                raise<std::runtime_error>(
+                        "unable to map receive buffers: {}", SysError{});
+            data_ = static_cast<uint8_t*>(p);
+        }
+
+#ifdef __linux__
+        // The pages are not faulted in yet, so the policy decides where
+        // they are allocated
+        if (node >= 0 and node < 64) {
+            unsigned long nodeMask = 1ul << static_cast<unsigned>(node);
+            if (syscall(SYS_mbind, data_, mappedSize_, MPOL_PREFERRED,
+                        &nodeMask, 64ul, 0u) == 0)
+                node_ = node;
+        }
+#else
+        (void)node;
+#endif
+
+        memset(data_, 0, mappedSize_);
+    }
+
+    MappedBuffer(MappedBuffer const&) = delete;
+    MappedBuffer(MappedBuffer&&) = delete;
+    MappedBuffer& operator= (MappedBuffer const&) = delete;
+    MappedBuffer& operator= (MappedBuffer&&) = delete;
+
+    ~MappedBuffer() { munmap(data_, mappedSize_); }
+
+    [[nodiscard]]
+    uint8_t* data() { return data_; }
+
+    [[nodiscard]]
+    std::size_t size() const { return size_; }
+
+    /*!
+     * @return the size of the mapping, which is rounded up to the huge
+     * page size if it is backed by the huge pages
+     */
+    [[nodiscard]]
+    std::size_t mappedSize() const { return mappedSize_; }
+
+    /*!
+     * @return true if the mapping is backed by the huge pages
+     */
+    [[nodiscard]]
+    bool huge() const { return huge_; }
+
+    /*!
+     * @return the error number with which the huge pages were refused or
+     * 0 if they were not refused
+     */
+    [[nodiscard]]
+    int hugeError() const { return hugeError_; }
+
+    /*!
+     * @return the NUMA node on which the pages are preferably allocated
+     * or -1 if no node is preferred
+     */
+    [[nodiscard]]
+    int node() const { return node_; }
+
+private:
+    uint8_t* data_;
+    std::size_t size_;
+    std::size_t mappedSize_;
+    bool huge_;
+    int hugeError_;
+    int node_;
+};
+
+} // namespace pimc
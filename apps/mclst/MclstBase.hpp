@@ -17,11 +17,13 @@ protected:
     constexpr MclstBase(Config const& cfg, OutputHandler& oh, bool& stopped)
     : cfg_{cfg}, oh_{oh}, socket_{-1}, stopped_{stopped} {}
 
-    ~MclstBase() {
-        if (socket_ != -1) {
+    ~MclstBase() { closeSocket(socket_); }
+
+    static void closeSocket(int s) {
+        if (s != -1) {
             int rc;
             do {
-                rc = close(socket_);
+                rc = close(s);
             } while (rc == -1 and errno == EINTR);
         }
     }
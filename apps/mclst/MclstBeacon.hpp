@@ -6,6 +6,14 @@ namespace pimc {
 
 constexpr uint64_t MclstMagic{11899030981529723792ul};
 
+/*!
+ * The magic of the beacons whose message is followed by the padding
+ * filled with a deterministic pattern and the big endian CRC32C of the
+ * whole UDP payload preceding it. The header is the same, so the receivers
+ * which do not verify the CRC32C never mistake the padding for a message.
+ */
+constexpr uint64_t MclstCrcMagic{11899030981529723793ul};
+
 struct MclstBeaconHdr final {
     uint64_t magic;
     uint64_t seq;
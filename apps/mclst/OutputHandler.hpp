@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <ctime>
+#include <iterator>
+#include <set>
+#include <tuple>
 #include <vector>
 #include <string>
 #include <string_view>
@@ -17,9 +21,16 @@
 #include "pimc/formatters/IPv4Formatters.hpp"
 #include "pimc/unix/TerminalColors.hpp"
 
+#include "CaptureWriter.hpp"
 #include "Config.hpp"
+#include "FlightRecorder.hpp"
 #include "PacketInfo.hpp"
+#include "Joiner.hpp"
+#include "LineArbiter.hpp"
+#include "Reflector.hpp"
+#include "RtControls.hpp"
 #include "RxStats.hpp"
+#include "Zapper.hpp"
 
 namespace pimc {
 
@@ -40,6 +51,11 @@ struct Duration {
     uint64_t value;
 };
 
+// A latency in nanoseconds, shown in milliseconds
+struct Latency {
+    uint64_t value;
+};
+
 struct SourceAndPort {
     IPv4Address source;
     uint16_t sport;
@@ -137,6 +153,16 @@ struct formatter<pimc::Duration>: formatter<string_view> {
     }
 };
 
+template <>
+struct formatter<pimc::Latency>: formatter<string_view> {
+    template <typename FormatContext>
+    auto format(pimc::Latency const& l, FormatContext& ctx) {
+        // Formatted as a string, so the width and the alignment apply
+        return formatter<string_view>::format(
+                fmt::format("{:.3f}ms", static_cast<double>(l.value) / 1'000'000.), ctx);
+    }
+};
+
 template <>
 struct formatter<pimc::SourceAndPort>: formatter<string_view> {
     template <typename FormatContext>
@@ -209,6 +235,103 @@ public:
         fputs(buf.data(), stdout);
     }
 
+    /*!
+     * \brief Shows that the flow \p fk has received no packets for
+     * \p silentNs nanoseconds.
+     */
+    void showFlowSilent(uint64_t ts, FlowKey const& fk, uint64_t silentNs) {
+        showFlowSilence(ts, fk, "silent for", silentNs);
+    }
+
+    /*!
+     * \brief Shows that a packet of the silent flow \p fk has arrived after
+     * an outage of \p outageNs nanoseconds.
+     */
+    void showFlowResumed(uint64_t ts, FlowKey const& fk, uint64_t outageNs) {
+        showFlowSilence(ts, fk, "resumed after", outageNs);
+    }
+
+    /*!
+     * \brief Shows that the subscription \p sub has been joined or left
+     * in zap mode.
+     */
+    void showZap(uint64_t ts, char const* what, Subscription const& sub) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_WHITE_BRIGHT);
+
+        fmt::format_to(bi, "{} {} ", Timestamp{.value = ts}, what);
+        formatSubscription(bi, sub);
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_RESET);
+
+        buf.push_back('\n');
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows that the sources of the subscription \p sub have been
+     * replaced with \p sources.
+     */
+    void showSourcesUpdate(
+            uint64_t ts, Subscription const& sub,
+            std::vector<IPv4Address> const& sources) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        std::vector<IPv4Address> added, removed;
+        std::set_difference(
+                sources.begin(), sources.end(), sub.sources.begin(), sub.sources.end(),
+                std::back_inserter(added));
+        std::set_difference(
+                sub.sources.begin(), sub.sources.end(), sources.begin(), sources.end(),
+                std::back_inserter(removed));
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_WHITE_BRIGHT);
+
+        fmt::format_to(
+                bi, "{} updated sources of {}:{}, {} added, {} removed, ",
+                Timestamp{.value = ts}, sub.group, sub.dport,
+                added.size(), removed.size());
+        if (sources.empty()) fmt::format_to(bi, "any source");
+        else fmt::format_to(bi, "{} sources", sources.size());
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_RESET);
+
+        buf.push_back('\n');
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows the time from joining the subscription \p sub to its
+     * first packet in zap mode.
+     */
+    void showZapJoinLatency(uint64_t ts, Subscription const& sub, uint64_t latency) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_WHITE_BRIGHT);
+
+        fmt::format_to(bi, "{} first packet of ", Timestamp{.value = ts});
+        formatSubscription(bi, sub);
+        fmt::format_to(bi, " {} after join", Latency{.value = latency});
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_RESET);
+
+        buf.push_back('\n');
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
     void showReceivedPacket(PacketInfo const& pktInfo) {
         auto& buf = getMemoryBuffer();
         auto bi = std::back_inserter(buf);
@@ -220,7 +343,7 @@ public:
                 bi, "{} {}, {}:{}->{}:{}, TTL {}, UDP size {}",
                 Timestamp{.value = pktInfo.timestamp},
                 Interface{.value = pktInfo.ifIndex, .intfTable = cfg_.intfTable()},
-                pktInfo.source, pktInfo.sport, cfg_.group(), pktInfo.dport,
+                pktInfo.source, pktInfo.sport, pktInfo.group, pktInfo.dport,
                 TTL{.value = pktInfo.ttl}, pktInfo.payloadSize);
         if (pktInfo.mclstBeacon) {
             fmt::format_to(bi, "\n");
@@ -232,14 +355,21 @@ public:
                     pktInfo.remoteSeq,
                     BeaconTime{.value = pktInfo.remoteTimestamp},
                     pktInfo.timestamp - pktInfo.remoteTimestamp);
-            fmt::format_to_n(bi, pktInfo.remoteMsgLen, "{}", pktInfo.remoteMsg);
+            fmt::format_to_n(bi, pktInfo.remoteMsgLen, "{}", pktInfo.remoteMsg());
+        }
+
+        auto corrupt = pktInfo.integrity == Integrity::Corrupt;
+        if (corrupt) {
+            if (cfg_.colors())
+                fmt::format_to(bi, TERM_COLOR_RED_BRIGHT);
+            fmt::format_to(bi, ", CORRUPT (CRC32C mismatch)");
         }
 
-        if (cfg_.showPayload()) {
+        if (cfg_.showPayload() or (corrupt and cfg_.dumpCorrupt())) {
             fmt::format_to(bi, "\n");
             if (cfg_.colors())
                 fmt::format_to(bi, TERM_COLOR_YELLOW);
-            formatHexAscii(bi, pktInfo.payload, pktInfo.payloadSize);
+            formatHexAscii(bi, pktInfo.payload(), pktInfo.payloadSize);
         }
 
         if (cfg_.colors())
@@ -278,16 +408,17 @@ public:
         fmt::format_to(bi, "\n");
 
         if (not rxStats) {
-            fmt::format_to(bi, "No traffic received for {}", cfg_.group());
-            if (cfg_.wildcard()) fmt::format_to(bi, ":*");
-            else fmt::format_to(bi, ":{}", cfg_.dport());
-            fmt::format_to(bi, " in {} sec", Duration{.value = rxStats.durationNanos()});
-            buf.push_back('\n');
+            fmt::format_to(bi, "No traffic received for ");
+            formatSubscriptions(bi);
+            fmt::format_to(bi, " in {} sec\n", Duration{.value = rxStats.durationNanos()});
+            formatCpuTime(bi, rxStats);
             buf.push_back(static_cast<char>(0));
             fputs(buf.data(), stdout);
             return;
         }
 
+        bool showGroup = cfg_.subscriptions().size() > 1;
+        std::size_t groupFldLen = showGroup ? strlen(CapGroup) : 0;
         std::size_t sourceFldLen = strlen(CapSource);
         std::size_t dportFldLen = strlen(CapDPort);
         std::size_t pktsFldLen = strlen(CapPkts);
@@ -298,12 +429,14 @@ public:
         std::vector<FlowStatsView> fsvs;
         fsvs.reserve(rxStats.size());
         rxStats.forEach(
-                [&fsvs, duration=rxStats.durationNanos(),
-                 &sourceFldLen, &dportFldLen, &pktsFldLen,
+                [&fsvs, duration=rxStats.durationNanos(), showGroup,
+                 &groupFldLen, &sourceFldLen, &dportFldLen, &pktsFldLen,
                  &bytesFldLen, &apsFldLen, &rateFldLen]
-                (auto source, auto sport, auto dport, auto const& fs) {
-                    fsvs.emplace_back(source, sport, dport, fs, duration);
+                (auto group, auto source, auto sport, auto dport, auto const& fs) {
+                    fsvs.emplace_back(group, source, sport, dport, fs, duration);
                     auto const& fsv = fsvs.back();
+                    if (showGroup)
+                        groupFldLen = std::max(groupFldLen, fsv.groupSize());
                     sourceFldLen = std::max(sourceFldLen, fsv.spSize());
                     dportFldLen = std::max(dportFldLen, fsv.dportSize());
                     pktsFldLen = std::max(pktsFldLen, fsv.packetsSize());
@@ -318,25 +451,368 @@ public:
                 apsFldLen, rateFldLen);
 
         SCLine<'='> sep{std::max({
-            sourceFldLen, dportFldLen, pktsFldLen, bytesFldLen, apsFldLen, rateFldLen})};
+            groupFldLen, sourceFldLen, dportFldLen, pktsFldLen,
+            bytesFldLen, apsFldLen, rateFldLen})};
 
-        fmt::format_to(bi, "Traffic received for {}", cfg_.group());
-        if (cfg_.wildcard()) fmt::format_to(bi, ":*");
-        else fmt::format_to(bi, ":{}", cfg_.dport());
+        fmt::format_to(bi, "Traffic received for ");
+        formatSubscriptions(bi);
         fmt::format_to(bi, " in {} sec\n\n", Duration{.value = rxStats.durationNanos()});
 
+        auto gfs = fmt::format("{{:<{}}} ", groupFldLen);
+        if (showGroup)
+            fmt::format_to(bi, fmt::runtime(gfs), CapGroup);
         fmt::format_to(
                 bi, fmt::runtime(fs),
                 CapSource, CapDPort, CapPkts, CapBytes, CapAPS, CapRate);
+        if (showGroup)
+            fmt::format_to(bi, fmt::runtime(gfs), sep(groupFldLen));
         fmt::format_to(
                 bi, fmt::runtime(fs),
                 sep(sourceFldLen), sep(dportFldLen), sep(pktsFldLen),
                 sep(bytesFldLen), sep(apsFldLen), sep(rateFldLen));
-        for (auto const& fsv: fsvs)
+        for (auto const& fsv: fsvs) {
+            if (showGroup)
+                fmt::format_to(bi, fmt::runtime(gfs), fmt::to_string(fsv.group()));
             fmt::format_to(
                     bi, fmt::runtime(fs),
                     fsv.sp().to_string(), fsv.dport(), fsv.packets(),
                     fsv.bytes(), fsv.aps(), fsv.rate());
+        }
+        fmt::format_to(bi, "\n");
+        formatSeqStats(bi, rxStats);
+        formatIntegrityStats(bi, rxStats);
+        formatOutageStats(bi, rxStats);
+        formatSocketStats(bi, rxStats);
+        formatCpuTime(bi, rxStats);
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows which of the controls of the receive or the send
+     * threads have been applied and why the rest have been refused.
+     */
+    void showRtControls(RtControls const& controls) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        fmt::format_to(bi, "Runtime controls:\n");
+        for (auto const& control: controls) {
+            if (cfg_.colors() and not control.applied)
+                fmt::format_to(bi, TERM_COLOR_RED_BRIGHT);
+
+            fmt::format_to(
+                    bi, "  {:<18} {:<8} {}", control.name,
+                    control.applied ? "applied" : "refused", control.detail);
+
+            if (cfg_.colors() and not control.applied)
+                fmt::format_to(bi, TERM_COLOR_RESET);
+            fmt::format_to(bi, "\n");
+        }
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows how many frames have been read from the capture file
+     * and how long it took.
+     */
+    void showReplay(uint64_t frames, uint64_t skipped, std::size_t size, uint64_t nanos) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        fmt::format_to(
+                bi, "\nRead {} frames ({} bytes) from '{}' in {} sec",
+                frames, size, cfg_.pcap(), Duration{.value = nanos});
+        if (skipped > 0)
+            fmt::format_to(bi, ", {} frames are not IPv4 packets", skipped);
+        fmt::format_to(bi, "\n");
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows how many packets have been written with --write and
+     * why the writing has stopped if it has failed.
+     */
+    void showCaptureStats(CaptureStats const& stats) {
+        if (not stats.error.empty())
+            warning("{}, the capture is incomplete\n", stats.error);
+
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        fmt::format_to(
+                bi, "\nWrote {} packet{} ({} bytes) to '{}'",
+                stats.packets, stats.packets == 1 ? "" : "s", stats.bytes, stats.fn);
+        if (stats.files > 1)
+            fmt::format_to(bi, " and {} more files", stats.files - 1);
+        if (stats.dropped > 0)
+            fmt::format_to(
+                    bi, ", {} packet{} dropped from the capture",
+                    stats.dropped, stats.dropped == 1 ? "" : "s");
+        fmt::format_to(bi, "\n");
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows that the anomaly \p reason has started the flight
+     * recorder dump \p dump.
+     */
+    void showFlightDump(uint64_t ts, std::string const& reason, FlightDump const& dump) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_WHITE_BRIGHT);
+
+        fmt::format_to(
+                bi, "{} {}: dumping {} packet{} before and up to {} after to '{}'",
+                Timestamp{.value = ts}, reason, dump.before,
+                dump.before == 1 ? "" : "s", dump.after, dump.fn);
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_RESET);
+
+        buf.push_back('\n');
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows how many flight recorder dumps have been written with
+     * --record.
+     */
+    void showFlightDumps(unsigned dumps) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        if (dumps == 0)
+            fmt::format_to(bi, "\nFlight recorder: no dumps written\n");
+        else fmt::format_to(
+                bi, "\nFlight recorder: wrote {} dump{} of the packets around "
+                "the anomalies\n", dumps, dumps == 1 ? "" : "s");
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows the percentiles of the join and leave latencies
+     * measured in zap mode.
+     */
+    void showZapStats(ZapStats const& zapStats) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        fmt::format_to(
+                bi, "\nZap: {} joins with traffic, {} joins without traffic, "
+                "{} leaves\n\n",
+                zapStats.joins.count(), zapStats.missed, zapStats.leaves.count());
+
+        formatLatenciesHeader(bi);
+        formatLatencies(bi, "Join->first", zapStats.joins);
+        formatLatencies(bi, "Leave->last", zapStats.leaves);
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows the arrival statistics of the subscriptions joined at
+     * the configured join rate.
+     */
+    void showJoinStats(JoinStats const& joinStats) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        auto joinDuration = joinStats.joined > 0
+                ? joinStats.lastJoinAt - joinStats.firstJoinAt : 0;
+        fmt::format_to(
+                bi, "\nJoined {} of {} groups in {} sec, {} with traffic, "
+                "{} without traffic\n\n",
+                joinStats.joined, joinStats.subscriptions,
+                Duration{.value = joinDuration}, joinStats.joins.count(),
+                joinStats.silent.size());
+
+        formatLatenciesHeader(bi);
+        formatLatencies(bi, "Join->first", joinStats.joins);
+
+        if (not joinStats.silent.empty()) {
+            fmt::format_to(bi, "\nGroups without traffic: ");
+            auto shown = std::min(joinStats.silent.size(), MaxSilentShown);
+            for (std::size_t i = 0; i < shown; ++i) {
+                if (i > 0) fmt::format_to(bi, ", ");
+                formatSubscription(bi, joinStats.silent[i]);
+            }
+            if (shown < joinStats.silent.size())
+                fmt::format_to(bi, " and {} more", joinStats.silent.size() - shown);
+            fmt::format_to(bi, "\n");
+        }
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows how many of the sources of the source specific
+     * subscriptions have sent any packets and which of them have not, if
+     * any of \p subs has more than one source.
+     */
+    void showSourceStats(std::vector<Subscription> const& subs, RxStats const& rxStats) {
+        if (std::none_of(subs.begin(), subs.end(), [] (auto const& sub) {
+            return sub.sources.size() > 1;
+        })) return;
+
+        // The portless subscriptions receive the sources on any port
+        std::set<std::tuple<IPv4Address, uint16_t, IPv4Address>> heard;
+        rxStats.forEach([&] (auto group, auto source, auto, auto dport, auto const&) {
+            heard.emplace(group, cfg_.wildcard() ? 0 : dport, source);
+        });
+
+        std::size_t groups{0}, sources{0};
+        std::vector<Subscription> silent;
+        for (auto const& sub: subs) {
+            if (sub.sources.empty()) continue;
+
+            ++groups;
+            sources += sub.sources.size();
+            for (auto source: sub.sources) {
+                if (not heard.contains(std::make_tuple(sub.group, sub.dport, source)))
+                    silent.push_back(Subscription{
+                        .group = sub.group, .dport = sub.dport, .sources = {source}});
+            }
+        }
+
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        fmt::format_to(
+                bi, "\n{} sources of {} {}, {} with traffic, {} without traffic\n",
+                sources, groups, groups == 1 ? "group" : "groups",
+                sources - silent.size(), silent.size());
+
+        if (not silent.empty()) {
+            fmt::format_to(bi, "\nSources without traffic: ");
+            auto shown = std::min(silent.size(), MaxSilentShown);
+            for (std::size_t i = 0; i < shown; ++i) {
+                if (i > 0) fmt::format_to(bi, ", ");
+                formatSubscription(bi, silent[i]);
+            }
+            if (shown < silent.size())
+                fmt::format_to(bi, " and {} more", silent.size() - shown);
+            fmt::format_to(bi, "\n");
+        }
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows the loss and the wins of the A and B lines and how much
+     * later the packets arrive on the line which has lost them.
+     */
+    void showLineStats(LineStats const& lineStats) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        fmt::format_to(
+                bi, "\nA/B lines: A {}, B {}\n\n",
+                Interface{.value = cfg_.intfIndex(), .intfTable = cfg_.intfTable()},
+                Interface{.value = cfg_.lineB().ifIndex, .intfTable = cfg_.intfTable()});
+
+        if (lineStats.flows.empty()) {
+            fmt::format_to(bi, "No sequenced packets received\n");
+            buf.push_back(static_cast<char>(0));
+            fputs(buf.data(), stdout);
+            return;
+        }
+
+        fmt::format_to(
+                bi, fmt::runtime(LinesFmt), "Group", "DPort", "Seqs",
+                "A lost", "B lost", "Both lost", "A won", "B won", "A dups", "B dups",
+                "Restarts");
+        SCLine<'='> sep{15};
+        fmt::format_to(
+                bi, fmt::runtime(LinesFmt), sep(15), sep(5), sep(10), sep(10),
+                sep(10), sep(10), sep(10), sep(10), sep(10), sep(10), sep(8));
+        for (auto const& fs: lineStats.flows) {
+            fmt::format_to(
+                    bi, fmt::runtime(LinesFmt), fmt::to_string(fs.group), fs.dport,
+                    fs.seqs, fs.seqs - fs.received[0], fs.seqs - fs.received[1],
+                    fs.seqs - fs.merged, fs.won[0], fs.won[1],
+                    fs.duplicates[0], fs.duplicates[1], fs.restarts);
+        }
+
+        fmt::format_to(bi, "\n");
+        formatLatenciesHeader(bi);
+        formatLatencies(bi, "B after A", lineStats.bAfterA);
+        formatLatencies(bi, "A after B", lineStats.aAfterB);
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows the number of the beacons reflected to the return group.
+     */
+    void showReflectStats(ReflectStats const& reflectStats) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        auto const& reflect = cfg_.reflect();
+        fmt::format_to(
+                bi, "\nReflected {} beacons to {}:{}, {} failed to send\n",
+                reflectStats.reflected, reflect.group, reflect.dport,
+                reflectStats.failed);
+
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    void showReflection(uint64_t ts, IPv4Address reflector, uint64_t seq, uint64_t rtt) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_WHITE_BRIGHT);
+
+        fmt::format_to(
+                bi, "{} reflected by {}, seq #{}, RTT {}",
+                Timestamp{.value = ts}, reflector, seq, Latency{.value = rtt});
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_RESET);
+
+        buf.push_back('\n');
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    /*!
+     * \brief Shows the percentiles of the round trip times of the beacons
+     * reflected by each reflector.
+     */
+    void showRttStats(RttStats const& rttStats) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        auto const& rtt = cfg_.rtt();
+        if (rttStats.reflectors.empty()) {
+            fmt::format_to(bi, "\nNo reflections received on {}:{}\n", rtt.group, rtt.dport);
+        } else {
+            fmt::format_to(
+                    bi, "\nRTT: reflections received on {}:{} from {} reflectors\n\n",
+                    rtt.group, rtt.dport, rttStats.reflectors.size());
+            formatLatenciesHeader(bi);
+            for (auto const& [reflector, h]: rttStats.reflectors)
+                formatLatencies(bi, fmt::to_string(reflector), h);
+        }
+
         buf.push_back(static_cast<char>(0));
         fputs(buf.data(), stdout);
     }
@@ -356,19 +832,354 @@ public:
     }
 
 private:
+    /*!
+     * \brief Formats the CPU time used by the receive threads, which
+     * shows the cost of the receive mode, e.g. of the busy polling.
+     */
+    template <typename OI>
+    void formatCpuTime(OI bi, RxStats const& rxStats) {
+        auto user = rxStats.cpuUserNanos();
+        auto sys = rxStats.cpuSysNanos();
+        auto duration = rxStats.durationNanos();
+        auto pct = duration == 0 ? 0.
+                : static_cast<double>(user + sys) * 100. / static_cast<double>(duration);
+        fmt::format_to(
+                bi, "CPU time {} sec (user {} sec, system {} sec), {:.1f}% of one CPU\n",
+                Duration{.value = user + sys}, Duration{.value = user},
+                Duration{.value = sys}, pct);
+    }
+
+    /*!
+     * \brief Formats the gaps, the duplicates and the reordering of the
+     * sequence numbers of the flows which carry them, the flows with the
+     * most lost sequence numbers first.
+     */
+    template <typename OI>
+    void formatSeqStats(OI bi, RxStats const& rxStats) {
+        struct SeqFlow {
+            IPv4Address group;
+            IPv4Address source;
+            uint16_t sport;
+            uint16_t dport;
+            FlowStats const* fs;
+        };
+
+        std::vector<SeqFlow> flows;
+        uint64_t lost{0}, duplicates{0}, reordered{0};
+        rxStats.forEach([&] (auto group, auto source, auto sport, auto dport, auto const& fs) {
+            if (fs.seqs() == 0) return;
+            flows.push_back(SeqFlow{
+                .group = group, .source = source, .sport = sport, .dport = dport,
+                .fs = &fs});
+            lost += fs.lost();
+            duplicates += fs.duplicates();
+            reordered += fs.reordered();
+        });
+        if (flows.empty()) return;
+
+        std::stable_sort(flows.begin(), flows.end(), [] (auto const& lhs, auto const& rhs) {
+            if (lhs.fs->lost() != rhs.fs->lost()) return lhs.fs->lost() > rhs.fs->lost();
+            return lhs.fs->duplicates() > rhs.fs->duplicates();
+        });
+
+        fmt::format_to(
+                bi, "Sequence numbers of {} {}: {} lost, {} duplicates, {} reordered\n\n",
+                flows.size(), flows.size() == 1 ? "flow" : "flows",
+                lost, duplicates, reordered);
+
+        fmt::format_to(
+                bi, fmt::runtime(SeqFmt), "Group", "Source", "DPort", "Packets",
+                "Lost", "Dups", "Reordered", "Restarts");
+        SCLine<'='> sep{21};
+        fmt::format_to(
+                bi, fmt::runtime(SeqFmt), sep(15), sep(21), sep(5), sep(12),
+                sep(10), sep(10), sep(10), sep(8));
+        auto shown = std::min(flows.size(), MaxSeqFlowsShown);
+        for (std::size_t i = 0; i < shown; ++i) {
+            auto const& sf = flows[i];
+            fmt::format_to(
+                    bi, fmt::runtime(SeqFmt), fmt::to_string(sf.group),
+                    fmt::format("{}:{}", sf.source, sf.sport), sf.dport,
+                    sf.fs->seqs(), sf.fs->lost(), sf.fs->duplicates(),
+                    sf.fs->reordered(), sf.fs->restarts());
+        }
+        if (shown < flows.size())
+            fmt::format_to(bi, "and {} more flows\n", flows.size() - shown);
+        fmt::format_to(bi, "\n");
+    }
+
+    /*!
+     * \brief Formats the number of the beacons whose CRC32C has been
+     * verified and the flows which carried corrupt beacons, the flows with
+     * the most corrupt beacons first.
+     */
+    template <typename OI>
+    void formatIntegrityStats(OI bi, RxStats const& rxStats) {
+        struct CorruptFlow {
+            IPv4Address group;
+            IPv4Address source;
+            uint16_t sport;
+            uint16_t dport;
+            FlowStats const* fs;
+        };
+
+        std::vector<CorruptFlow> flows;
+        uint64_t verified{0}, corrupt{0};
+        rxStats.forEach([&] (auto group, auto source, auto sport, auto dport, auto const& fs) {
+            verified += fs.verified();
+            corrupt += fs.corrupt();
+            if (fs.corrupt() == 0) return;
+            flows.push_back(CorruptFlow{
+                .group = group, .source = source, .sport = sport, .dport = dport,
+                .fs = &fs});
+        });
+        if (verified == 0) return;
+
+        fmt::format_to(
+                bi, "Verified the CRC32C of {} packets, {} corrupt\n\n",
+                verified, corrupt);
+        if (flows.empty()) return;
+
+        std::stable_sort(flows.begin(), flows.end(), [] (auto const& lhs, auto const& rhs) {
+            return lhs.fs->corrupt() > rhs.fs->corrupt();
+        });
+
+        fmt::format_to(
+                bi, fmt::runtime(CorruptFmt), "Group", "Source", "DPort",
+                "Verified", "Corrupt");
+        SCLine<'='> sep{21};
+        fmt::format_to(
+                bi, fmt::runtime(CorruptFmt), sep(15), sep(21), sep(5), sep(12),
+                sep(10));
+        auto shown = std::min(flows.size(), MaxSeqFlowsShown);
+        for (std::size_t i = 0; i < shown; ++i) {
+            auto const& cf = flows[i];
+            fmt::format_to(
+                    bi, fmt::runtime(CorruptFmt), fmt::to_string(cf.group),
+                    fmt::format("{}:{}", cf.source, cf.sport), cf.dport,
+                    cf.fs->verified(), cf.fs->corrupt());
+        }
+        if (shown < flows.size())
+            fmt::format_to(bi, "and {} more flows\n", flows.size() - shown);
+        fmt::format_to(bi, "\n");
+    }
+
+    /*!
+     * \brief Formats the outages of the flows which have gone silent, the
+     * flows with the longest outages first.
+     */
+    template <typename OI>
+    void formatOutageStats(OI bi, RxStats const& rxStats) {
+        if (cfg_.silence() == 0) return;
+
+        struct SilentFlow {
+            IPv4Address group;
+            IPv4Address source;
+            uint16_t sport;
+            uint16_t dport;
+            FlowStats const* fs;
+        };
+
+        std::vector<SilentFlow> flows;
+        uint64_t outages{0}, silent{0};
+        rxStats.forEach([&] (auto group, auto source, auto sport, auto dport, auto const& fs) {
+            if (fs.outages() == 0) return;
+            flows.push_back(SilentFlow{
+                .group = group, .source = source, .sport = sport, .dport = dport,
+                .fs = &fs});
+            outages += fs.outages();
+            if (fs.silent()) ++silent;
+        });
+
+        if (flows.empty()) {
+            fmt::format_to(
+                    bi, "No flow has been silent for {} ms\n\n", cfg_.silence());
+            return;
+        }
+
+        std::stable_sort(flows.begin(), flows.end(), [] (auto const& lhs, auto const& rhs) {
+            return lhs.fs->longestOutage() > rhs.fs->longestOutage();
+        });
+
+        fmt::format_to(
+                bi, "Outages of {} {}: {} {}, longest {} ms, {} silent at exit\n\n",
+                flows.size(), flows.size() == 1 ? "flow" : "flows",
+                outages, outages == 1 ? "outage" : "outages",
+                flows.front().fs->longestOutage() / 1'000'000, silent);
+
+        fmt::format_to(
+                bi, fmt::runtime(OutageFmt), "Group", "Source", "DPort",
+                "Outages", "Longest ms", "At exit");
+        SCLine<'='> sep{21};
+        fmt::format_to(
+                bi, fmt::runtime(OutageFmt), sep(15), sep(21), sep(5), sep(10),
+                sep(12), sep(7));
+        auto shown = std::min(flows.size(), MaxSeqFlowsShown);
+        for (std::size_t i = 0; i < shown; ++i) {
+            auto const& sf = flows[i];
+            fmt::format_to(
+                    bi, fmt::runtime(OutageFmt), fmt::to_string(sf.group),
+                    fmt::format("{}:{}", sf.source, sf.sport), sf.dport,
+                    sf.fs->outages(), sf.fs->longestOutage() / 1'000'000,
+                    sf.fs->silent() ? "silent" : "flowing");
+        }
+        if (shown < flows.size())
+            fmt::format_to(bi, "and {} more flows\n", flows.size() - shown);
+        fmt::format_to(bi, "\n");
+    }
+
+    /*!
+     * \brief Formats the packets dropped by the kernel because the socket
+     * receive queues were full and the peak occupancy of the queues, the
+     * sockets with the most drops and the fullest queues first.
+     */
+    template <typename OI>
+    void formatSocketStats(OI bi, RxStats const& rxStats) {
+        auto sockets = rxStats.sockets();
+        if (sockets.empty()) return;
+
+        auto occupancy = [] (SocketStats const& ss) {
+            return ss.rcvbuf == 0 ? 0.
+                : static_cast<double>(ss.peakQueue) * 100. / static_cast<double>(ss.rcvbuf);
+        };
+        std::sort(sockets.begin(), sockets.end(),
+                  [&occupancy] (auto const& lhs, auto const& rhs) {
+            if (lhs.drops != rhs.drops) return lhs.drops > rhs.drops;
+            return occupancy(lhs) > occupancy(rhs);
+        });
+
+        uint64_t drops{0};
+        std::size_t dropping{0};
+        for (auto const& ss: sockets) {
+            drops += ss.drops;
+            if (ss.drops > 0) ++dropping;
+        }
+
+        auto noun = sockets.size() == 1 ? "socket" : "sockets";
+        if (drops > 0)
+            fmt::format_to(
+                    bi, "Kernel dropped {} packets on {} of {} {}\n\n",
+                    drops, dropping, sockets.size(), noun);
+        else fmt::format_to(
+                    bi, "Kernel dropped no packets on {} {}\n\n", sockets.size(), noun);
+
+        fmt::format_to(
+                bi, fmt::runtime(SocketsFmt), "DPort", "Groups", "Drops",
+                "Peak queue", "Rcvbuf", "Peak %");
+        SCLine<'='> sep{12};
+        fmt::format_to(
+                bi, fmt::runtime(SocketsFmt), sep(5), sep(6), sep(12),
+                sep(12), sep(12), sep(6));
+        auto shown = std::min(sockets.size(), MaxSocketsShown);
+        for (std::size_t i = 0; i < shown; ++i) {
+            auto const& ss = sockets[i];
+            fmt::format_to(
+                    bi, fmt::runtime(SocketsFmt), ss.dport, ss.subs, ss.drops,
+                    ss.peakQueue, ss.rcvbuf, fmt::format("{:.1f}", occupancy(ss)));
+        }
+        if (shown < sockets.size())
+            fmt::format_to(bi, "and {} more sockets\n", sockets.size() - shown);
+        fmt::format_to(bi, "\n");
+    }
+
+    template <typename OI>
+    void formatLatenciesHeader(OI bi) {
+        fmt::format_to(
+                bi, fmt::runtime(LatencyFmt), "Latency", "Count", "Min", "Mean",
+                "p50", "p90", "p99", "p99.9", "Max");
+        SCLine<'='> sep{15};
+        fmt::format_to(
+                bi, fmt::runtime(LatencyFmt), sep(15), sep(8), sep(10), sep(10),
+                sep(10), sep(10), sep(10), sep(10), sep(10));
+    }
+
+    template <typename OI>
+    void formatLatencies(OI bi, std::string_view name, LatencyHistogram const& h) {
+        fmt::format_to(
+                bi, fmt::runtime(LatencyFmt),
+                name, h.count(), Latency{.value = h.min()}, Latency{.value = h.mean()},
+                Latency{.value = h.percentile(0.5)}, Latency{.value = h.percentile(0.9)},
+                Latency{.value = h.percentile(0.99)}, Latency{.value = h.percentile(0.999)},
+                Latency{.value = h.max()});
+    }
+
+    void showFlowSilence(
+            uint64_t ts, FlowKey const& fk, char const* what, uint64_t ns) {
+        auto& buf = getMemoryBuffer();
+        auto bi = std::back_inserter(buf);
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_WHITE_BRIGHT);
+
+        fmt::format_to(
+                bi, "{} flow {}:{}->{}:{} {} {} ms",
+                Timestamp{.value = ts}, fk.source, fk.sport, fk.group, fk.dport,
+                what, ns / 1'000'000);
+
+        if (cfg_.colors())
+            fmt::format_to(bi, TERM_COLOR_RESET);
+
+        buf.push_back('\n');
+        buf.push_back(static_cast<char>(0));
+        fputs(buf.data(), stdout);
+    }
+
+    template <typename OI>
+    void formatSubscription(OI bi, Subscription const& sub) {
+        if (sub.sources.empty()) fmt::format_to(bi, "(*, {})", sub.group);
+        else if (sub.sources.size() == 1)
+            fmt::format_to(bi, "({}, {})", sub.sources.front(), sub.group);
+        else fmt::format_to(bi, "({} sources, {})", sub.sources.size(), sub.group);
+    }
+
+    template <typename OI>
+    void formatSubscriptions(OI bi) {
+        auto const& subs = cfg_.subscriptions();
+        if (subs.size() > 1) {
+            fmt::format_to(bi, "{} groups", subs.size());
+            return;
+        }
+
+        fmt::format_to(bi, "{}", subs.front().group);
+        if (cfg_.wildcard()) fmt::format_to(bi, ":*");
+        else fmt::format_to(bi, ":{}", subs.front().dport);
+    }
+
+private:
+    inline static char const* const CapGroup{"Group"};
     inline static char const* const CapSource{"Source"};
     inline static char const* const CapDPort{"DPort"};
     inline static char const* const CapPkts{"Pkts"};
     inline static char const* const CapBytes{"Bytes"};
     inline static char const* const CapAPS{"APS"};
     inline static char const* const CapRate{"Rate"};
+    // The number of the groups without traffic listed by showJoinStats()
+    // and of the sources without traffic listed by showSourceStats()
+    static constexpr std::size_t MaxSilentShown{20};
+    // The number of the sockets listed by showRxStats()
+    static constexpr std::size_t MaxSocketsShown{20};
+    inline static char const* const SocketsFmt{
+        "{:>5} {:>6} {:>12} {:>12} {:>12} {:>6}\n"};
+    // The number of the flows listed by formatSeqStats()
+    static constexpr std::size_t MaxSeqFlowsShown{20};
+    inline static char const* const SeqFmt{
+        "{:<15} {:<21} {:>5} {:>12} {:>10} {:>10} {:>10} {:>8}\n"};
+    inline static char const* const CorruptFmt{
+        "{:<15} {:<21} {:>5} {:>12} {:>10}\n"};
+    inline static char const* const OutageFmt{
+        "{:<15} {:<21} {:>5} {:>10} {:>12} {:>7}\n"};
+    inline static char const* const LinesFmt{
+        "{:<15} {:>5} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>8}\n"};
+    inline static char const* const LatencyFmt{
+        "{:<15} {:>8} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n"};
 
     class FlowStatsView final {
     public:
         FlowStatsView(
-                IPv4Address source, uint16_t sport, uint16_t dport,
+                IPv4Address group, IPv4Address source, uint16_t sport, uint16_t dport,
                 FlowStats const& fs, uint64_t duration)
-                : source_{source}
+                : group_{group}
+                , source_{source}
                 , sport_{sport}
                 , dport_{dport}
                 , packets_{fs.pkts()}
@@ -386,6 +1197,12 @@ private:
             else rate_ = fmt::format("{:.2f}Gbps", rate/1'000'000'000);
         }
 
+        [[nodiscard]]
+        size_t groupSize() const { return group_.charlen(); }
+
+        [[nodiscard]]
+        IPv4Address group() const { return group_; }
+
         [[nodiscard]]
         size_t spSize() const { return source_.charlen() + 1 + decimalUIntLen(sport_); }
 
@@ -423,6 +1240,7 @@ private:
         std::string const& rate() const { return rate_; }
 
     private:
+        IPv4Address group_;
         IPv4Address source_;
         uint16_t sport_;
         uint16_t dport_;
@@ -15,41 +15,70 @@ namespace pimc {
  */
 constexpr std::size_t BufferSize{67584};
 
-struct PacketInfo final {
+/*!
+ * The result of the verification of the CRC32C of a received beacon.
+ */
+enum class Integrity: uint8_t {
+    // The packet carries no CRC32C
+    Unchecked = 0,
+    Intact = 1,
+    Corrupt = 2,
+};
+
+/*!
+ * The metadata of a received packet. The packet data itself is stored
+ * elsewhere, either in a receive buffer of RxArena or in place in the
+ * packet ring or in the `io_uring` provided buffers, so the metadata
+ * fits in a single cache line. The fields are ordered by their size to
+ * avoid the padding.
+ */
+struct alignas(64) PacketInfo final {
     uint64_t timestamp;
+    // If the mclstBeacon is true, the remote fields are populated
+    // from the dissected Mclst beacon payload
+    uint64_t remoteSeq;
+    uint64_t remoteTimestamp;
+    // The pointer to the received packet
+    uint8_t const* received;
     IPv4Address source;
-    uint16_t sport;
     IPv4Address group;
-    uint16_t dport;
     // the index of the interface on which the packet was received
     unsigned ifIndex;
+    unsigned receivedSize;
+    unsigned payloadSize;
+    uint16_t sport;
+    uint16_t dport;
     // If ttl field is -1, it means the receiver was unable
     // to get the TTL value
     int16_t ttl;
-    // The packet data
-    uint8_t receivedData[BufferSize];
-    unsigned receivedSize;
-    // The pointer to the start of the payload in the field packet.
-    // Unless the socket is raw, this pointer will point to the first
-    // byte of the packet field
-    uint8_t const* payload;
-    unsigned payloadSize;
-
-    // If the mclstBeacon is true, the rest of the fields are populated
-    // from the dissected Mclst beacon payload
+    // The offset of the payload in the received packet. Unless the
+    // socket is raw, the payload starts at the first byte of the
+    // received packet
+    uint16_t payloadOffset;
+    uint16_t remoteMsgLen;
     bool mclstBeacon;
-    uint64_t remoteSeq;
-    uint64_t remoteTimestamp;
-    size_t remoteMsgLen;
-    char const* remoteMsg;
+    Integrity integrity;
+
+    [[nodiscard]]
+    uint8_t const* payload() const { return received + payloadOffset; }
+
+    [[nodiscard]]
+    char const* remoteMsg() const {
+        return reinterpret_cast<char const*>(payload() + sizeof(MclstBeaconHdr));
+    }
 
     void reset() {
         timestamp = 0ul;
+        group = IPv4Address{};
+        received = nullptr;
         ifIndex = 0;
         ttl = -1;
+        payloadOffset = 0;
         mclstBeacon = false;
+        integrity = Integrity::Unchecked;
     }
 };
 
+static_assert(sizeof(PacketInfo) == 64, "PacketInfo must fit in a cache line");
 
-} // namespace pimc
\ No newline at end of file
+} // namespace pimc
@@ -0,0 +1,267 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <linux/net_tstamp.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The size of a single block of the packet ring.
+ *
+ * A block must accommodate the largest reassembled IPv4 datagram along
+ * with the frame headers, as the frames never span the blocks.
+ */
+constexpr unsigned PacketRingBlockSize{1u << 20u};
+
+/*!
+ * \brief A `TPACKET_V3` memory mapped receive ring of an `AF_PACKET`
+ * socket.
+ *
+ * The kernel writes the IPv4 packets received on the interface directly
+ * into the blocks of the ring and hands a block over to the user space
+ * once it is full or once its retire timeout expires, so a single poller
+ * wakeup delivers a whole block of packets, which are then processed in
+ * place without being copied.
+ *
+ * The socket is a member of a packet fanout group, which spreads the
+ * packets among the rings of the receive threads by the flow hash. The
+ * fanout group also defragments the IPv4 packets, so that the ring
+ * contains the reassembled datagrams just like a raw IP socket would.
+ */
+class PacketRing final {
+public:
+    /*!
+     * \brief A packet received in the ring.
+     */
+    struct Frame final {
+        // The IPv4 packet starting with the IPv4 header
+        uint8_t const* data;
+        unsigned size;
+        // The kernel receive timestamp in nanoseconds
+        uint64_t timestamp;
+        unsigned ifIndex;
+    };
+
+    /*!
+     * \brief Creates a ring on the interface \p ifIndex.
+     *
+     * @param ifIndex the index of the interface on which to receive
+     * @param blocks the number of blocks in the ring
+     * @param fanoutId the ID of the fanout group to join or 0 to create
+     * a new fanout group with a unique ID
+     * @param hwTimestamps if true, the frames are timestamped using the
+     * NIC hardware timestamps if available
+     */
+    PacketRing(unsigned ifIndex, unsigned blocks, uint16_t fanoutId, bool hwTimestamps)
+    : socket_{socket(AF_PACKET, SOCK_DGRAM, 0)}
+    , ring_{nullptr}
+    , blocks_{blocks}
+    , current_{0}
+    , fanoutId_{fanoutId} {
+        if (socket_ == -1) {
+            if (errno == EPERM)
+                raise<std::runtime_error>(
+                        "permission to open packet socket denied, "
+                        "try running under sudo");
+            raise<std::runtime_error>("unable to open packet socket: {}", SysError{});
+        }
+
+        try {
+            setup(ifIndex, hwTimestamps);
+        } catch (...) {
+            close();
+            throw;
+        }
+    }
+
+    PacketRing(PacketRing const&) = delete;
+    PacketRing(PacketRing&&) = delete;
+    PacketRing& operator= (PacketRing const&) = delete;
+    PacketRing& operator= (PacketRing&&) = delete;
+
+    ~PacketRing() { close(); }
+
+    /*!
+     * @return the socket which becomes readable when a block is ready
+     */
+    [[nodiscard]]
+    int fd() const { return socket_; }
+
+    /*!
+     * @return the ID of the fanout group of the ring
+     */
+    [[nodiscard]]
+    uint16_t fanoutId() const { return fanoutId_; }
+
+    /*!
+     * @return true if the current block has been handed over to the user
+     * space
+     */
+    [[nodiscard]]
+    bool ready() const {
+        auto const* bd = block(current_);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return (bd->hdr.bh1.block_status & TP_STATUS_USER) != 0;
+    }
+
+    /*!
+     * \brief Calls \p f for each frame of the current block, which must be
+     * ready, and then returns the block back to the kernel.
+     *
+     * The frames are only valid until \p f returns. If \p f returns true,
+     * the iteration stops early and the rest of the frames of the block
+     * are dropped.
+     *
+     * @param f the callable taking a Frame const& and returning bool
+     * @return true if the iteration was stopped by \p f, false otherwise
+     */
+    template <typename F>
+    bool drainBlock(F&& f) {
+        auto* bd = block(current_);
+        auto const* base = reinterpret_cast<uint8_t const*>(bd);
+        auto n = bd->hdr.bh1.num_pkts;
+        auto offset = bd->hdr.bh1.offset_to_first_pkt;
+
+        bool stop{false};
+        for (uint32_t i = 0; i < n and not stop; ++i) {
+            auto const* fp = base + offset;
+            auto const* hdr = reinterpret_cast<tpacket3_hdr const*>(fp);
+            auto const* sll = reinterpret_cast<sockaddr_ll const*>(
+                    fp + FrameHdrSize);
+            offset += hdr->tp_next_offset;
+
+            // Packets sent by this host are seen on the way out
+            if (PIMC_UNLIKELY(sll->sll_pkttype == PACKET_OUTGOING)) continue;
+
+            Frame frame{
+                .data = fp + hdr->tp_net,
+                .size = hdr->tp_snaplen,
+                .timestamp = static_cast<uint64_t>(hdr->tp_sec) * 1'000'000'000ul +
+                             hdr->tp_nsec,
+                .ifIndex = static_cast<unsigned>(sll->sll_ifindex)
+            };
+            stop = f(frame);
+        }
+
+        std::atomic_thread_fence(std::memory_order_release);
+        bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        current_ = (current_ + 1) % blocks_;
+
+        return stop;
+    }
+
+private:
+    void setup(unsigned ifIndex, bool hwTimestamps) {
+        int version = TPACKET_V3;
+        if (setsockopt(socket_, SOL_PACKET, PACKET_VERSION,
+                       &version, sizeof(version)) == -1)
+            raise<std::runtime_error>(
+                    "unable to set TPACKET_V3 packet socket version: {}", SysError{});
+
+        tpacket_req3 req{};
+        req.tp_block_size = PacketRingBlockSize;
+        req.tp_block_nr = blocks_;
+        req.tp_frame_size = TPACKET_ALIGNMENT << 7u;
+        req.tp_frame_nr = (PacketRingBlockSize / req.tp_frame_size) * blocks_;
+        req.tp_retire_blk_tov = RetireBlockTimeoutMs;
+        req.tp_feature_req_word = 0;
+        if (setsockopt(socket_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) == -1)
+            raise<std::runtime_error>(
+                    "unable to create packet ring of {} blocks: {}", blocks_, SysError{});
+
+        auto size = static_cast<std::size_t>(PacketRingBlockSize) * blocks_;
+        auto* ring = mmap(
+                nullptr, size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_LOCKED | MAP_POPULATE, socket_, 0);
+        if (ring == MAP_FAILED) {
+            // The locked memory limit may be too low
+            ring = mmap(
+                    nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, socket_, 0);
+            if (ring == MAP_FAILED)
+                raise<std::runtime_error>("unable to map packet ring: {}", SysError{});
+        }
+        ring_ = static_cast<uint8_t*>(ring);
+
+        if (hwTimestamps) {
+            int ts = SOF_TIMESTAMPING_RAW_HARDWARE;
+            // The software timestamps are used if this fails
+            setsockopt(socket_, SOL_PACKET, PACKET_TIMESTAMP, &ts, sizeof(ts));
+        }
+
+        sockaddr_ll sll{};
+        sll.sll_family = AF_PACKET;
+        sll.sll_protocol = htons(ETH_P_IP);
+        sll.sll_ifindex = static_cast<int>(ifIndex);
+        if (bind(socket_, reinterpret_cast<sockaddr*>(&sll), sizeof(sll)) == -1)
+            raise<std::runtime_error>("unable to bind packet socket: {}", SysError{});
+
+        uint32_t fanoutFlags = PACKET_FANOUT_FLAG_DEFRAG;
+        if (fanoutId_ == 0) fanoutFlags |= PACKET_FANOUT_FLAG_UNIQUEID;
+        uint32_t fanout = fanoutId_ | ((PACKET_FANOUT_HASH | fanoutFlags) << 16u);
+        if (setsockopt(socket_, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) == -1)
+            raise<std::runtime_error>(
+                    "unable to join packet fanout group: {}", SysError{});
+
+        if (fanoutId_ == 0) {
+            socklen_t len = sizeof(fanout);
+            if (getsockopt(socket_, SOL_PACKET, PACKET_FANOUT, &fanout, &len) == -1)
+                raise<std::runtime_error>(
+                        "unable to query packet fanout group: {}", SysError{});
+            fanoutId_ = static_cast<uint16_t>(fanout & 0xffffu);
+        }
+    }
+
+    [[nodiscard]]
+    tpacket_block_desc* block(unsigned i) const {
+        return reinterpret_cast<tpacket_block_desc*>(
+                ring_ + static_cast<std::size_t>(i) * PacketRingBlockSize);
+    }
+
+    void close() {
+        if (ring_ != nullptr)
+            munmap(ring_, static_cast<std::size_t>(PacketRingBlockSize) * blocks_);
+
+        int rc;
+        do {
+            rc = ::close(socket_);
+        } while (rc == -1 and errno == EINTR);
+    }
+
+private:
+    // The time after which a partially filled block is handed over to the
+    // user space
+    static constexpr unsigned RetireBlockTimeoutMs{10};
+    // The size of the frame header which precedes the link layer address,
+    // same as TPACKET_ALIGN(sizeof(tpacket3_hdr))
+    static constexpr std::size_t FrameHdrSize{
+        (sizeof(tpacket3_hdr) + TPACKET_ALIGNMENT - 1) &
+        ~(std::size_t{TPACKET_ALIGNMENT} - 1)};
+
+    int socket_;
+    uint8_t* ring_;
+    unsigned blocks_;
+    unsigned current_;
+    uint16_t fanoutId_;
+};
+
+} // namespace pimc
+
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <net/if.h>
+
+#include <memory>
+
+#include "pimc/unix/CapState.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+#include "IPv4UdpDissector.hpp"
+#include "PacketRing.hpp"
+#include "ReceiverBase.hpp"
+#include "RxFilter.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The portless receiver provider which receives the packets from
+ * a `TPACKET_V3` ring of an `AF_PACKET` socket bound to the interface.
+ *
+ * Unlike IPRawReceiver, which copies every UDP packet received by the
+ * host into the user space only to throw most of them away, the packets
+ * are dissected in place in the ring, and a single poller wakeup delivers
+ * a whole block of packets.
+ *
+ * The sockets opened with openSocket() are only used to join the groups
+ * and never receive any traffic.
+ */
+template <Limiter Limit, OutputPolicy Output>
+class PacketRingReceiver: public ReceiverBase<PacketRingReceiver<Limit, Output>, Limit, Output> {
+    using Base = ReceiverBase<PacketRingReceiver<Limit, Output>, Limit, Output>;
+
+public:
+    PacketRingReceiver(Config const& cfg, OutputHandler& oh, bool& stopped)
+    : Base{cfg, oh, stopped}, dissector_{cfg, oh}, filter_{cfg}, fanoutId_{0} {}
+
+protected:
+    using Base::cfg_;
+    using Base::oh_;
+    using Base::dissectMclstBeaconPayload;
+
+public:
+    auto openSocket(char const*) -> int {
+        int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+        if (s == -1)
+            raise<std::runtime_error>("unable to create socket: {}", SysError{});
+
+        return s;
+    }
+
+    /*!
+     * \brief Opens the packet ring of a receive thread. The rings of all
+     * the receive threads are members of the same fanout group.
+     *
+     * @param progname the name of the program used to raise capabilities
+     * @return the packet ring
+     */
+    auto openRing(char const* progname) -> std::unique_ptr<PacketRing> {
+        auto r = CapState::program(progname).raise(CAP_(NET_RAW));
+        if (not r)
+            throw std::runtime_error{r.error()};
+
+        auto ifIndex = if_nametoindex(cfg_.intf().c_str());
+        if (ifIndex == 0)
+            raise<std::runtime_error>(
+                    "unable to query the index of interface {}: {}",
+                    cfg_.intf(), SysError{});
+
+        auto ring = std::make_unique<PacketRing>(
+                ifIndex, cfg_.ring(), fanoutId_,
+                cfg_.rxTimestamps() == RxTimestamps::Hardware);
+        fanoutId_ = ring->fanoutId();
+
+        // The packet socket receives all the IPv4 traffic of the interface
+        filter_.attach(ring->fd(), oh_);
+
+        return ring;
+    }
+
+    auto processPacket(
+            sockaddr_in const&, PacketInfo& pktInfo) -> PacketStatus {
+        auto ps = dissector_.dissect(pktInfo);
+        if (ps == PacketStatus::AcceptedShow)
+            dissectMclstBeaconPayload(pktInfo);
+
+        return ps;
+    };
+
+private:
+    IPv4UdpDissector dissector_;
+    RxFilter filter_;
+    uint16_t fanoutId_;
+};
+
+} // namespace pimc
+
+#endif
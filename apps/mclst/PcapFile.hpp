@@ -0,0 +1,414 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief A memory mapped pcap or pcapng capture file, whose frames are
+ * read in place.
+ *
+ * Both the classic pcap files with the microsecond or the nanosecond
+ * timestamps and the pcapng files with any number of sections and
+ * interfaces are supported, in either byte order. The link layer headers
+ * of the Ethernet, with any number of VLAN tags, the Linux cooked
+ * captures, the BSD loopback and the raw IP link types are stripped, and
+ * only the IPv4 packets are passed on. The file is read sequentially, so
+ * the kernel reads it ahead as fast as the disk allows.
+ */
+class PcapFile final {
+public:
+    /*!
+     * \brief An IPv4 packet of the capture file.
+     */
+    struct Frame final {
+        // The IPv4 header of the packet
+        uint8_t const* data;
+        // The captured size of the packet, which is less than its actual
+        // size if the capture was truncated to the snapshot length
+        unsigned size;
+        // The capture time in nanoseconds, 0 if not recorded
+        uint64_t timestamp;
+    };
+
+    explicit PcapFile(std::string const& fn): fn_{fn}, data_{nullptr}, size_{0} {
+        int fd = open(fn.c_str(), O_RDONLY);
+        if (fd == -1)
+            raise<std::runtime_error>("unable to open capture file '{}': {}", fn, SysError{});
+
+        struct stat st{};
+        if (fstat(fd, &st) == -1) {
+            SysError err{};
+            close(fd);
+            raise<std::runtime_error>("unable to stat capture file '{}': {}", fn, err);
+        }
+
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ < sizeof(uint32_t)) {
+            close(fd);
+            raise<std::runtime_error>("'{}' is not a pcap or pcapng file", fn);
+        }
+
+        auto* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        SysError err{};
+        close(fd);
+        if (p == MAP_FAILED)
+            raise<std::runtime_error>("unable to map capture file '{}': {}", fn, err);
+
+        data_ = static_cast<uint8_t const*>(p);
+        madvise(p, size_, MADV_SEQUENTIAL);
+    }
+
+    PcapFile(PcapFile const&) = delete;
+    PcapFile(PcapFile&&) = delete;
+    PcapFile& operator= (PcapFile const&) = delete;
+    PcapFile& operator= (PcapFile&&) = delete;
+
+    ~PcapFile() {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+
+    /*!
+     * \brief Calls \p f for each IPv4 packet of the capture file in order.
+     *
+     * @param f the callable taking the Frame const& and returning true to
+     * stop reading
+     */
+    template <typename F>
+    void forEach(F&& f) {
+        uint32_t magic;
+        memcpy(&magic, data_, sizeof(magic));
+
+        switch (magic) {
+        case PcapMicros:
+        case PcapNanos:
+        case swap(PcapMicros):
+        case swap(PcapNanos):
+            readPcap(f);
+            break;
+        case PcapngShb:
+            readPcapng(f);
+            break;
+        default:
+            raise<std::runtime_error>("'{}' is not a pcap or pcapng file", fn_);
+        }
+    }
+
+    /*!
+     * @return the size of the file in bytes
+     */
+    [[nodiscard]]
+    std::size_t size() const { return size_; }
+
+    /*!
+     * @return the number of the frames read, including the skipped ones
+     */
+    [[nodiscard]]
+    uint64_t frames() const { return frames_; }
+
+    /*!
+     * @return the number of the frames which are not IPv4 packets or
+     * whose link type is not supported
+     */
+    [[nodiscard]]
+    uint64_t skipped() const { return skipped_; }
+
+    /*!
+     * @return true if the file ends in the middle of a frame, e.g. as the
+     * capture was interrupted
+     */
+    [[nodiscard]]
+    bool truncated() const { return truncated_; }
+
+private:
+    static constexpr uint32_t PcapMicros{0xa1b2c3d4};
+    static constexpr uint32_t PcapNanos{0xa1b23c4d};
+    static constexpr uint32_t PcapngShb{0x0a0d0d0a};
+    static constexpr uint32_t PcapngIdb{1};
+    static constexpr uint32_t PcapngSpb{3};
+    static constexpr uint32_t PcapngEpb{6};
+    static constexpr uint32_t PcapngByteOrder{0x1a2b3c4d};
+    static constexpr uint16_t PcapngTsResol{9};
+    static constexpr std::size_t PcapHdrSize{24};
+    static constexpr std::size_t PcapRecHdrSize{16};
+
+    // The link types
+    static constexpr unsigned LinkNull{0};
+    static constexpr unsigned LinkEthernet{1};
+    static constexpr unsigned LinkRaw{101};
+    static constexpr unsigned LinkLoop{108};
+    static constexpr unsigned LinkLinuxSll{113};
+    static constexpr unsigned LinkIPv4{228};
+    static constexpr unsigned LinkLinuxSll2{276};
+    // The link types of the raw IP on some platforms
+    static constexpr unsigned LinkRawAlt1{12};
+    static constexpr unsigned LinkRawAlt2{14};
+
+    static constexpr uint32_t swap(uint32_t v) { return __builtin_bswap32(v); }
+
+    /*!
+     * The link type and the timestamp resolution of a pcapng interface.
+     */
+    struct PcapngIntf final {
+        unsigned linkType;
+        uint32_t snapLen;
+        // The timestamp units per second
+        uint64_t tsUnits;
+    };
+
+    PIMC_ALWAYS_INLINE
+    uint16_t u16(uint8_t const* p) const {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return swapped_ ? __builtin_bswap16(v) : v;
+    }
+
+    PIMC_ALWAYS_INLINE
+    uint32_t u32(uint8_t const* p) const {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return swapped_ ? swap(v) : v;
+    }
+
+    PIMC_ALWAYS_INLINE
+    static uint16_t be16(uint8_t const* p) {
+        return static_cast<uint16_t>((p[0] << 8u) | p[1]);
+    }
+
+    template <typename F>
+    void readPcap(F& f) {
+        if (PIMC_UNLIKELY(size_ < PcapHdrSize)) {
+            truncated_ = true;
+            return;
+        }
+
+        uint32_t magic;
+        memcpy(&magic, data_, sizeof(magic));
+        swapped_ = magic == swap(PcapMicros) or magic == swap(PcapNanos);
+        uint64_t fracNanos = magic == PcapNanos or magic == swap(PcapNanos) ? 1 : 1000;
+        // The upper bits may hold the FCS length
+        unsigned linkType = u32(data_ + 20) & 0xffffu;
+
+        std::size_t off{PcapHdrSize};
+        while (off < size_) {
+            if (PIMC_UNLIKELY(size_ - off < PcapRecHdrSize)) {
+                truncated_ = true;
+                return;
+            }
+
+            auto const* rec = data_ + off;
+            auto capLen = u32(rec + 8);
+            off += PcapRecHdrSize;
+            if (PIMC_UNLIKELY(capLen > size_ - off)) {
+                truncated_ = true;
+                return;
+            }
+
+            auto ts = static_cast<uint64_t>(u32(rec)) * 1'000'000'000ul
+                    + static_cast<uint64_t>(u32(rec + 4)) * fracNanos;
+            if (frame(f, linkType, data_ + off, capLen, ts)) return;
+            off += capLen;
+        }
+    }
+
+    template <typename F>
+    void readPcapng(F& f) {
+        std::vector<PcapngIntf> intfs;
+
+        std::size_t off{0};
+        while (off < size_) {
+            if (PIMC_UNLIKELY(size_ - off < 12)) {
+                truncated_ = true;
+                return;
+            }
+
+            auto const* blk = data_ + off;
+            uint32_t type;
+            memcpy(&type, blk, sizeof(type));
+            // The section header block determines the byte order of the
+            // section, its type reads the same in either byte order
+            if (type == PcapngShb) {
+                uint32_t byteOrder;
+                memcpy(&byteOrder, blk + 8, sizeof(byteOrder));
+                if (byteOrder != PcapngByteOrder and byteOrder != swap(PcapngByteOrder))
+                    raise<std::runtime_error>(
+                            "'{}' is not a pcap or pcapng file", fn_);
+                swapped_ = byteOrder != PcapngByteOrder;
+                intfs.clear();
+            }
+
+            type = u32(blk);
+            auto len = u32(blk + 4);
+            if (PIMC_UNLIKELY(len < 12 or len > size_ - off)) {
+                truncated_ = true;
+                return;
+            }
+
+            if (type == PcapngEpb and len >= 32) {
+                auto intf = u32(blk + 8);
+                auto capLen = u32(blk + 20);
+                if (PIMC_LIKELY(intf < intfs.size() and capLen <= len - 32)) {
+                    auto ticks = (static_cast<uint64_t>(u32(blk + 12)) << 32u) | u32(blk + 16);
+                    auto const& pi = intfs[intf];
+                    if (frame(f, pi.linkType, blk + 28, capLen, toNanos(ticks, pi.tsUnits)))
+                        return;
+                } else ++skipped_;
+            } else if (type == PcapngSpb and len >= 16) {
+                if (PIMC_LIKELY(not intfs.empty())) {
+                    auto capLen = std::min({u32(blk + 8), len - 16, intfs[0].snapLen});
+                    if (frame(f, intfs[0].linkType, blk + 12, capLen, 0))
+                        return;
+                } else ++skipped_;
+            } else if (type == PcapngIdb and len >= 20) {
+                intfs.push_back(PcapngIntf{
+                    .linkType = u16(blk + 8),
+                    .snapLen = u32(blk + 12) == 0 ? UINT32_MAX : u32(blk + 12),
+                    .tsUnits = tsUnits(blk + 16, blk + len - 4),
+                });
+            }
+
+            off += len;
+        }
+    }
+
+    /*!
+     * Returns the timestamp units per second of the interface from its
+     * if_tsresol option, by default the timestamps are in microseconds.
+     * The resolutions finer than nanoseconds are scaled down to them, as
+     * long as the units per second fit in 64 bits.
+     */
+    uint64_t tsUnits(uint8_t const* opt, uint8_t const* end) const {
+        while (end - opt >= 4) {
+            auto code = u16(opt);
+            auto len = u16(opt + 2);
+            if (code == 0 or len > end - opt - 4) break;
+
+            if (code == PcapngTsResol and len >= 1) {
+                auto resol = opt[4];
+                bool binary = resol & 0x80u;
+                unsigned exp = resol & 0x7fu;
+                if (exp > (binary ? 63u : 19u))
+                    raise<std::runtime_error>(
+                            "unsupported timestamp resolution {}^-{} in "
+                            "capture file '{}'", binary ? 2 : 10, exp, fn_);
+
+                uint64_t units{1};
+                for (unsigned i = 0; i < exp; ++i)
+                    units *= binary ? 2u : 10u;
+                return units;
+            }
+
+            opt += 4 + ((len + 3u) & ~3u);
+        }
+
+        return 1'000'000;
+    }
+
+    PIMC_ALWAYS_INLINE
+    static uint64_t toNanos(uint64_t ticks, uint64_t units) {
+        if (PIMC_LIKELY(units == 1'000'000'000ul))
+            return ticks;
+        if (units <= 1'000'000'000ul)
+            return ticks / units * 1'000'000'000ul + ticks % units * 1'000'000'000ul / units;
+
+        // The fraction of the second would overflow in the finer units,
+        // so it is rounded to the nearest nanosecond
+        auto fraction = static_cast<double>(ticks % units) / static_cast<double>(units);
+        return ticks / units * 1'000'000'000ul + static_cast<uint64_t>(fraction * 1e9 + 0.5);
+    }
+
+    /*!
+     * Strips the link layer header of the frame and passes it on to \p f
+     * if it is an IPv4 packet.
+     *
+     * @return true if \p f has requested to stop reading
+     */
+    template <typename F>
+    PIMC_ALWAYS_INLINE
+    bool frame(F& f, unsigned linkType,
+               uint8_t const* data, unsigned size, uint64_t ts) {
+        ++frames_;
+        if (PIMC_UNLIKELY(not ipv4(linkType, data, size))) {
+            ++skipped_;
+            return false;
+        }
+
+        return f(Frame{.data = data, .size = size, .timestamp = ts});
+    }
+
+    static bool ipv4(unsigned linkType, uint8_t const*& data, unsigned& size) {
+        unsigned off;
+        switch (linkType) {
+        case LinkEthernet: {
+            if (size < 14) return false;
+            auto etherType = be16(data + 12);
+            off = 14;
+            // The 802.1Q and 802.1ad tags
+            while (etherType == 0x8100 or etherType == 0x88a8 or etherType == 0x9100) {
+                if (size < off + 4) return false;
+                etherType = be16(data + off + 2);
+                off += 4;
+            }
+            if (etherType != 0x0800) return false;
+            break;
+        }
+        case LinkRaw:
+        case LinkRawAlt1:
+        case LinkRawAlt2:
+        case LinkIPv4:
+            if (size < 1 or (data[0] >> 4u) != 4) return false;
+            off = 0;
+            break;
+        case LinkLinuxSll:
+            if (size < 16 or be16(data + 14) != 0x0800) return false;
+            off = 16;
+            break;
+        case LinkLinuxSll2:
+            if (size < 20 or be16(data) != 0x0800) return false;
+            off = 20;
+            break;
+        case LinkNull:
+        case LinkLoop: {
+            // The address family is in the byte order of the capturing
+            // host for the null link type and big endian for the loopback
+            if (size < 4) return false;
+            uint32_t family;
+            memcpy(&family, data, sizeof(family));
+            if (family != 2 and swap(family) != 2) return false;
+            off = 4;
+            break;
+        }
+        default:
+            return false;
+        }
+
+        data += off;
+        size -= off;
+        return true;
+    }
+
+private:
+    std::string fn_;
+    uint8_t const* data_;
+    std::size_t size_;
+    bool swapped_{false};
+    bool truncated_{false};
+    uint64_t frames_{0};
+    uint64_t skipped_{0};
+};
+
+} // namespace pimc
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <fcntl.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/Fmt.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+#include "PacketInfo.hpp"
+
+namespace pimc {
+
+/*!
+ * The size of the IPv4 and UDP headers prepended to the packets received
+ * on a UDP socket when they are captured.
+ */
+constexpr unsigned CapturedHeadersSize{28};
+
+/*!
+ * @return the length of the headers prepended to the packet \p pktInfo
+ * when it is captured, which is 0 unless it has been received on a UDP
+ * socket, which only receives the payload
+ */
+PIMC_ALWAYS_INLINE
+unsigned capturedHeadersLen(PacketInfo const& pktInfo) {
+    // Without the offset the payload starts at the first byte
+    return pktInfo.payloadOffset == 0 ? CapturedHeadersSize : 0;
+}
+
+/*!
+ * \brief Formats the IPv4 and UDP headers of the packet \p pktInfo
+ * received on a UDP socket. The UDP checksum is left out.
+ */
+inline void formatCapturedHeaders(uint8_t* hdrs, PacketInfo const& pktInfo) {
+    auto ipLen = static_cast<uint16_t>(CapturedHeadersSize + pktInfo.payloadSize);
+    auto udpLen = static_cast<uint16_t>(ipLen - 20u);
+    auto ttl = pktInfo.ttl < 0 ? 1 : pktInfo.ttl;
+
+    memset(hdrs, 0, CapturedHeadersSize);
+    hdrs[0] = 0x45;
+    hdrs[2] = static_cast<uint8_t>(ipLen >> 8u);
+    hdrs[3] = static_cast<uint8_t>(ipLen);
+    hdrs[8] = static_cast<uint8_t>(ttl);
+    hdrs[9] = IPPROTO_UDP;
+    auto src = htonl(pktInfo.source.value());
+    auto dst = htonl(pktInfo.group.value());
+    memcpy(hdrs + 12, &src, sizeof(src));
+    memcpy(hdrs + 16, &dst, sizeof(dst));
+
+    uint32_t sum{0};
+    for (unsigned i = 0; i < 20; i += 2)
+        sum += static_cast<uint32_t>(hdrs[i] << 8u | hdrs[i + 1]);
+    while (sum > 0xffff)
+        sum = (sum & 0xffffu) + (sum >> 16u);
+    auto csum = static_cast<uint16_t>(~sum);
+    hdrs[10] = static_cast<uint8_t>(csum >> 8u);
+    hdrs[11] = static_cast<uint8_t>(csum);
+
+    hdrs[20] = static_cast<uint8_t>(pktInfo.sport >> 8u);
+    hdrs[21] = static_cast<uint8_t>(pktInfo.sport);
+    hdrs[22] = static_cast<uint8_t>(pktInfo.dport >> 8u);
+    hdrs[23] = static_cast<uint8_t>(pktInfo.dport);
+    hdrs[24] = static_cast<uint8_t>(udpLen >> 8u);
+    hdrs[25] = static_cast<uint8_t>(udpLen);
+}
+
+/*!
+ * \brief Copies the first \p capLen bytes of the packet \p pktInfo
+ * preceded by the \p hdrLen bytes of its headers to \p p.
+ */
+inline void copyCaptured(
+        uint8_t* p, PacketInfo const& pktInfo, unsigned hdrLen, unsigned capLen) {
+    if (hdrLen > 0) {
+        uint8_t hdrs[CapturedHeadersSize];
+        formatCapturedHeaders(hdrs, pktInfo);
+        auto n = std::min(capLen, hdrLen);
+        memcpy(p, hdrs, n);
+        p += n;
+    }
+    if (capLen > hdrLen)
+        memcpy(p, pktInfo.received, capLen - hdrLen);
+}
+
+/*!
+ * @return the name of the capture file \p n of a series, into which the
+ * number is inserted before the extension of \p fn unless it is the first
+ * one, e.g. mclst.pcapng, mclst.1.pcapng, etc.
+ */
+inline std::string numberedFileName(std::string const& fn, unsigned n) {
+    if (n == 0) return fn;
+
+    auto slash = fn.rfind('/');
+    auto dot = fn.rfind('.');
+    if (dot == std::string::npos or dot == 0 or
+        (slash != std::string::npos and dot < slash + 2))
+        return fmt::format("{}.{}", fn, n);
+
+    return fmt::format("{}.{}{}", fn.substr(0, dot), n, fn.substr(dot));
+}
+
+/*!
+ * \brief Writes the packets to a pcapng file through an output buffer,
+ * so the file is written in a few large `write()` calls.
+ *
+ * The packets are written as raw IPv4 packets with the nanosecond
+ * timestamps, and each interface on which they are received is described
+ * in the file as it is first seen. The writer may be reopened for the
+ * next file once the current one is closed.
+ */
+class PcapngWriter final {
+public:
+    explicit PcapngWriter(unsigned snaplen)
+    : snaplen_{snaplen}, fd_{-1}, fileSize_{0}, filePackets_{0}, written_{0} {
+        out_.reserve(OutputSize);
+    }
+
+    PcapngWriter(PcapngWriter const&) = delete;
+    PcapngWriter(PcapngWriter&&) = delete;
+    PcapngWriter& operator= (PcapngWriter const&) = delete;
+    PcapngWriter& operator= (PcapngWriter&&) = delete;
+
+    ~PcapngWriter() {
+        if (fd_ != -1) ::close(fd_);
+    }
+
+    /*!
+     * \brief Creates the capture file \p fn and writes its section header.
+     */
+    void open(std::string fn) {
+        fn_ = std::move(fn);
+        fd_ = ::open(fn_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ == -1)
+            raise<std::runtime_error>(
+                    "unable to create capture file '{}': {}", fn_, SysError{});
+
+        fileSize_ = 0;
+        filePackets_ = 0;
+        ifIndices_.clear();
+        out_.clear();
+
+        // Section Header Block with the shb_userappl option
+        char const app[] = "mclst";
+        uint32_t blockLen = 28 + 4 + pad4(sizeof(app) - 1) + 4;
+        append32(0x0a0d0d0a);
+        append32(blockLen);
+        append32(0x1a2b3c4d);
+        append16(1);
+        append16(0);
+        // The section length is not specified
+        append32(0xffffffff);
+        append32(0xffffffff);
+        append16(4);
+        append16(sizeof(app) - 1);
+        append(app, sizeof(app) - 1);
+        appendPadding(sizeof(app) - 1);
+        append32(0);
+        append32(blockLen);
+    }
+
+    /*!
+     * \brief Writes the rest of the output buffer and closes the file.
+     */
+    void close() {
+        if (fd_ == -1) return;
+
+        flush();
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    [[nodiscard]]
+    bool isOpen() const { return fd_ != -1; }
+
+    /*!
+     * \brief Writes the packet whose first \p capLen bytes out of
+     * \p origLen are in \p data.
+     */
+    void writePacket(
+            uint64_t timestamp, unsigned ifIndex,
+            uint8_t const* data, unsigned capLen, unsigned origLen) {
+        // Enhanced Packet Block
+        auto blockLen = blockSize(capLen);
+        auto ifId = interfaceId(ifIndex);
+        append32(0x00000006);
+        append32(blockLen);
+        append32(ifId);
+        append32(static_cast<uint32_t>(timestamp >> 32u));
+        append32(static_cast<uint32_t>(timestamp));
+        append32(capLen);
+        append32(origLen);
+        append(data, capLen);
+        appendPadding(capLen);
+        append32(blockLen);
+
+        ++filePackets_;
+    }
+
+    /*!
+     * @return the size of the block in which a packet of \p capLen
+     * captured bytes is written
+     */
+    static constexpr uint32_t blockSize(unsigned capLen) {
+        return 28 + pad4(capLen) + 4;
+    }
+
+    /*!
+     * @return the name of the current or the last file
+     */
+    [[nodiscard]]
+    std::string const& fileName() const { return fn_; }
+
+    /*!
+     * @return the size of the current file including the buffered output
+     */
+    [[nodiscard]]
+    uint64_t size() const { return fileSize_ + out_.size(); }
+
+    /*!
+     * @return the number of the packets written to the current file
+     */
+    [[nodiscard]]
+    uint64_t packets() const { return filePackets_; }
+
+    /*!
+     * @return the number of the bytes written to all files
+     */
+    [[nodiscard]]
+    uint64_t written() const { return written_; }
+
+private:
+    /*!
+     * @return the pcapng interface ID of the interface \p ifIndex, whose
+     * Interface Description Block is written when it is first seen
+     */
+    uint32_t interfaceId(unsigned ifIndex) {
+        auto it = std::find(ifIndices_.begin(), ifIndices_.end(), ifIndex);
+        if (PIMC_LIKELY(it != ifIndices_.end()))
+            return static_cast<uint32_t>(it - ifIndices_.begin());
+
+        char name[IF_NAMESIZE]{};
+        if (ifIndex == 0 or if_indextoname(ifIndex, name) == nullptr)
+            name[0] = '\0';
+        auto nameLen = static_cast<uint32_t>(strlen(name));
+
+        // The name option, the timestamp resolution option and the end
+        uint32_t optLen = (nameLen > 0 ? 4 + pad4(nameLen) : 0) + 8 + 4;
+        auto blockLen = 20 + optLen;
+        append32(0x00000001);
+        append32(blockLen);
+        // LINKTYPE_RAW, the packets start with the IPv4 header
+        append16(101);
+        append16(0);
+        append32(snaplen_);
+        if (nameLen > 0) {
+            append16(2);
+            append16(static_cast<uint16_t>(nameLen));
+            append(name, nameLen);
+            appendPadding(nameLen);
+        }
+        // if_tsresol: nanoseconds
+        append16(9);
+        append16(1);
+        out_.push_back(9);
+        appendPadding(1);
+        append32(0);
+        append32(blockLen);
+
+        ifIndices_.push_back(ifIndex);
+        return static_cast<uint32_t>(ifIndices_.size() - 1);
+    }
+
+    void flush() {
+        std::size_t written{0};
+        while (written < out_.size()) {
+            auto rc = write(fd_, out_.data() + written, out_.size() - written);
+            if (rc == -1) {
+                if (errno == EINTR) continue;
+                out_.clear();
+                raise<std::runtime_error>(
+                        "unable to write capture file '{}': {}", fn_, SysError{});
+            }
+            written += static_cast<std::size_t>(rc);
+        }
+
+        fileSize_ += out_.size();
+        written_ += out_.size();
+        out_.clear();
+    }
+
+    void append(void const* data, std::size_t len) {
+        if (PIMC_UNLIKELY(out_.size() + len > OutputSize)) flush();
+
+        auto const* p = static_cast<uint8_t const*>(data);
+        out_.insert(out_.end(), p, p + len);
+    }
+
+    void append16(uint16_t v) { append(&v, sizeof(v)); }
+
+    void append32(uint32_t v) { append(&v, sizeof(v)); }
+
+    void appendPadding(std::size_t len) {
+        static constexpr uint8_t zeros[4]{};
+        append(zeros, pad4(len) - len);
+    }
+
+    static constexpr uint32_t pad4(std::size_t len) {
+        return static_cast<uint32_t>((len + 3u) & ~std::size_t{3});
+    }
+
+private:
+    static constexpr std::size_t OutputSize{1u << 20u};
+
+    unsigned snaplen_;
+    std::string fn_;
+    int fd_;
+    uint64_t fileSize_;
+    uint64_t filePackets_;
+    uint64_t written_;
+    // The interface ID in the current file is the index of the interface
+    std::vector<unsigned> ifIndices_;
+    std::vector<uint8_t> out_;
+};
+
+} // namespace pimc
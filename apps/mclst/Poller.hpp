@@ -0,0 +1,152 @@
+#pragma once
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#ifdef __APPLE__
+#include <sys/time.h>
+#include <sys/select.h>
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief Waits for the data on multiple sockets.
+ *
+ * Each socket is registered with an ID, which is typically the index of
+ * the socket in the owner's table of sockets. Once wait() returns, the
+ * IDs of the sockets which have data can be obtained with ready().
+ *
+ * In Linux the poller is backed by `epoll`, so the cost of a wakeup
+ * doesn't depend on the number of the registered sockets. In macOS it
+ * is backed by `select()`.
+ */
+class Poller final {
+public:
+#ifdef __linux__
+    Poller(): epfd_{epoll_create1(EPOLL_CLOEXEC)} {
+        if (epfd_ == -1)
+            raise<std::runtime_error>("epoll_create1() failed: {}", SysError{});
+    }
+
+    ~Poller() {
+        int rc;
+        do {
+            rc = close(epfd_);
+        } while (rc == -1 and errno == EINTR);
+    }
+#endif
+
+#ifdef __APPLE__
+    Poller(): maxFd_{-1} { FD_ZERO(&rfds_); }
+#endif
+
+    Poller(Poller const&) = delete;
+    Poller(Poller&&) = delete;
+    Poller& operator= (Poller const&) = delete;
+    Poller& operator= (Poller&&) = delete;
+
+    /*!
+     * \brief Registers the socket \p fd with the poller.
+     *
+     * @param fd the socket
+     * @param id the ID which is returned by ready() when the socket has data
+     */
+    void add(int fd, uint32_t id) {
+#ifdef __linux__
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = id;
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == -1)
+            raise<std::runtime_error>("epoll_ctl() failed: {}", SysError{});
+        events_.resize(events_.size() + 1);
+#endif
+
+#ifdef __APPLE__
+        if (fd >= FD_SETSIZE)
+            raise<std::runtime_error>(
+                    "socket {} exceeds the select() limit {}", fd, FD_SETSIZE);
+        FD_SET(fd, &rfds_);
+        maxFd_ = std::max(maxFd_, fd);
+        fds_.emplace_back(fd, id);
+        ready_.reserve(fds_.size());
+#endif
+    }
+
+    /*!
+     * \brief Waits for the data on any of the registered sockets.
+     *
+     * @param timeoutMs the timeout in milliseconds, 0 does not wait at all
+     * @return the number of sockets with data, 0 if the timeout expired,
+     * or -1 in which case `errno` is set accordingly
+     */
+    int wait(unsigned timeoutMs) {
+#ifdef __linux__
+        return epoll_wait(
+                epfd_, events_.data(),
+                static_cast<int>(events_.size()), static_cast<int>(timeoutMs));
+#endif
+
+#ifdef __APPLE__
+        fd_set rfds;
+        memcpy(&rfds, &rfds_, sizeof(rfds));
+        timeval tout;
+        tout.tv_sec = static_cast<time_t>(timeoutMs / 1000u);
+        tout.tv_usec = static_cast<suseconds_t>((timeoutMs % 1000u) * 1000u);
+        int rc = select(maxFd_+1, &rfds, nullptr, nullptr, &tout);
+        if (rc <= 0) return rc;
+
+        ready_.clear();
+        for (auto const& [fd, id]: fds_) {
+            if (FD_ISSET(fd, &rfds))
+                ready_.push_back(id);
+        }
+        return static_cast<int>(ready_.size());
+#endif
+    }
+
+    /*!
+     * \brief Returns the ID of the \p i-th socket with data.
+     *
+     * @param i the index of the socket which must be less than the
+     * value returned by wait()
+     * @return the ID of the socket
+     */
+    [[nodiscard]]
+    uint32_t ready(std::size_t i) const {
+#ifdef __linux__
+        return events_[i].data.u32;
+#endif
+
+#ifdef __APPLE__
+        return ready_[i];
+#endif
+    }
+
+private:
+#ifdef __linux__
+    int epfd_;
+    std::vector<epoll_event> events_;
+#endif
+
+#ifdef __APPLE__
+    fd_set rfds_;
+    int maxFd_;
+    std::vector<std::pair<int, uint32_t>> fds_;
+    std::vector<uint32_t> ready_;
+#endif
+};
+
+} // namespace pimc
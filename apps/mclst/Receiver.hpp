@@ -4,15 +4,14 @@
 
 namespace pimc {
 
-template <Limiter Limit>
-class Receiver final: public ReceiverBase<Receiver<Limit>, Limit> {
-    using Base = ReceiverBase<Receiver<Limit>, Limit>;
+template <Limiter Limit, OutputPolicy Output>
+class Receiver final: public ReceiverBase<Receiver<Limit, Output>, Limit, Output> {
+    using Base = ReceiverBase<Receiver<Limit, Output>, Limit, Output>;
 public:
     Receiver(Config const& cfg, OutputHandler& oh, bool& stopped)
     : Base{cfg, oh, stopped} {}
 
 protected:
-    using Base::cfg_;
     using Base::dissectMclstBeaconPayload;
 
 public:
@@ -27,12 +26,10 @@ public:
 
     auto processPacket(
             sockaddr_in const& sender, PacketInfo& pktInfo) -> PacketStatus {
-        pktInfo.dport = cfg_.dport();
         pktInfo.source = IPv4Address::from_nl(sender.sin_addr.s_addr);
         pktInfo.sport = ntohs(sender.sin_port);
-        pktInfo.payload = pktInfo.receivedData;
         pktInfo.payloadSize = pktInfo.receivedSize;
-        dissectMclstBeaconPayload();
+        dissectMclstBeaconPayload(pktInfo);
         return PacketStatus::AcceptedShow;
     }
 };
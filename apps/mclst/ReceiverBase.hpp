@@ -1,24 +1,63 @@
 #pragma once
 
 #include <fcntl.h>
-#include <sys/time.h>
-#include <sys/select.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
 
+#ifdef __linux__
+#include <netinet/udp.h>
+#include <linux/net_tstamp.h>
+#include <linux/sock_diag.h>
+#include <linux/sockios.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
 #include <concepts>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "pimc/core/CompilerUtils.hpp"
 #include "pimc/core/Endian.hpp"
 #include "pimc/system/Exceptions.hpp"
 #include "pimc/system/SysError.hpp"
 #include "pimc/net/IPv4PktInfo.hpp"
+#include "pimc/packets/Crc32c.hpp"
 #include "pimc/packets/PacketView.hpp"
 #include "pimc/formatters/SysErrorFormatter.hpp"
+#include "pimc/unix/CapState.hpp"
+#include "pimc/unix/SignalHandler.hpp"
 
+#include "CaptureWriter.hpp"
+#include "FlightRecorder.hpp"
 #include "MclstBeacon.hpp"
 #include "MclstBase.hpp"
+#include "Joiner.hpp"
+#include "LineArbiter.hpp"
 #include "PacketInfo.hpp"
+#include "PacketRing.hpp"
+#include "Poller.hpp"
+#include "PcapFile.hpp"
+#include "Reflector.hpp"
+#include "RtControls.hpp"
+#include "SeqDecoder.hpp"
+#include "SilenceWheel.hpp"
+#include "RxArena.hpp"
+#include "RxBatch.hpp"
 #include "RxStats.hpp"
 #include "Timer.hpp"
+#include "UringRx.hpp"
+#include "XdpSocket.hpp"
+#include "Zapper.hpp"
 
 namespace pimc {
 
@@ -33,15 +72,67 @@ struct UnlimitedPackets {
     constexpr bool reached() { return false; }
 };
 
+/*!
+ * The packet limit shared by all receive threads.
+ */
 class LimitedPackets {
 public:
     explicit LimitedPackets(Config const& cfg)
     : limit_{cfg.count()}, count_{0} {}
 
-    bool reached() { return ++count_ >= limit_; }
+    bool reached() {
+        return count_.fetch_add(1, std::memory_order_relaxed) + 1 >= limit_;
+    }
 private:
     uint64_t limit_;
-    uint64_t count_;
+    std::atomic<uint64_t> count_;
+};
+
+/*!
+ * The policy deciding which of the accepted packets are shown. All the
+ * accepted packets are accounted for in the statistics regardless. The
+ * packets are counted by each receive thread in its own counter, which
+ * is passed to show(), so the threads share no state. If Shows is false,
+ * no packets are ever shown.
+ */
+template <typename T>
+concept OutputPolicy = requires(T output, Config const& cfg, uint64_t& count) {
+    { T{cfg} };
+    { T::Shows } -> std::convertible_to<bool>;
+    { output.show(count) } -> std::same_as<bool>;
+};
+
+struct FullOutput {
+    static constexpr bool Shows{true};
+
+    constexpr explicit FullOutput(Config const&) {}
+    constexpr bool show(uint64_t&) const { return true; }
+};
+
+/*!
+ * Shows one of every Config::sample() packets accepted by each receive
+ * thread.
+ */
+class SampledOutput {
+public:
+    static constexpr bool Shows{true};
+
+    explicit SampledOutput(Config const& cfg): every_{cfg.sample()} {}
+
+    bool show(uint64_t& count) const { return count++ % every_ == 0; }
+private:
+    uint64_t every_;
+};
+
+/*!
+ * Shows no packets, so that the formatting of the packets is compiled
+ * out of the receive loops.
+ */
+struct StatsOnlyOutput {
+    static constexpr bool Shows{false};
+
+    constexpr explicit StatsOnlyOutput(Config const&) {}
+    constexpr bool show(uint64_t&) const { return false; }
 };
 
 enum class PacketStatus: unsigned {
@@ -74,44 +165,103 @@ concept ReceiverProvider = requires(
     { rcvp.processPacket(sender, pktInfo) } -> std::same_as<PacketStatus>;
 };
 
-template <typename RP, Limiter Limit>
+#ifdef __linux__
+/*!
+ * The receiver providers which receive the packets from a packet ring
+ * rather than from the sockets they open. The sockets are then only
+ * used to join the groups.
+ */
+template <typename T>
+concept PacketRingProvider = requires(T rcvp, char const* progname) {
+    { rcvp.openRing(progname) } -> std::same_as<std::unique_ptr<PacketRing>>;
+};
+
+/*!
+ * The receiver providers which receive the packets from the `AF_XDP`
+ * sockets of the receive queues assigned to each shard. The sockets they
+ * open are only used to join the groups.
+ */
+template <typename T>
+concept XdpProvider = requires(T rcvp, char const* progname, unsigned shardId) {
+    { rcvp.openXdp(progname, shardId) } ->
+            std::same_as<std::vector<std::unique_ptr<XdpSocket>>>;
+};
+#endif
+
+template <typename RP, Limiter Limit, OutputPolicy Output>
 class ReceiverBase: private MclstBase {
 protected:
     using MclstBase::cfg_;
     using MclstBase::oh_;
 
     ReceiverBase(Config const& cfg, OutputHandler& oh, bool& stopped)
-    : MclstBase{cfg, oh, stopped}, limit_{cfg} { pktInfo_.group = cfg_.group(); }
+    : MclstBase{cfg, oh, stopped}, seqDecoder_{cfg.seqField()}, limit_{cfg}, output_{cfg} {}
 
-    void dissectMclstBeaconPayload() {
-        PacketView pv{pktInfo_.payload, pktInfo_.payloadSize};
+    ~ReceiverBase() {
+        closeSocket(stopPipe_[0]);
+        closeSocket(stopPipe_[1]);
+#ifdef __linux__
+        restoreHwTimestamps();
+#endif
+    }
+
+    void dissectMclstBeaconPayload(PacketInfo& pktInfo) {
+        PacketView pv{pktInfo.payload(), pktInfo.payloadSize};
 
-        if (PIMC_UNLIKELY(not pv.take(sizeof(MclstBeaconHdr), [this] (auto const* p) {
+        bool crc{false};
+        if (PIMC_UNLIKELY(not pv.take(sizeof(MclstBeaconHdr), [&pktInfo, &crc] (auto const* p) {
             auto const& hdr = *static_cast<MclstBeaconHdr const*>(p);
-            if (be64toh(hdr.magic) == MclstMagic) {
-                pktInfo_.mclstBeacon = true;
-                pktInfo_.remoteSeq = be64toh(hdr.seq);
-                pktInfo_.remoteTimestamp = be64toh(hdr.timeNs);
-                pktInfo_.remoteMsgLen = be16toh(hdr.dataLen);
+            auto magic = be64toh(hdr.magic);
+            if (magic == MclstMagic or magic == MclstCrcMagic) {
+                pktInfo.mclstBeacon = true;
+                pktInfo.remoteSeq = be64toh(hdr.seq);
+                pktInfo.remoteTimestamp = be64toh(hdr.timeNs);
+                pktInfo.remoteMsgLen = be16toh(hdr.dataLen);
+                crc = magic == MclstCrcMagic;
             }
         }))) return;
 
-        if (not pktInfo_.mclstBeacon) return;
+        if (not pktInfo.mclstBeacon) return;
+
+        // Nothing in a corrupted beacon can be trusted
+        if (PIMC_UNLIKELY(crc) and not verifyCrc(pktInfo)) {
+            pktInfo.mclstBeacon = false;
+            return;
+        }
 
-        if (PIMC_UNLIKELY(not pv.take(pktInfo_.remoteMsgLen, [this] (auto const* p) {
-            pktInfo_.remoteMsg = static_cast<char const*>(p);
-        }))) {
-            pktInfo_.mclstBeacon = false;
+        // The message immediately follows the header, see remoteMsg()
+        if (PIMC_UNLIKELY(not pv.skip(pktInfo.remoteMsgLen))) {
+            pktInfo.mclstBeacon = false;
             oh_.warningTs(
-                    pktInfo_.timestamp,
+                    pktInfo.timestamp,
                     "{}:{}->{}:{}: in message #{} "
                     "length is {}, but the remaining length is {}",
-                    pktInfo_.source, pktInfo_.sport, pktInfo_.group, pktInfo_.dport,
-                    pktInfo_.remoteSeq, pktInfo_.remoteMsgLen, pv.remaining());
+                    pktInfo.source, pktInfo.sport, pktInfo.group, pktInfo.dport,
+                    pktInfo.remoteSeq, pktInfo.remoteMsgLen, pv.remaining());
         }
     }
 
 private:
+    /*!
+     * \brief Verifies the CRC32C which follows the rest of the payload of
+     * the beacon.
+     *
+     * @return true if the beacon is intact
+     */
+    static bool verifyCrc(PacketInfo& pktInfo) {
+        uint32_t crc;
+        if (PIMC_UNLIKELY(pktInfo.payloadSize < sizeof(MclstBeaconHdr) + sizeof(crc))) {
+            pktInfo.integrity = Integrity::Corrupt;
+            return false;
+        }
+
+        auto size = pktInfo.payloadSize - sizeof(crc);
+        memcpy(&crc, pktInfo.payload() + size, sizeof(crc));
+        pktInfo.integrity = crc32c(pktInfo.payload(), size) == be32toh(crc)
+                ? Integrity::Intact : Integrity::Corrupt;
+        return pktInfo.integrity == Integrity::Intact;
+    }
+
     static constexpr unsigned Accepted{1};
     static constexpr unsigned Show{2};
 
@@ -121,214 +271,1850 @@ private:
         return static_cast<Self&>(*this);
     }
 
+    /*!
+     * The receiving socket bound to a destination UDP port along with
+     * the subscriptions joined on it. In the portless mode there is a
+     * single socket whose destination port is 0.
+     */
+    struct RxSocket final {
+        int fd;
+        uint16_t dport;
+        std::vector<Subscription> subs;
+        // The kernel drop counter of the socket delivered with the last
+        // packet received after a drop
+        uint32_t drops;
+        // The peak number of bytes taken by the socket receive queue
+        uint64_t peakQueue;
+        // The limit of the memory the socket receive queue may take
+        uint64_t rcvbuf;
+    };
+
+    /*!
+     * The ID under which the read end of the stop pipe is registered
+     * with the pollers of the shards.
+     */
+    static constexpr uint32_t StopId{std::numeric_limits<uint32_t>::max()};
+
+    /*!
+     * The ID under which the packet ring is registered with the poller
+     * of its shard.
+     */
+    static constexpr uint32_t RingId{StopId - 1};
+
+    /*!
+     * The ID under which the `io_uring` instance is registered with the
+     * poller of its shard.
+     */
+    static constexpr uint32_t UringId{StopId - 2};
+
+    /*!
+     * The ID under which the `AF_XDP` sockets are registered with the
+     * poller of their shard.
+     */
+    static constexpr uint32_t XdpId{StopId - 3};
+
+    /*!
+     * The ID under which the read end of the wake pipe of a shard is
+     * registered with the poller of the shard.
+     */
+    static constexpr uint32_t WakeId{StopId - 4};
+
+    /*!
+     * The number of the MTU sized buffers provided to each `io_uring`
+     * instance, which absorb the bursts between the drains without ending
+     * the multishot receive requests.
+     */
+    static constexpr unsigned UringBuffers{4096};
+
+    /*!
+     * The number of the buffers provided to each `io_uring` instance with
+     * UDP GRO, each of which accommodates a coalesced datagram.
+     */
+    static constexpr unsigned UringGroBuffers{256};
+
+    /*!
+     * The state of a single receive thread. The shards do not share any
+     * state, except for the packet limit, the output handler and the
+     * stop pipe, which wakes up all shards once any of them stops.
+     */
+    struct Shard final {
+        Shard(unsigned shardId, bool hugePages, int node)
+        : id{shardId}, arena{1, hugePages, node} {}
+
+        Shard(Shard const&) = delete;
+        Shard(Shard&&) = delete;
+        Shard& operator= (Shard const&) = delete;
+        Shard& operator= (Shard&&) = delete;
+
+        ~Shard() {
+            for (auto const& rxs: sockets)
+                closeSocket(rxs.fd);
+            closeSocket(wakePipe[0]);
+            closeSocket(wakePipe[1]);
+        }
+
+        unsigned id;
+        std::vector<RxSocket> sockets;
+        Poller poller;
+        PacketInfo pktInfo;
+        // The receive buffer of the single packet receives
+        RxArena arena{1};
+#ifdef __linux__
+        std::unique_ptr<RxBatch> batch;
+        std::unique_ptr<PacketRing> ring;
+        std::unique_ptr<UringRx> uring;
+        std::vector<std::unique_ptr<XdpSocket>> xsks;
+#endif
+        // Joins the subscriptions of the shard one at a time in zap mode
+        std::unique_ptr<Zapper> zapper;
+        // Joins the subscriptions of the shard at the configured rate
+        std::unique_ptr<Joiner> joiner;
+        // Matches the packets of the A and B lines
+        std::unique_ptr<LineArbiter> arbiter;
+        // Sends the received beacons back to the return group
+        std::unique_ptr<Reflector> reflector;
+        // Detects the flows which have gone silent
+        std::unique_ptr<SilenceWheel> silence;
+        // Passes the accepted packets to the capture writer
+        CaptureRing* capture{nullptr};
+        // Keeps the last packets and dumps them on the anomalies
+        std::unique_ptr<FlightRecorder> recorder;
+        // The host time when the socket receive queues are sampled next
+        uint64_t sampleAt{0};
+        // The number of the accepted packets counted by the output policy
+        uint64_t sampleCount{0};
+        // Set once the first shard has posted new source lists, see
+        // updateSources()
+        std::atomic<bool> sourcesPosted{false};
+        // Wakes up the poller of the shard once the sources are posted
+        int wakePipe[2]{-1, -1};
+        RxStats rxStats;
+        // The controls applied to the receive thread of the shard
+        RtControls controls;
+    };
+
+    /*!
+     * The interval at which the receive queues of the sockets are sampled.
+     */
+    static constexpr uint64_t SampleIntervalNs{100'000'000};
+
     void configure(char const* progname) {
-        socket_ = impl().openSocket(progname);
+        for (unsigned i = 0; i < cfg_.threads(); ++i)
+            shards_.push_back(std::make_unique<Shard>(i, cfg_.hugePages(), shardNode(i)));
+
+        // The subscriptions are dealt to the shards round-robin. Within
+        // a shard one socket is needed per destination port, the traffic
+        // for the different groups arriving on the same socket is told
+        // apart by the destination address of the packets. The number of
+        // the memberships per socket is limited, so once the socket of a
+        // port is full, another socket is opened for the port.
+        auto const& subs = cfg_.subscriptions();
+        // Each subscription takes a membership per line
+        auto maxSubs = std::max(maxMemberships() / (cfg_.lineB() ? 2u : 1u), std::size_t{1});
+        for (std::size_t i = 0; i < subs.size(); ++i) {
+            auto const& sub = subs[i];
+            auto& sockets = shards_[i % shards_.size()]->sockets;
+            // Only the last socket of the port may have room left
+            auto it = std::find_if(
+                    sockets.rbegin(), sockets.rend(),
+                    [&sub] (auto const& rxs) { return rxs.dport == sub.dport; });
+            if (it == sockets.rend() or it->subs.size() >= maxSubs) {
+                sockets.push_back(RxSocket{
+                    .fd = -1, .dport = sub.dport, .subs = {},
+                    .drops = 0, .peakQueue = 0, .rcvbuf = 0});
+                it = sockets.rbegin();
+            }
+            it->subs.push_back(sub);
+        }
+
+        openCapture();
+        openRecorders();
+
+        if (shards_.size() > 1) {
+            if (pipe(stopPipe_) == -1)
+                raise<std::runtime_error>("pipe() failed: {}", SysError{});
+        }
+
+        for (auto& shard: shards_) {
+#ifdef __linux__
+            if (cfg_.ioUring() and openUring(*shard))
+                shard->poller.add(shard->uring->fd(), UringId);
+#endif
+
+            for (std::size_t i = 0; i < shard->sockets.size(); ++i) {
+                auto& rxs = shard->sockets[i];
+                rxs.fd = impl().openSocket(progname);
+                configureSocket(rxs.fd, rxs.dport, progname);
+#ifdef __linux__
+                if constexpr (PacketRingProvider<RP> or XdpProvider<RP>) continue;
+                // The sockets are read by the io_uring instance
+                if (shard->uring) continue;
+#endif
+                shard->poller.add(rxs.fd, static_cast<uint32_t>(i));
+            }
+
+#ifdef __linux__
+            if constexpr (PacketRingProvider<RP>) {
+                shard->ring = impl().openRing(progname);
+                shard->poller.add(shard->ring->fd(), RingId);
+            }
+
+            if constexpr (XdpProvider<RP>) {
+                shard->xsks = impl().openXdp(progname, shard->id);
+                for (auto const& xsk: shard->xsks)
+                    shard->poller.add(xsk->fd(), XdpId);
+            }
+#endif
+
+            if (stopPipe_[0] != -1)
+                shard->poller.add(stopPipe_[0], StopId);
+
+            // The other shards are woken up to install the new sources
+            if (shard->id > 0 and not cfg_.reloadFile().empty() and
+                cfg_.busyPoll() == 0) {
+                if (pipe(shard->wakePipe) == -1)
+                    raise<std::runtime_error>("pipe() failed: {}", SysError{});
+                shard->poller.add(shard->wakePipe[0], WakeId);
+            }
+
+#ifdef __linux__
+            if (cfg_.batch() > 0)
+                shard->batch = std::make_unique<RxBatch>(
+                        cfg_.batch(), cfg_.hugePages(), shardNode(shard->id));
+
+            if (cfg_.hugePages())
+                controls_.push_back(hugePagesControl(*shard));
+#endif
+
+            if (cfg_.zap() > 0) {
+                shard->zapper = std::make_unique<Zapper>(cfg_.zap());
+                for (auto const& rxs: shard->sockets) {
+                    for (auto const& sub: rxs.subs)
+                        shard->zapper->add(rxs.fd, sub);
+                }
+            }
+
+            if (cfg_.lineB())
+                shard->arbiter = std::make_unique<LineArbiter>(cfg_);
+
+            if (cfg_.reflect())
+                shard->reflector = std::make_unique<Reflector>(cfg_);
+
+            if (cfg_.silence() > 0)
+                shard->silence = std::make_unique<SilenceWheel>(
+                        uint64_t{cfg_.silence()} * 1'000'000, gethostnanos());
+
+            if (cfg_.joinRate() > 0) {
+                // Each shard joins its share of the subscriptions
+                auto intervalNs =
+                        static_cast<uint64_t>(cfg_.threads()) * NanosInSecond / cfg_.joinRate();
+                shard->joiner = std::make_unique<Joiner>(intervalNs, cfg_.wildcard());
+                for (auto const& rxs: shard->sockets) {
+                    for (auto const& sub: rxs.subs)
+                        shard->joiner->add(rxs.fd, sub);
+                }
+            }
+        }
+    }
 
+    void configureSocket(int fd, uint16_t dport, char const* progname) {
         // Make socket non-blocking
-        int flags = fcntl(socket_, F_GETFL);
+        int flags = fcntl(fd, F_GETFL);
         if (flags == -1)
             raise<std::runtime_error>(
                     "fcntl() failed to get socket flags: {}", SysError{});
 
         flags |= O_NONBLOCK;
-        fcntl(socket_, F_SETFL, flags);
+        fcntl(fd, F_SETFL, flags);
         if (flags == -1)
             raise<std::runtime_error>(
                     "fcntl() failed to make socket non-blocking: {}", SysError{});
 
         // allow multiple sockets use the same UDP ports
         int allowReuse = 1;
-        if (setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR,
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
                        &allowReuse, sizeof(allowReuse)) == -1)
             raise<std::runtime_error>("cannot enable UDP port reuse: {}", SysError{});
 
-        int bufSize{BufferSize};
-        if (setsockopt(socket_, SOL_SOCKET,
-                       SO_RCVBUF, &bufSize, sizeof(bufSize)) == -1) {
-            oh_.warning(
-                    "failed to set receive buffer size to {} bytes: {}",
-                    bufSize, SysError{});
-        }
+        setReceiveBuffer(fd, progname);
 
         int ttl = 1;
 
-        if (setsockopt(socket_, IPPROTO_IP, IP_RECVTTL, &ttl, sizeof(ttl)) == -1)
+        if (setsockopt(fd, IPPROTO_IP, IP_RECVTTL, &ttl, sizeof(ttl)) == -1)
             raise<std::runtime_error>("cannot enable receiving TTL: {}", SysError{});
 
         int pktinfo{1};
-        if (setsockopt(socket_, IPPROTO_IP, IP_PKTINFO, &pktinfo, sizeof(pktinfo)) == -1)
+        if (setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &pktinfo, sizeof(pktinfo)) == -1)
             raise<std::runtime_error>(
                     "cannot enable receiving the interface on which packet is received{}",
                     SysError{});
 
+#ifdef __linux__
+        // By default Linux delivers the multicast traffic to every socket
+        // bound to the matching port, regardless of which socket joined
+        // the group. Only receive the groups joined on this socket.
+        int mcastAll{0};
+        if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_ALL,
+                       &mcastAll, sizeof(mcastAll)) == -1)
+            raise<std::runtime_error>(
+                    "cannot disable receiving all multicast groups: {}", SysError{});
+
+        // The drop counter of the socket is delivered with the packets
+        int rxqOvfl{1};
+        if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &rxqOvfl, sizeof(rxqOvfl)) == -1)
+            raise<std::runtime_error>(
+                    "cannot enable receiving the socket drop counter: {}", SysError{});
+
+        if (cfg_.rxTimestamps() != RxTimestamps::Host)
+            enableRxTimestamps(fd);
+
+        if (cfg_.busyPoll() > 0)
+            enableBusyPoll(fd);
+
+        if (cfg_.gro()) {
+            int gro{1};
+            if (setsockopt(fd, SOL_UDP, UDP_GRO, &gro, sizeof(gro)) == -1)
+                raise<std::runtime_error>("cannot enable UDP GRO: {}", SysError{});
+        }
+#endif
+
         // Bind the socket to any interface. The join will be sent
         // from the interface specified on the command line
         sockaddr_in src;
         memset(&src, 0, sizeof(src));
         src.sin_family = AF_INET;
-        src.sin_port = htons(cfg_.dport());
+        src.sin_port = htons(dport);
         src.sin_addr.s_addr = INADDR_ANY;
 
-        if (bind(socket_, reinterpret_cast<sockaddr*>(&src), sizeof(src)) == -1)
+        if (bind(fd, reinterpret_cast<sockaddr*>(&src), sizeof(src)) == -1)
             raise<std::runtime_error>(
                     "cannot bind socket to UDP port {}: {}",
-                    cfg_.dport(), SysError{});
+                    dport, SysError{});
+    }
+
+    /*!
+     * \brief Sets the receive buffer size of the socket.
+     *
+     * The configured size is forced with `SO_RCVBUFFORCE`, which requires
+     * `CAP_NET_ADMIN`. If it cannot be forced, a warning is shown once and
+     * the size is set with `SO_RCVBUF`, which the kernel silently caps by
+     * `net.core.rmem_max`.
+     */
+    void setReceiveBuffer(int fd, char const* progname) {
+        int bufSize = cfg_.rcvbuf() > 0
+                ? static_cast<int>(cfg_.rcvbuf()) : static_cast<int>(BufferSize);
+
+#ifdef __linux__
+        if (cfg_.rcvbuf() > 0) {
+            auto r = CapState::program(progname).raise(CAP_(NET_ADMIN));
+            if (r and setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE,
+                                 &bufSize, sizeof(bufSize)) == 0)
+                return;
+
+            if (not rcvbufWarned_) {
+                std::string reason = r ? fmt::format("{}", SysError{}) : r.error();
+                oh_.warning(
+                        "unable to force receive buffer size to {} bytes, "
+                        "the size is capped by net.core.rmem_max: {}\n",
+                        bufSize, reason);
+                rcvbufWarned_ = true;
+            }
+        }
+#else
+        (void)progname;
+#endif
+
+        if (setsockopt(fd, SOL_SOCKET,
+                       SO_RCVBUF, &bufSize, sizeof(bufSize)) == -1) {
+            oh_.warning(
+                    "failed to set receive buffer size to {} bytes: {}",
+                    bufSize, SysError{});
+        }
+    }
+
+#ifdef __linux__
+    /*!
+     * \brief Makes the receive calls on the socket poll the device queue
+     * for the configured number of microseconds if there is no data.
+     *
+     * Raising the busy poll time above `net.core.busy_read` requires
+     * `CAP_NET_ADMIN`. If it cannot be set, a warning is shown once and
+     * mclst still spins on the socket, only without polling the device.
+     */
+    void enableBusyPoll(int fd) {
+        int usecs = static_cast<int>(cfg_.busyPoll());
+        bool ok = setsockopt(
+                fd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)) == 0;
+#ifdef SO_PREFER_BUSY_POLL
+        int prefer{1};
+        ok = ok and setsockopt(
+                fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer)) == 0;
+#endif
+        if (not ok and not busyPollWarned_) {
+            oh_.warning("unable to enable socket busy polling: {}\n", SysError{});
+            busyPollWarned_ = true;
+        }
+    }
+
+    void enableRxTimestamps(int fd) {
+        if (cfg_.rxTimestamps() == RxTimestamps::Software) {
+            int on{1};
+            if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == -1)
+                raise<std::runtime_error>(
+                        "cannot enable kernel receive timestamps: {}", SysError{});
+            return;
+        }
+
+        // Ask the driver to timestamp all received packets. This requires
+        // CAP_NET_ADMIN and may not be supported by the NIC, in which case
+        // the kernel software timestamps are used.
+        if (not hwTimestampsRequested_) {
+            hwTimestampsRequested_ = true;
+            requestHwTimestamps(fd, cfg_.intf());
+            if (cfg_.lineB())
+                requestHwTimestamps(fd, cfg_.lineB().intf);
+        }
+
+        int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                    SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == -1)
+            raise<std::runtime_error>(
+                    "cannot enable hardware receive timestamps: {}", SysError{});
+    }
+
+    /*!
+     * \brief Makes the NIC of the interface \p intf timestamp all received
+     * packets unless it already timestamps some of them.
+     *
+     * The timestamping configuration is global to the interface and may be
+     * in use by e.g. `ptp4l`, so the TX timestamping is kept as it is and
+     * the configuration is only changed if the receive timestamping is
+     * off, in which case it is restored at exit.
+     */
+    void requestHwTimestamps(int fd, std::string const& intf) {
+        hwtstamp_config hwcfg{};
+        ifreq ifr{};
+        strncpy(ifr.ifr_name, intf.c_str(), sizeof(ifr.ifr_name) - 1);
+        ifr.ifr_data = reinterpret_cast<char*>(&hwcfg);
+        if (ioctl(fd, SIOCGHWTSTAMP, &ifr) == -1) {
+            oh_.warning(
+                    "unable to read hardware timestamping configuration of {}: "
+                    "{}, using software timestamps\n", intf, SysError{});
+            return;
+        }
+
+        if (hwcfg.rx_filter != HWTSTAMP_FILTER_NONE) return;
+
+        auto saved = hwcfg;
+        hwcfg.rx_filter = HWTSTAMP_FILTER_ALL;
+        if (ioctl(fd, SIOCSHWTSTAMP, &ifr) == -1) {
+            oh_.warning(
+                    "unable to enable hardware timestamping on {}: {}, "
+                    "using software timestamps\n", intf, SysError{});
+            return;
+        }
+
+        hwSaved_.push_back(HwTimestamping{.intf = intf, .config = saved});
+    }
+
+    /*!
+     * \brief Puts back the timestamping configuration of the interfaces
+     * changed by requestHwTimestamps().
+     */
+    void restoreHwTimestamps() {
+        if (hwSaved_.empty()) return;
+
+        int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) return;
+
+        for (auto& hw: hwSaved_) {
+            ifreq ifr{};
+            strncpy(ifr.ifr_name, hw.intf.c_str(), sizeof(ifr.ifr_name) - 1);
+            ifr.ifr_data = reinterpret_cast<char*>(&hw.config);
+            ioctl(fd, SIOCSHWTSTAMP, &ifr);
+        }
+        hwSaved_.clear();
+        closeSocket(fd);
+    }
+#endif
 
-        // Activate poller
-        FD_ZERO(&rfds_);
-        FD_SET(socket_, &rfds_);
+    /*!
+     * @return the maximum number of the groups which may be joined on a
+     * single socket
+     */
+    static std::size_t maxMemberships() {
+#ifdef __linux__
+        std::ifstream ifs{"/proc/sys/net/ipv4/igmp_max_memberships"};
+        std::size_t n{0};
+        if (ifs >> n and n > 0)
+            return n;
+#endif
+        return IP_MAX_MEMBERSHIPS;
     }
 
     void join() {
-        if (cfg_.source() != IPv4Address{}) {
+        // In zap mode and with the join rate the subscriptions are joined
+        // by the shards once they start receiving
+        if (cfg_.zap() > 0 or cfg_.joinRate() > 0) return;
+
+        for (auto const& shard: shards_) {
+            for (auto const& rxs: shard->sockets) {
+                for (auto const& sub: rxs.subs)
+                    joinGroup(rxs.fd, sub);
+            }
+        }
+    }
+
+    /*!
+     * \brief Joins the subscription \p sub on the socket \p fd on the
+     * interface and, if configured, on the interface of the B line.
+     */
+    void joinGroup(int fd, Subscription const& sub) {
+        joinGroup(fd, sub, cfg_.intf(), cfg_.intfAddr());
+        if (cfg_.lineB())
+            joinGroup(fd, sub, cfg_.lineB().intf, cfg_.lineB().intfAddr);
+    }
+
+    void joinGroup(
+            int fd, Subscription const& sub,
+            std::string const& intf, IPv4Address intfAddr) {
+        if (not sub.sources.empty()) {
+            // The group is joined with its first source, and the rest of
+            // the sources are added in one call rather than one by one
+            auto source = sub.sources.front();
             ip_mreq_source mreq_source{};
-            mreq_source.imr_interface.s_addr = cfg_.intfAddr().to_nl();
-            mreq_source.imr_multiaddr.s_addr = cfg_.group().to_nl();
-            mreq_source.imr_sourceaddr.s_addr = cfg_.source().to_nl();
+            mreq_source.imr_interface.s_addr = intfAddr.to_nl();
+            mreq_source.imr_multiaddr.s_addr = sub.group.to_nl();
+            mreq_source.imr_sourceaddr.s_addr = source.to_nl();
 
-            if (setsockopt(socket_, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP,
+            if (setsockopt(fd, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP,
                            &mreq_source, sizeof(mreq_source)) == -1)
                 raise<std::runtime_error>(
-                        "failed to join ({}, {}) on {}: {}",
-                        cfg_.source(), cfg_.group(), cfg_.intf(), SysError{});
+                        "failed to join ({}, {}) on {}: {}{}",
+                        source, sub.group, intf, SysError{}, joinHint());
+
+            if (sub.sources.size() > 1)
+                setSources(fd, sub.group, sub.sources, intf, intfAddr);
         } else {
             ip_mreq mreq{};
-            mreq.imr_interface.s_addr = cfg_.intfAddr().to_nl();
-            mreq.imr_multiaddr.s_addr = cfg_.group().to_nl();
+            mreq.imr_interface.s_addr = intfAddr.to_nl();
+            mreq.imr_multiaddr.s_addr = sub.group.to_nl();
 
-            if (setsockopt(socket_, IPPROTO_IP,
+            if (setsockopt(fd, IPPROTO_IP,
                            IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1)
                 raise<std::runtime_error>(
-                        "failed to join (*, {}) on {}: {}",
-                        cfg_.group(), cfg_.intf(), SysError{});
+                        "failed to join (*, {}) on {}: {}{}",
+                        sub.group, intf, SysError{}, joinHint());
         }
     }
 
-    PacketStatus receive(uint64_t recvTime) {
-        pktInfo_.reset();
+    void leaveGroup(int fd, Subscription const& sub) {
+        leaveGroup(fd, sub, cfg_.intf(), cfg_.intfAddr());
+        if (cfg_.lineB())
+            leaveGroup(fd, sub, cfg_.lineB().intf, cfg_.lineB().intfAddr);
+    }
 
-        iovec iov;
-        iov.iov_base = pktInfo_.receivedData;
-        iov.iov_len = sizeof(pktInfo_.receivedData);
-        constexpr size_t cmsgSize =
-                sizeof(cmsghdr) + sizeof(int16_t) + sizeof(in_pktinfo) + 64ul;
-        uint8_t cmsgBuf[CMSG_SPACE(cmsgSize)];
-        sockaddr_in sender;
-        memset(&sender, 0, sizeof(sender));
-        msghdr msg;
-        memset(&msg, 0, sizeof(msg));
-        msg.msg_name = &sender;
-        msg.msg_namelen = sizeof(sender);
-        msg.msg_iov = &iov;
-        msg.msg_iovlen = 1;
-        msg.msg_control = cmsgBuf;
-        msg.msg_controllen = sizeof(cmsgBuf);
+    void leaveGroup(
+            int fd, Subscription const& sub,
+            std::string const& intf, IPv4Address intfAddr) {
+        // Dropping the membership leaves the group along with all its
+        // sources
+        if (sub.sources.size() == 1) {
+            auto source = sub.sources.front();
+            ip_mreq_source mreq_source{};
+            mreq_source.imr_interface.s_addr = intfAddr.to_nl();
+            mreq_source.imr_multiaddr.s_addr = sub.group.to_nl();
+            mreq_source.imr_sourceaddr.s_addr = source.to_nl();
+
+            if (setsockopt(fd, IPPROTO_IP, IP_DROP_SOURCE_MEMBERSHIP,
+                           &mreq_source, sizeof(mreq_source)) == -1)
+                raise<std::runtime_error>(
+                        "failed to leave ({}, {}) on {}: {}",
+                        source, sub.group, intf, SysError{});
+        } else {
+            ip_mreq mreq{};
+            mreq.imr_interface.s_addr = intfAddr.to_nl();
+            mreq.imr_multiaddr.s_addr = sub.group.to_nl();
 
-        ssize_t rsz = recvmsg(socket_, &msg, 0);
+            if (setsockopt(fd, IPPROTO_IP,
+                           IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq)) == -1)
+                raise<std::runtime_error>(
+                        "failed to leave (*, {}) on {}: {}",
+                        sub.group, intf, SysError{});
+        }
+    }
 
-        if (rsz < 0)
-            raise<std::runtime_error>("recvmsg() failed: {}", SysError{});
+    /*!
+     * \brief Replaces the source filter of the \p group joined on the
+     * socket \p fd with \p sources in a single call, without leaving the
+     * group. If \p sources is empty, the group is received from any
+     * source.
+     */
+    static void setSources(
+            int fd, IPv4Address group, std::vector<IPv4Address> const& sources,
+            std::string const& intf, IPv4Address intfAddr) {
+        std::vector<in_addr> slist(sources.size());
+        for (std::size_t i = 0; i < sources.size(); ++i)
+            slist[i].s_addr = sources[i].to_nl();
 
-        pktInfo_.timestamp = recvTime;
-        pktInfo_.receivedSize = static_cast<unsigned>(rsz);
+        in_addr intfIn{};
+        intfIn.s_addr = intfAddr.to_nl();
+        in_addr groupIn{};
+        groupIn.s_addr = group.to_nl();
+        if (setipv4sourcefilter(
+                fd, intfIn, groupIn,
+                sources.empty() ? MCAST_EXCLUDE : MCAST_INCLUDE,
+                static_cast<uint32_t>(slist.size()), slist.data()) == -1)
+            raise<std::runtime_error>(
+                    "failed to set {} sources of {} on {}: {}{}",
+                    sources.size(), group, intf, SysError{},
+                    errno == ENOBUFS
+                    ? "; the number of sources per group is limited by "
+                      "net.ipv4.igmp_max_msf" : "");
+    }
 
-        for (auto cmsgp = CMSG_FIRSTHDR(&msg);
-             cmsgp != nullptr;
-             cmsgp = CMSG_NXTHDR(&msg, cmsgp)) {
+    static bool byGroupPort(Subscription const& lhs, Subscription const& rhs) {
+        return std::tie(lhs.group, lhs.dport) < std::tie(rhs.group, rhs.dport);
+    }
 
-            // Technically, we should only be looking for IP_TTL, but in macOS
-            // this doesn't work, instead what we get is IP_RECVTTL
-            if (cmsgp->cmsg_level == IPPROTO_IP and
-                (cmsgp->cmsg_type == IP_TTL or cmsgp->cmsg_type == IP_RECVTTL) and
-                cmsgp->cmsg_len > 0) {
-                auto ttl = *reinterpret_cast<uint8_t const*>(CMSG_DATA(cmsgp));
-                pktInfo_.ttl = static_cast<int16_t>(ttl);
-                continue;
-            }
+    /*!
+     * \brief Loads the groups file again and posts the new source lists
+     * to all shards, each of which installs them on its own sockets.
+     *
+     * Only the source lists are updated: the subscriptions which are not
+     * in the file are kept as they are, and the ones which are only in
+     * the file are not joined. The file is loaded by the first shard,
+     * which receives the signal.
+     */
+    void postSources() {
+        updateRequested_.store(false, std::memory_order_relaxed);
+        auto now = gethostnanos();
 
-            if (cmsgp->cmsg_level == IPPROTO_IP and
-                cmsgp->cmsg_type == IP_PKTINFO and
-                cmsgp->cmsg_len > 0) {
-                auto const* p = static_cast<void const*>(CMSG_DATA(cmsgp));
-                auto const* pi = reinterpret_cast<in_pktinfo const*>(p);
-                pktInfo_.ifIndex = IF_INDEX(pi->ipi_ifindex);
+        auto subs = std::make_shared<std::vector<Subscription>>();
+        try {
+            *subs = cfg_.loadGroupsFile();
+        } catch (std::runtime_error const& ex) {
+            oh_.warningTs(now, "sources not updated: {}", ex.what());
+            return;
+        }
+        std::sort(subs->begin(), subs->end(), byGroupPort);
+
+        auto loaded = subs->size();
+        std::size_t joined{0};
+        for (auto const& sub: cfg_.subscriptions()) {
+            auto it = std::lower_bound(subs->begin(), subs->end(), sub, byGroupPort);
+            if (it != subs->end() and not byGroupPort(sub, *it)) ++joined;
+        }
+
+        {
+            std::lock_guard lock{sourcesMutex_};
+            sources_ = std::move(subs);
+        }
+        for (auto& shard: shards_) {
+            shard->sourcesPosted.store(true, std::memory_order_relaxed);
+            if (shard->wakePipe[1] != -1) {
+                char c{0};
+                while (write(shard->wakePipe[1], &c, 1) == -1 and errno == EINTR);
             }
         }
 
-        return impl().processPacket(sender, pktInfo_);
+        if (joined < loaded)
+            oh_.warningTs(
+                    now, "{} of {} subscriptions in {} are not joined, ignored",
+                    loaded - joined, loaded, cfg_.reloadFile());
     }
 
-    void receiveLoop() {
-        fd_set rfds;
-        RxStats::Timer rxStatsTimer{rxStats_};
-        Timer timer{cfg_};
-
-        while (not stopped_) {
-            memcpy(&rfds, &rfds_, sizeof(rfds));
-            tout_.tv_sec = cfg_.timeoutSec();
-            tout_.tv_usec = 0;
-            int rc = select(socket_+1, &rfds, nullptr, nullptr, &tout_);
-            timer.save();
+    /*!
+     * \brief Installs the source lists posted by the first shard on the
+     * sockets of the \p shard in place.
+     *
+     * Only the receive thread of the shard updates its subscriptions and
+     * its sockets, so they are never touched by another thread.
+     */
+    void updateSources(Shard& shard) {
+        shard.sourcesPosted.store(false, std::memory_order_relaxed);
+        auto now = gethostnanos();
 
-            if (rc < 0) {
-                if (errno == EINTR) continue;
+        std::shared_ptr<std::vector<Subscription> const> subs;
+        {
+            std::lock_guard lock{sourcesMutex_};
+            subs = sources_;
+        }
 
-                raise<std::runtime_error>("select() failed: {}", SysError{});
-            }
+        for (auto& rxs: shard.sockets) {
+            for (auto& sub: rxs.subs) {
+                auto it = std::lower_bound(subs->begin(), subs->end(), sub, byGroupPort);
+                if (it == subs->end() or byGroupPort(sub, *it)) continue;
+                if (it->sources == sub.sources) continue;
 
-            if (rc == 0) {
-                if (timer.timeout()) {
-                    oh_.showTimeout(timer.timestamp());
-                    timer.reset();
+                try {
+                    setSources(rxs.fd, sub.group, it->sources, cfg_.intf(), cfg_.intfAddr());
+                    if (cfg_.lineB())
+                        setSources(
+                                rxs.fd, sub.group, it->sources,
+                                cfg_.lineB().intf, cfg_.lineB().intfAddr);
+                } catch (std::runtime_error const& ex) {
+                    oh_.warningTs(now, "{}", ex.what());
+                    continue;
                 }
 
-                continue;
+                oh_.showSourcesUpdate(now, sub, it->sources);
+                sub.sources = it->sources;
             }
+        }
+    }
 
-            if (PIMC_LIKELY(FD_ISSET(socket_, &rfds_))) {
-                auto ps = static_cast<unsigned>(receive(timer.timestamp()));
+    /*!
+     * \brief Leaves the subscription joined by the zapper of the shard and
+     * joins the next one.
+     */
+    void zap(Shard& shard, uint64_t now) {
+        shard.zapper->zap(
+                now,
+                [this, now] (Zapper::Channel const& ch) {
+                    joinGroup(ch.fd, ch.sub);
+                    oh_.showZap(now, "joined", ch.sub);
+                },
+                [this, now] (Zapper::Channel const& ch) {
+                    leaveGroup(ch.fd, ch.sub);
+                    oh_.showZap(now, "left", ch.sub);
+                });
+    }
 
-                if (PIMC_LIKELY(ps & Accepted)) {
-                    timer.reset();
+    /*!
+     * \brief Zaps if the dwell time of the joined subscription has expired,
+     * makes the joins which are due and reports the flows which have gone
+     * silent.
+     *
+     * @param now the current host time in nanoseconds
+     * @param timeoutMs the receive timeout in milliseconds
+     * @return the number of milliseconds to wait for the packets, which
+     * is at most \p timeoutMs and makes the poller return by the next zap,
+     * join or silence check
+     */
+    unsigned runScheduled(Shard& shard, uint64_t now, unsigned timeoutMs) {
+        auto deadline = std::numeric_limits<uint64_t>::max();
 
-                    if (PIMC_LIKELY(ps & Show)) {
-                        oh_.showReceivedPacket(pktInfo_);
+        if (shard.zapper) {
+            if (now >= shard.zapper->deadline())
+                zap(shard, now);
+            deadline = shard.zapper->deadline();
+        }
 
-                        // NoShow means pktInfo_ is incomplete and instead the
-                        // receive() call produced a warning. Therefore, we only
-                        // count packets which are shown.
-                        rxStats_.update(
-                                pktInfo_.source, pktInfo_.sport, pktInfo_.dport,
-                                pktInfo_.payloadSize);
-                    }
+        if (shard.joiner) {
+            shard.joiner->joinDue(now, [this] (int fd, Subscription const& sub) {
+                joinGroup(fd, sub);
+            });
+            deadline = std::min(deadline, shard.joiner->deadline());
+        }
 
-                    if (limit_.reached()) return;
-                    continue;
-                }
-            } else {
-                // This should never happen
-                oh_.warningTs(
-                        timer.timestamp(),
-                        "select returned {} but multicast socket has no data",
-                        rc);
-            }
+        if (shard.silence) {
+            checkSilence(shard, now);
+            deadline = std::min(deadline, shard.silence->deadline());
         }
+
+        if (deadline == std::numeric_limits<uint64_t>::max())
+            return timeoutMs;
+
+        // Round up, so the poller does not return just before the deadline
+        auto untilMs = (deadline - now + 999'999) / 1'000'000;
+        return static_cast<unsigned>(std::min<uint64_t>(timeoutMs, untilMs));
     }
 
-public:
-    void run(char const* progname) {
-        configure(progname);
-        join();
-        receiveLoop();
-        oh_.showRxStats(rxStats_, stopped_);
+    void checkSilence(Shard& shard, uint64_t now) {
+        shard.silence->advance(now, [this, &shard, now] (FlowKey const& fk, uint64_t silentNs) {
+            oh_.showFlowSilent(now, fk, silentNs);
+            if (PIMC_UNLIKELY(shard.recorder != nullptr))
+                anomaly(shard, now, "flow {}:{}->{}:{} silent",
+                        fk.source, fk.sport, fk.group, fk.dport);
+        });
     }
 
-private:
-    PacketInfo pktInfo_;
-    fd_set rfds_;
-    timeval tout_;
+    static char const* joinHint() {
+        if (errno == ENOBUFS)
+            return "; the number of groups per socket is limited by "
+                   "net.ipv4.igmp_max_memberships";
+        return "";
+    }
+
+    /*!
+     * \brief Populates \p pktInfo from the control messages of the
+     * received packet.
+     *
+     * @param drops set to the drop counter of the socket if it has been
+     * delivered with the packet, which only happens after a drop
+     * @return the UDP GRO segment size if the packet is a coalesced
+     * datagram, 0 otherwise
+     */
+    static unsigned parseControl(
+            msghdr const& msg, PacketInfo& pktInfo, uint32_t& drops) {
+        unsigned groSize{0};
+        // CMSG_NXTHDR() takes a non-const msghdr in glibc even though
+        // it doesn't modify it
+        auto& m = const_cast<msghdr&>(msg);
+        for (auto cmsgp = CMSG_FIRSTHDR(&m);
+             cmsgp != nullptr;
+             cmsgp = CMSG_NXTHDR(&m, cmsgp)) {
+
+            // Technically, we should only be looking for IP_TTL, but in macOS
+            // this doesn't work, instead what we get is IP_RECVTTL
+            if (cmsgp->cmsg_level == IPPROTO_IP and
+                (cmsgp->cmsg_type == IP_TTL or cmsgp->cmsg_type == IP_RECVTTL) and
+                cmsgp->cmsg_len > 0) {
+                auto ttl = *reinterpret_cast<uint8_t const*>(CMSG_DATA(cmsgp));
+                pktInfo.ttl = static_cast<int16_t>(ttl);
+                continue;
+            }
+
+            if (cmsgp->cmsg_level == IPPROTO_IP and
+                cmsgp->cmsg_type == IP_PKTINFO and
+                cmsgp->cmsg_len > 0) {
+                auto const* p = static_cast<void const*>(CMSG_DATA(cmsgp));
+                auto const* pi = reinterpret_cast<in_pktinfo const*>(p);
+                pktInfo.ifIndex = IF_INDEX(pi->ipi_ifindex);
+                // The destination address in the IP header
+                pktInfo.group = IPv4Address::from_nl(pi->ipi_addr.s_addr);
+                continue;
+            }
+
+#ifdef __linux__
+            if (cmsgp->cmsg_level == SOL_SOCKET and
+                cmsgp->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsgp), sizeof(ts));
+                pktInfo.timestamp = toNanos(ts);
+                continue;
+            }
+
+            if (cmsgp->cmsg_level == SOL_SOCKET and
+                cmsgp->cmsg_type == SCM_TIMESTAMPING) {
+                // The software timestamp is in the first element, and the
+                // raw hardware timestamp is in the third one; the second
+                // element is deprecated and always zero.
+                timespec ts[3];
+                memcpy(ts, CMSG_DATA(cmsgp), sizeof(ts));
+                auto hwts = toNanos(ts[2]);
+                pktInfo.timestamp = hwts != 0 ? hwts : toNanos(ts[0]);
+                continue;
+            }
+
+            if (cmsgp->cmsg_level == SOL_UDP and cmsgp->cmsg_type == UDP_GRO) {
+                int segSize;
+                memcpy(&segSize, CMSG_DATA(cmsgp), sizeof(segSize));
+                groSize = static_cast<unsigned>(segSize);
+                continue;
+            }
+
+            if (cmsgp->cmsg_level == SOL_SOCKET and
+                cmsgp->cmsg_type == SO_RXQ_OVFL) {
+                memcpy(&drops, CMSG_DATA(cmsgp), sizeof(drops));
+            }
+#endif
+        }
+
+#ifndef __linux__
+        (void)drops;
+#endif
+
+        return groSize;
+    }
+
+    PIMC_ALWAYS_INLINE
+    static uint64_t toNanos(timespec const& ts) {
+        return static_cast<uint64_t>(ts.tv_sec) * NanosInSecond
+             + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    /*!
+     * \brief Receives a single packet from the non-blocking socket.
+     *
+     * @return true if the packet limit has been reached, false otherwise
+     */
+    bool receive(Shard& shard, RxSocket& rxs, Timer& timer) {
+        auto& pktInfo = shard.pktInfo;
+        pktInfo.reset();
+        pktInfo.dport = rxs.dport;
+
+        uint8_t cmsgBuf[CmsgBufferSize];
+        sockaddr_in sender;
+        memset(&sender, 0, sizeof(sender));
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &sender;
+        msg.msg_namelen = sizeof(sender);
+        msg.msg_iov = shard.arena.iov(0);
+        msg.msg_iovlen = RxArena::iovLen();
+        msg.msg_control = cmsgBuf;
+        msg.msg_controllen = sizeof(cmsgBuf);
+
+        ssize_t rsz = recvmsg(rxs.fd, &msg, 0);
+
+        if (rsz < 0) {
+            if (errno == EAGAIN or errno == EINTR) return false;
+
+            raise<std::runtime_error>("recvmsg() failed: {}", SysError{});
+        }
+
+        // If the kernel timestamps are enabled, parseControl() replaces
+        // the host time with the time when the packet actually arrived
+        pktInfo.timestamp = timer.timestamp();
+        pktInfo.receivedSize = static_cast<unsigned>(rsz);
+        pktInfo.received = shard.arena.data(0, pktInfo.receivedSize);
+        auto groSize = parseControl(msg, pktInfo, rxs.drops);
+
+        return process(shard, sender, pktInfo, groSize, timer);
+    }
+
+    /*!
+     * \brief Passes the received packet to the receiver provider and
+     * accounts for it.
+     *
+     * If the packet is a UDP GRO coalesced datagram, it is split into the
+     * segments of \p groSize bytes, the last of which may be shorter, and
+     * each segment is processed and accounted for as a separate datagram
+     * with the metadata of the coalesced one.
+     *
+     * @return true if the packet limit has been reached, false otherwise
+     */
+    bool process(
+            Shard& shard, sockaddr_in const& sender,
+            PacketInfo& pktInfo, unsigned groSize, Timer& timer) {
+        if (PIMC_LIKELY(groSize == 0 or pktInfo.receivedSize <= groSize)) {
+            auto ps = impl().processPacket(sender, pktInfo);
+            return onPacket(shard, static_cast<unsigned>(ps), pktInfo, timer);
+        }
+
+        auto const* data = pktInfo.received;
+        auto remaining = pktInfo.receivedSize;
+        while (remaining > 0) {
+            auto segSize = std::min(remaining, groSize);
+            pktInfo.received = data;
+            pktInfo.receivedSize = segSize;
+            pktInfo.payloadOffset = 0;
+            pktInfo.mclstBeacon = false;
+            pktInfo.integrity = Integrity::Unchecked;
+
+            auto ps = impl().processPacket(sender, pktInfo);
+            if (onPacket(shard, static_cast<unsigned>(ps), pktInfo, timer))
+                return true;
+
+            data += segSize;
+            remaining -= segSize;
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Accounts for the packet with the status \p ps returned by the
+     * receiver provider.
+     *
+     * @return true if the packet limit has been reached, false otherwise
+     */
+    bool onPacket(
+            Shard& shard, unsigned ps, PacketInfo const& pktInfo, Timer& timer) {
+        if (PIMC_LIKELY(ps & Accepted)) {
+            timer.reset();
+
+            // Only the raw receiver providers return NoShow, so such a
+            // packet is recorded as received
+            if (PIMC_UNLIKELY(shard.recorder != nullptr))
+                guardRecorder(shard, pktInfo.timestamp, [&] (FlightRecorder& fr) {
+                    fr.record(pktInfo, not (ps & Show));
+                });
+
+            if (PIMC_LIKELY(ps & Show)) {
+                // The beacon is reflected before the packet is formatted
+                if (PIMC_UNLIKELY(shard.reflector != nullptr))
+                    shard.reflector->reflect(pktInfo);
+
+                if (PIMC_UNLIKELY(shard.capture != nullptr))
+                    shard.capture->push(pktInfo);
+
+                if constexpr (Output::Shows) {
+                    // The corrupt beacons are dumped even if not sampled
+                    if (output_.show(shard.sampleCount) or
+                        (PIMC_UNLIKELY(pktInfo.integrity == Integrity::Corrupt) and
+                         cfg_.dumpCorrupt()))
+                        oh_.showReceivedPacket(pktInfo);
+                }
+
+                if (PIMC_UNLIKELY(shard.zapper != nullptr) and
+                    shard.zapper->onPacket(
+                            pktInfo.group, pktInfo.source, pktInfo.timestamp))
+                    oh_.showZapJoinLatency(
+                            pktInfo.timestamp, shard.zapper->joined().sub,
+                            shard.zapper->joinLatency());
+
+                if (PIMC_UNLIKELY(shard.joiner != nullptr))
+                    shard.joiner->onPacket(
+                            pktInfo.group, pktInfo.dport, pktInfo.timestamp);
+
+                if (PIMC_UNLIKELY(shard.arbiter != nullptr))
+                    shard.arbiter->onPacket(pktInfo);
+
+                // NoShow means pktInfo is incomplete and instead the
+                // receive() call produced a warning. Therefore, we only
+                // count packets which are shown.
+                auto& fs = shard.rxStats.update(
+                        pktInfo.group, pktInfo.source, pktInfo.sport, pktInfo.dport,
+                        pktInfo.payloadSize);
+
+                // The arbiter accounts for the sequence numbers of each
+                // line, whereas here every packet would arrive twice
+                uint64_t seq;
+                if (PIMC_LIKELY(shard.arbiter == nullptr) and
+                    seqDecoder_.decode(pktInfo, seq)) {
+                    auto lost = fs.lost();
+                    fs.sequence(seq);
+                    if (PIMC_UNLIKELY(shard.recorder != nullptr) and fs.lost() > lost)
+                        anomaly(shard, pktInfo.timestamp,
+                                "sequence gap of {} in flow {}:{}->{}:{}",
+                                fs.lost() - lost, pktInfo.source, pktInfo.sport,
+                                pktInfo.group, pktInfo.dport);
+                }
+
+                if (PIMC_UNLIKELY(pktInfo.integrity != Integrity::Unchecked)) {
+                    fs.verified(pktInfo.integrity == Integrity::Intact);
+                    if (PIMC_UNLIKELY(shard.recorder != nullptr) and
+                        pktInfo.integrity == Integrity::Corrupt)
+                        anomaly(shard, pktInfo.timestamp,
+                                "corrupted beacon in flow {}:{}->{}:{}",
+                                pktInfo.source, pktInfo.sport,
+                                pktInfo.group, pktInfo.dport);
+                }
+
+                if (PIMC_UNLIKELY(shard.recorder != nullptr) and
+                    fs.ttlChanged(pktInfo.ttl, lineOf(shard, pktInfo)))
+                    anomaly(shard, pktInfo.timestamp,
+                            "TTL changed to {} in flow {}:{}->{}:{}",
+                            pktInfo.ttl, pktInfo.source, pktInfo.sport,
+                            pktInfo.group, pktInfo.dport);
+
+                if (PIMC_UNLIKELY(shard.silence != nullptr))
+                    shard.silence->onPacket(
+                            FlowKey{.group = pktInfo.group, .source = pktInfo.source,
+                                    .sport = pktInfo.sport, .dport = pktInfo.dport},
+                            fs, timer.timestamp(),
+                            [this, &pktInfo] (FlowKey const& fk, uint64_t outageNs) {
+                                oh_.showFlowResumed(pktInfo.timestamp, fk, outageNs);
+                            });
+            } else if (PIMC_UNLIKELY(shard.recorder != nullptr))
+                anomaly(shard, pktInfo.timestamp, "malformed packet");
+
+            return limit_.reached();
+        }
+
+        return false;
+    }
+
+#ifdef __linux__
+    /*!
+     * \brief Drains the socket using `recvmmsg()`.
+     *
+     * The socket is read in batches until a batch comes back short, which
+     * means the socket receive queue has been emptied and the next call
+     * would fail with `EAGAIN`. This saves the extra system call which
+     * would be needed to observe `EAGAIN` itself.
+     *
+     * @return true if the packet limit has been reached, false otherwise
+     */
+    bool receiveBatch(Shard& shard, RxSocket& rxs, Timer& timer) {
+        auto& batch = *shard.batch;
+
+        while (not stopping()) {
+            int n = batch.recv(rxs.fd);
+            timer.save();
+
+            if (n < 0) {
+                if (errno == EAGAIN) return false;
+                if (errno == EINTR) continue;
+
+                raise<std::runtime_error>("recvmmsg() failed: {}", SysError{});
+            }
+
+            auto cnt = static_cast<std::size_t>(n);
+            for (std::size_t i = 0; i < cnt; ++i) {
+                auto& pktInfo = batch.packet(i);
+                pktInfo.reset();
+                pktInfo.dport = rxs.dport;
+                pktInfo.timestamp = timer.timestamp();
+                pktInfo.receivedSize = batch.length(i);
+                pktInfo.received = batch.data(i);
+                auto groSize = parseControl(batch.header(i), pktInfo, rxs.drops);
+
+                if (process(shard, batch.sender(i), pktInfo, groSize, timer))
+                    return true;
+            }
+
+            if (cnt < batch.size()) return false;
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Creates the `io_uring` instance of the shard.
+     *
+     * If `io_uring` is not supported, a warning is shown once and the
+     * shard falls back to receiving using `recvmsg()`.
+     *
+     * @return true if the instance has been created, false otherwise
+     */
+    bool openUring(Shard& shard) {
+        try {
+            // The coalesced datagrams need the buffers of the largest size
+            if (cfg_.gro())
+                shard.uring = std::make_unique<UringRx>(
+                        UringGroBuffers, BufferSize,
+                        cfg_.hugePages(), shardNode(shard.id));
+            else shard.uring = std::make_unique<UringRx>(
+                        UringBuffers, RxSlotSize,
+                        cfg_.hugePages(), shardNode(shard.id));
+            return true;
+        } catch (std::runtime_error const& ex) {
+            if (not uringFallback_)
+                oh_.warning(
+                        "io_uring is not available, falling back to "
+                        "recvmsg(): {}\n", ex.what());
+            uringFallback_ = true;
+            return false;
+        }
+    }
+
+    /*!
+     * \brief Enables the `io_uring` instance of the shard in the calling
+     * thread and submits the multishot receive requests for its sockets.
+     */
+    void startUring(Shard& shard) {
+        shard.uring->enable();
+        for (std::size_t i = 0; i < shard.sockets.size(); ++i)
+            shard.uring->recv(shard.sockets[i].fd, static_cast<uint32_t>(i));
+    }
+
+    /*!
+     * \brief Processes the completions of the `io_uring` instance.
+     *
+     * @return true if the packet limit has been reached, false otherwise
+     */
+    bool receiveUring(Shard& shard, Timer& timer) {
+        auto& pktInfo = shard.pktInfo;
+
+        return shard.uring->drain([&] (UringRx::Completion const& c) {
+            if (PIMC_UNLIKELY(c.truncated)) {
+                if (not uringTruncated_.exchange(true, std::memory_order_relaxed))
+                    oh_.warning(
+                            "datagrams larger than {} bytes are truncated "
+                            "with --io-uring unless --gro is specified, "
+                            "ignored\n", shard.uring->payloadSize());
+                return false;
+            }
+
+            auto& rxs = shard.sockets[c.id];
+            pktInfo.reset();
+            pktInfo.dport = rxs.dport;
+            pktInfo.timestamp = timer.timestamp();
+            pktInfo.received = c.data;
+            pktInfo.receivedSize = c.size;
+            auto groSize = parseControl(*c.hdr, pktInfo, rxs.drops);
+
+            return process(shard, *c.sender, pktInfo, groSize, timer);
+        });
+    }
+
+    /*!
+     * \brief Processes the packets in the ready blocks of the packet ring
+     * in place.
+     *
+     * @return true if the packet limit has been reached, false otherwise
+     */
+    bool receiveRing(Shard& shard, Timer& timer) {
+        auto& ring = *shard.ring;
+        auto& pktInfo = shard.pktInfo;
+        static sockaddr_in const noSender{};
+
+        while (ring.ready() and not stopping()) {
+            bool done = ring.drainBlock([&] (PacketRing::Frame const& frame) {
+                pktInfo.reset();
+                pktInfo.timestamp = frame.timestamp;
+                pktInfo.ifIndex = frame.ifIndex;
+                pktInfo.received = frame.data;
+                pktInfo.receivedSize = frame.size;
+
+                auto ps = impl().processPacket(noSender, pktInfo);
+                return onPacket(shard, static_cast<unsigned>(ps), pktInfo, timer);
+            });
+
+            if (done) return true;
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Processes the packets received by the `AF_XDP` sockets of the
+     * shard in place.
+     *
+     * @return true if the packet limit has been reached, false otherwise
+     */
+    bool receiveXdp(Shard& shard, Timer& timer) {
+        auto& pktInfo = shard.pktInfo;
+        static sockaddr_in const noSender{};
+
+        for (auto const& xsk: shard.xsks) {
+            bool done = xsk->drain([&] (XdpSocket::Frame const& frame) {
+                pktInfo.reset();
+                pktInfo.timestamp = timer.timestamp();
+                pktInfo.ifIndex = xsk->ifIndex();
+                pktInfo.received = frame.data;
+                pktInfo.receivedSize = frame.size;
+
+                auto ps = impl().processPacket(noSender, pktInfo);
+                return onPacket(shard, static_cast<unsigned>(ps), pktInfo, timer);
+            });
+
+            if (done) return true;
+        }
+
+        return false;
+    }
+#endif
+
+    /*!
+     * \brief Samples the memory taken by the receive queues of the sockets
+     * of the shard, updating their peak occupancy and drop counters.
+     *
+     * The queues are sampled with `SO_MEMINFO` rather than `SIOCINQ`, as
+     * the latter only returns the size of the next datagram of a UDP
+     * socket. The sockets opened along with a packet ring or the `AF_XDP`
+     * sockets only join the groups and are not sampled.
+     *
+     * @param now the current host time in nanoseconds
+     */
+    void sampleQueues(Shard& shard, uint64_t now) {
+        shard.sampleAt = now + SampleIntervalNs;
+#ifdef __linux__
+        if constexpr (PacketRingProvider<RP> or XdpProvider<RP>) return;
+
+        for (auto& rxs: shard.sockets) {
+            uint32_t meminfo[SK_MEMINFO_VARS];
+            socklen_t len = sizeof(meminfo);
+            if (getsockopt(rxs.fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) == -1)
+                continue;
+
+            rxs.peakQueue = std::max<uint64_t>(
+                    rxs.peakQueue, meminfo[SK_MEMINFO_RMEM_ALLOC]);
+            rxs.rcvbuf = meminfo[SK_MEMINFO_RCVBUF];
+            rxs.drops = std::max(rxs.drops, meminfo[SK_MEMINFO_DROPS]);
+        }
+#else
+        (void)shard;
+#endif
+    }
+
+    /*!
+     * \brief Adds the kernel accounting of the sockets of the shard to its
+     * statistics, sampling the receive queues for the last time. The
+     * kernel accounting is only available in Linux.
+     */
+    void addSocketStats(Shard& shard) {
+#ifdef __linux__
+        if constexpr (PacketRingProvider<RP> or XdpProvider<RP>) return;
+
+        sampleQueues(shard, gethostnanos());
+        for (auto const& rxs: shard.sockets) {
+            shard.rxStats.addSocket(SocketStats{
+                .dport = rxs.dport,
+                .subs = rxs.subs.size(),
+                .drops = rxs.drops,
+                .peakQueue = rxs.peakQueue,
+                .rcvbuf = rxs.rcvbuf,
+            });
+        }
+#else
+        (void)shard;
+#endif
+    }
+
+    /*!
+     * @return 1 if the packet \p pktInfo has arrived on the B line, 0 if
+     * on the A line or if the lines are not arbitrated
+     */
+    unsigned lineOf(Shard const& shard, PacketInfo const& pktInfo) const {
+        return shard.arbiter and pktInfo.ifIndex == cfg_.lineB().ifIndex ? 1 : 0;
+    }
+
+    /*!
+     * \brief Accounts for the outages of the flows of the shard which are
+     * still silent when the receive ends.
+     */
+    void finishSilence(Shard& shard) {
+        if (shard.silence)
+            shard.silence->finish(shard.rxStats, gethostnanos());
+    }
+
+    /*!
+     * \brief Receives from the socket, the packet ring, the `io_uring`
+     * instance or the `AF_XDP` sockets registered with the poller of the
+     * shard under \p id.
+     *
+     * @return true if the packet limit has been reached, false otherwise
+     */
+    bool receiveFrom(Shard& shard, uint32_t id, Timer& timer) {
+#ifdef __linux__
+        if (id == RingId)
+            return receiveRing(shard, timer);
+
+        if (id == UringId)
+            return receiveUring(shard, timer);
+
+        if (id == XdpId)
+            return receiveXdp(shard, timer);
+#endif
+        auto& rxs = shard.sockets[id];
+#ifdef __linux__
+        if (shard.batch)
+            return receiveBatch(shard, rxs, timer);
+#endif
+        return receive(shard, rxs, timer);
+    }
+
+    void receiveLoop(Shard& shard) {
+        RxStats::Timer rxStatsTimer{shard.rxStats};
+        Timer timer{cfg_};
+        auto timeoutMs = cfg_.timeoutSec() * 1000u;
+
+#ifdef __linux__
+        if (shard.uring) startUring(shard);
+#endif
+
+        if (cfg_.busyPoll() > 0) {
+            spinLoop(shard, timer);
+            return;
+        }
+
+        bool scheduled = shard.zapper or shard.joiner or shard.silence;
+        while (not stopping()) {
+            if (PIMC_UNLIKELY(updateRequested_.load(std::memory_order_relaxed))
+                and shard.id == 0)
+                postSources();
+            if (PIMC_UNLIKELY(shard.sourcesPosted.load(std::memory_order_relaxed)))
+                updateSources(shard);
+
+            auto waitMs = scheduled
+                    ? runScheduled(shard, gethostnanos(), timeoutMs) : timeoutMs;
+            int rc = shard.poller.wait(waitMs);
+            timer.save();
+
+            if (PIMC_UNLIKELY(timer.timestamp() >= shard.sampleAt))
+                sampleQueues(shard, timer.timestamp());
+
+            if (rc < 0) {
+                if (errno == EINTR) continue;
+
+                raise<std::runtime_error>("poller failed: {}", SysError{});
+            }
+
+            if (rc == 0) {
+                if (timer.timeout()) {
+                    oh_.showTimeout(timer.timestamp());
+                    timer.reset();
+                }
+
+                continue;
+            }
+
+            auto n = static_cast<std::size_t>(rc);
+            for (std::size_t i = 0; i < n; ++i) {
+                auto id = shard.poller.ready(i);
+                if (PIMC_UNLIKELY(id == StopId)) return;
+                if (PIMC_UNLIKELY(id == WakeId)) {
+                    char buf[64];
+                    while (read(shard.wakePipe[0], buf, sizeof(buf)) == -1 and
+                           errno == EINTR);
+                    continue;
+                }
+
+                if (receiveFrom(shard, id, timer)) return;
+            }
+        }
+    }
+
+    /*!
+     * \brief Receives without ever blocking in the poller.
+     *
+     * The sockets, the packet ring, the `io_uring` instance or the
+     * `AF_XDP` sockets are polled
+     * in a loop. The host time is saved on each iteration, so the timer
+     * drives the timeouts just as if the poller had timed out.
+     */
+    void spinLoop(Shard& shard, Timer& timer) {
+        std::vector<uint32_t> ids;
+#ifdef __linux__
+        if (shard.ring) ids.push_back(RingId);
+        else if (shard.uring) ids.push_back(UringId);
+        else if (not shard.xsks.empty()) ids.push_back(XdpId);
+#endif
+        if (ids.empty()) {
+            for (std::size_t i = 0; i < shard.sockets.size(); ++i)
+                ids.push_back(static_cast<uint32_t>(i));
+        }
+
+        bool scheduled = shard.zapper or shard.joiner or shard.silence;
+        while (not stopping()) {
+            timer.save();
+
+            if (PIMC_UNLIKELY(timer.timeout())) {
+                oh_.showTimeout(timer.timestamp());
+                timer.reset();
+            }
+
+            if (PIMC_UNLIKELY(scheduled))
+                runScheduled(shard, timer.timestamp(), 0);
+
+            if (PIMC_UNLIKELY(updateRequested_.load(std::memory_order_relaxed))
+                and shard.id == 0)
+                postSources();
+            if (PIMC_UNLIKELY(shard.sourcesPosted.load(std::memory_order_relaxed)))
+                updateSources(shard);
+
+            if (PIMC_UNLIKELY(timer.timestamp() >= shard.sampleAt))
+                sampleQueues(shard, timer.timestamp());
+
+            for (auto id: ids) {
+                if (receiveFrom(shard, id, timer)) return;
+            }
+        }
+    }
+
+    /*!
+     * \brief Feeds the packets of the capture file through the dissection
+     * and the accounting of a single shard as fast as the file is read.
+     *
+     * The packets are timestamped with their capture times, and the
+     * duration of the statistics is the time span of the capture rather
+     * than the time it took to read it.
+     */
+    void replay() {
+        shards_.push_back(std::make_unique<Shard>(0, false, -1));
+        openCapture();
+        openRecorders();
+        auto& shard = *shards_[0];
+        auto& pktInfo = shard.pktInfo;
+        static sockaddr_in const noSender{};
+
+        PcapFile pcap{cfg_.pcap()};
+        uint64_t firstNs{0};
+        uint64_t lastNs{0};
+        auto startNs = gethostnanos();
+        {
+            RxStats::Timer rxStatsTimer{shard.rxStats};
+            Timer timer{cfg_};
+            pcap.forEach([&] (PcapFile::Frame const& frame) {
+                if (PIMC_UNLIKELY(stopping())) return true;
+
+                if (PIMC_UNLIKELY(firstNs == 0)) {
+                    firstNs = frame.timestamp;
+                    if (cfg_.silence() > 0)
+                        shard.silence = std::make_unique<SilenceWheel>(
+                                uint64_t{cfg_.silence()} * 1'000'000, firstNs);
+                }
+                lastNs = frame.timestamp;
+
+                // The silence is measured in the time of the capture
+                if (shard.silence)
+                    checkSilence(shard, frame.timestamp);
+
+                pktInfo.reset();
+                pktInfo.timestamp = frame.timestamp;
+                pktInfo.ifIndex = cfg_.intfIndex();
+                pktInfo.received = frame.data;
+                pktInfo.receivedSize = frame.size;
+
+                auto ps = impl().processPacket(noSender, pktInfo);
+                timer.save(frame.timestamp);
+                return onPacket(shard, static_cast<unsigned>(ps), pktInfo, timer);
+            });
+        }
+
+        if (lastNs > firstNs)
+            shard.rxStats.setDurationNanos(lastNs - firstNs);
+        if (shard.silence)
+            shard.silence->finish(shard.rxStats, lastNs);
+
+        if (pcap.truncated())
+            oh_.warning("capture file '{}' is truncated\n", cfg_.pcap());
+        oh_.showReplay(pcap.frames(), pcap.skipped(), pcap.size(), gethostnanos() - startNs);
+    }
+
+    [[nodiscard]]
+    bool stopping() const {
+        return stopped_ or done_.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief Makes all shards return from their receive loops.
+     */
+    void stopShards() {
+        done_.store(true, std::memory_order_relaxed);
+        if (stopPipe_[1] != -1) {
+            char c{0};
+            // The pipe is never read, so it remains readable for all pollers
+            while (write(stopPipe_[1], &c, 1) == -1 and errno == EINTR);
+        }
+    }
+
+    /*!
+     * \brief Starts the capture writer, if configured, with a capture ring
+     * per shard.
+     */
+    void openCapture() {
+        if (cfg_.write().empty()) return;
+
+        capture_ = std::make_unique<CaptureWriter>(
+                cfg_.write(), static_cast<unsigned>(shards_.size()),
+                cfg_.snaplen(), uint64_t{cfg_.rotate()} << 20u);
+        for (auto& shard: shards_)
+            shard->capture = &capture_->ring(shard->id);
+    }
+
+    /*!
+     * \brief Writes the rest of the captured packets once the shards have
+     * stopped and shows the statistics of the capture.
+     */
+    void closeCapture() {
+        if (not capture_) return;
+
+        capture_->stop();
+        oh_.showCaptureStats(capture_->stats());
+    }
+
+    /*!
+     * \brief Starts the flight recorders, if configured, one per shard.
+     */
+    void openRecorders() {
+        if (cfg_.record().empty()) return;
+
+        for (auto& shard: shards_)
+            shard->recorder = std::make_unique<FlightRecorder>(
+                    cfg_.record(), cfg_.recordDepth(), cfg_.recordAfter(),
+                    cfg_.recordSnaplen(), cfg_.hugePages(), shardNode(shard->id),
+                    dumpFiles_);
+    }
+
+    /*!
+     * \brief Closes the dumps in progress once the shards have stopped and
+     * shows how many dumps have been written.
+     */
+    void closeRecorders() {
+        if (cfg_.record().empty()) return;
+
+        for (auto& shard: shards_) {
+            if (shard->recorder)
+                guardRecorder(*shard, gethostnanos(), [] (FlightRecorder& fr) {
+                    fr.stop();
+                });
+        }
+        oh_.showFlightDumps(dumps_.load(std::memory_order_relaxed));
+    }
+
+    /*!
+     * \brief Runs \p f with the flight recorder of the shard \p shard and
+     * stops the recorder if it fails to write a dump, so that the receive
+     * goes on.
+     */
+    template <typename F>
+    void guardRecorder(Shard& shard, uint64_t ts, F&& f) {
+        try {
+            f(*shard.recorder);
+        } catch (std::runtime_error const& ex) {
+            oh_.warningTs(ts, "{}, the flight recorder is stopped", ex.what());
+            shard.recorder.reset();
+        }
+    }
+
+    /*!
+     * \brief Triggers the flight recorder of the shard \p shard on the
+     * anomaly described by the format string \p fs and its arguments.
+     */
+    template <typename ... Ts>
+    PIMC_NO_INLINE
+    void anomaly(
+            Shard& shard, uint64_t ts, fmt::format_string<Ts...> const& fs, Ts&& ... args) {
+        guardRecorder(shard, ts, [&] (FlightRecorder& fr) {
+            if (auto dump = fr.trigger()) {
+                dumps_.fetch_add(1, std::memory_order_relaxed);
+                oh_.showFlightDump(ts, fmt::format(fs, std::forward<Ts>(args)...), *dump);
+            }
+        });
+    }
+
+    /*!
+     * @return the NUMA node of the CPU to which the receive thread of the
+     * shard \p shardId is pinned, or -1 if the thread is not pinned or its
+     * receive buffers are not backed by the huge pages
+     */
+    int shardNode(unsigned shardId) const {
+#ifdef __linux__
+        auto const& cpus = cfg_.cpus();
+        if (not cfg_.hugePages() or cpus.empty()) return -1;
+
+        return cpuNode(cpus[shardId % cpus.size()]);
+#else
+        (void)shardId;
+        return -1;
+#endif
+    }
+
+#ifdef __linux__
+    /*!
+     * @return the outcome of backing the receive buffers of the shard
+     * \p shard with the huge pages
+     */
+    static RtControl hugePagesControl(Shard const& shard) {
+        auto name = fmt::format("huge pages #{}", shard.id);
+        std::vector<MappedBuffer const*> slabs{&shard.arena.slab()};
+        if (shard.batch)
+            slabs.push_back(&shard.batch->arena().slab());
+        if (shard.uring)
+            slabs.push_back(&shard.uring->buffers());
+
+        std::size_t size{0};
+        for (auto const* slab: slabs) {
+            if (not slab->huge())
+                return {std::move(name), false, fmt::format(
+                        "{}, see vm.nr_hugepages", SysError{slab->hugeError()})};
+            size += slab->mappedSize();
+        }
+
+        auto hps = hugePageSize();
+        auto detail = fmt::format("{} x {} KiB", size / hps, hps / 1024);
+        if (slabs[0]->node() >= 0)
+            fmt::format_to(std::back_inserter(detail), " on NUMA node {}", slabs[0]->node());
+        return {std::move(name), true, std::move(detail)};
+    }
+#endif
+
+    /*!
+     * \brief Pins the calling receive thread of the shard \p shard to its
+     * CPU, sets its scheduling policy and prefaults its stack.
+     */
+    void applyControls(Shard& shard, char const* progname) {
+#ifdef __linux__
+        auto const& cpus = cfg_.cpus();
+        if (not cpus.empty())
+            shard.controls.push_back(pinThread(
+                    fmt::format("CPU affinity #{}", shard.id),
+                    cpus[shard.id % cpus.size()]));
+
+        if (cfg_.fifo() > 0)
+            shard.controls.push_back(setFifo(
+                    fmt::format("SCHED_FIFO #{}", shard.id), cfg_.fifo(), progname));
+#else
+        (void)shard;
+        (void)progname;
+#endif
+
+        if (cfg_.mlock()) prefaultStack();
+    }
+
+    /*!
+     * \brief Shows the outcome of the controls applied to the process
+     * and to the receive threads, if any have been requested.
+     */
+    void showControls() {
+        RtControls controls{controls_};
+        for (auto const& shard: shards_)
+            controls.insert(controls.end(), shard->controls.begin(), shard->controls.end());
+
+        if (not controls.empty())
+            oh_.showRtControls(controls);
+    }
+
+    void runShard(
+            Shard& shard, char const* progname,
+            std::latch& applied, std::exception_ptr& error) {
+        bool counted{false};
+        try {
+            applyControls(shard, progname);
+            applied.count_down();
+            counted = true;
+
+            // The controls of all the threads are shown at once
+            if (shard.id == 0) {
+                applied.wait();
+                showControls();
+            }
+
+            receiveLoop(shard);
+        } catch (...) {
+            if (not counted) applied.count_down();
+            error = std::current_exception();
+        }
+        stopShards();
+    }
+
+    /*!
+     * \brief Runs the shards in their own threads, except the first one
+     * which runs in the calling thread.
+     *
+     * The termination signals and the signal which updates the sources
+     * are blocked in the worker threads, so they are always delivered to
+     * the calling thread, whose shard then stops the rest of the shards
+     * or updates the sources of their sockets.
+     */
+    void receiveShards(char const* progname) {
+        std::vector<std::exception_ptr> errors(shards_.size());
+        std::latch applied{static_cast<std::ptrdiff_t>(shards_.size())};
+        std::vector<std::thread> workers;
+        workers.reserve(shards_.size() - 1);
+
+        sigset_t mask, oldMask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigaddset(&mask, SIGHUP);
+        sigaddset(&mask, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &mask, &oldMask);
+        for (std::size_t i = 1; i < shards_.size(); ++i) {
+            workers.emplace_back([this, i, progname, &applied, &errors] {
+                runShard(*shards_[i], progname, applied, errors[i]);
+            });
+        }
+        pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+
+        runShard(*shards_[0], progname, applied, errors[0]);
+
+        for (auto& worker: workers)
+            worker.join();
+
+        for (auto const& error: errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+
+public:
+    void run(char const* progname) {
+        if (not cfg_.pcap().empty()) {
+            replay();
+            oh_.showRxStats(shards_[0]->rxStats, stopped_);
+            oh_.showSourceStats(cfg_.subscriptions(), shards_[0]->rxStats);
+            closeCapture();
+            closeRecorders();
+            return;
+        }
+
+#ifdef __linux__
+        // The receive buffers are mapped after the memory is locked
+        if (cfg_.mlock())
+            controls_.push_back(lockMemory(progname));
+#endif
+
+        configure(progname);
+        join();
+
+        if (not cfg_.reloadFile().empty())
+            SignalHandler<>::install<SIGUSR1>([] (int) {
+                updateRequested_.store(true, std::memory_order_relaxed);
+            });
+
+        auto& rxStats = shards_[0]->rxStats;
+        if (shards_.size() == 1) {
+            applyControls(*shards_[0], progname);
+            showControls();
+            receiveLoop(*shards_[0]);
+            addSocketStats(*shards_[0]);
+            finishSilence(*shards_[0]);
+        } else {
+            receiveShards(progname);
+            for (auto& shard: shards_) {
+                addSocketStats(*shard);
+                finishSilence(*shard);
+            }
+            for (std::size_t i = 1; i < shards_.size(); ++i)
+                rxStats.merge(shards_[i]->rxStats);
+        }
+
+        oh_.showRxStats(rxStats, stopped_);
+
+        // The source lists may have been updated while receiving
+        std::vector<Subscription> subs;
+        for (auto const& shard: shards_) {
+            for (auto const& rxs: shard->sockets)
+                subs.insert(subs.end(), rxs.subs.begin(), rxs.subs.end());
+        }
+        oh_.showSourceStats(subs, rxStats);
+
+        if (cfg_.zap() > 0) {
+            auto& zapStats = shards_[0]->zapper->stats();
+            for (std::size_t i = 1; i < shards_.size(); ++i)
+                zapStats.merge(shards_[i]->zapper->stats());
+            oh_.showZapStats(zapStats);
+        }
+
+        if (cfg_.joinRate() > 0) {
+            JoinStats joinStats;
+            for (auto const& shard: shards_)
+                joinStats.merge(shard->joiner->stats());
+            oh_.showJoinStats(joinStats);
+        }
+
+        if (cfg_.lineB()) {
+            LineStats lineStats;
+            for (auto const& shard: shards_)
+                lineStats.merge(shard->arbiter->stats());
+            oh_.showLineStats(lineStats);
+        }
+
+        if (cfg_.reflect()) {
+            ReflectStats reflectStats;
+            for (auto const& shard: shards_)
+                reflectStats.merge(shard->reflector->stats());
+            oh_.showReflectStats(reflectStats);
+        }
+
+        closeCapture();
+        closeRecorders();
+    }
+
+private:
+    std::vector<std::unique_ptr<Shard>> shards_;
+    int stopPipe_[2]{-1, -1};
+    std::atomic<bool> done_{false};
+#ifdef __linux__
+    // The timestamping configuration of an interface before mclst changed it
+    struct HwTimestamping final {
+        std::string intf;
+        hwtstamp_config config;
+    };
+
+    bool hwTimestampsRequested_{false};
+    std::vector<HwTimestamping> hwSaved_;
+    bool uringFallback_{false};
+    // Set once the truncated io_uring datagrams have been reported
+    std::atomic<bool> uringTruncated_{false};
+    bool busyPollWarned_{false};
+    bool rcvbufWarned_{false};
+#endif
+    // The controls applied to the whole process
+    RtControls controls_;
+    std::unique_ptr<CaptureWriter> capture_;
+    // The number of the flight recorder dump files named by all shards,
+    // including the ones which could not be created
+    std::atomic<unsigned> dumpFiles_{0};
+    // The number of the flight recorder dumps started by all shards
+    std::atomic<unsigned> dumps_{0};
+    SeqDecoder seqDecoder_;
     Limit limit_;
-    RxStats rxStats_;
+    Output output_;
+    // The source lists posted by the first shard, see postSources()
+    std::shared_ptr<std::vector<Subscription> const> sources_;
+    std::mutex sourcesMutex_;
+    // Set by the SIGUSR1 handler, see postSources()
+    inline static std::atomic<bool> updateRequested_{false};
+    // Only the lock-free atomics may be used in a signal handler
+    static_assert(std::atomic<bool>::is_always_lock_free);
 };
 
 } // namespace pimc
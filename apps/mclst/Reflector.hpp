@@ -0,0 +1,126 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <map>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/IPv4Formatters.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+#include "Config.hpp"
+#include "LatencyHistogram.hpp"
+#include "PacketInfo.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The number of the beacons reflected by the reflectors of the
+ * receive threads.
+ */
+struct ReflectStats final {
+    uint64_t reflected{0};
+    // The beacons which could not be sent, e.g. as the socket send
+    // buffer was full
+    uint64_t failed{0};
+
+    void merge(ReflectStats const& other) {
+        reflected += other.reflected;
+        failed += other.failed;
+    }
+};
+
+/*!
+ * \brief The round trip times of the beacons measured by the sender for
+ * each reflector.
+ */
+struct RttStats final {
+    std::map<IPv4Address, LatencyHistogram> reflectors;
+};
+
+/*!
+ * \brief Sends the received mclst beacons back to the return group, so
+ * that their sender can measure the round trip time with its own clock.
+ *
+ * The beacon is sent unmodified right from the receive buffer, so its
+ * sequence number and the sender's timestamp are preserved and no copy
+ * is made. The socket is connected to the return group, which saves the
+ * route lookup of each send, and the send never blocks: if the socket
+ * send buffer is full, the beacon is counted as failed rather than
+ * delaying the receive.
+ */
+class Reflector final {
+public:
+    explicit Reflector(Config const& cfg): fd_{socket(AF_INET, SOCK_DGRAM, 0)} {
+        if (fd_ == -1)
+            raise<std::runtime_error>("unable to create reflect socket: {}", SysError{});
+
+        try {
+            configure(cfg);
+        } catch (...) {
+            close(fd_);
+            throw;
+        }
+    }
+
+    Reflector(Reflector const&) = delete;
+    Reflector(Reflector&&) = delete;
+    Reflector& operator= (Reflector const&) = delete;
+    Reflector& operator= (Reflector&&) = delete;
+
+    ~Reflector() { close(fd_); }
+
+    PIMC_ALWAYS_INLINE
+    void reflect(PacketInfo const& pktInfo) {
+        if (not pktInfo.mclstBeacon) return;
+
+        if (PIMC_LIKELY(send(fd_, pktInfo.payload(), pktInfo.payloadSize, MSG_DONTWAIT) != -1))
+            ++stats_.reflected;
+        else ++stats_.failed;
+    }
+
+    [[nodiscard]]
+    ReflectStats const& stats() const { return stats_; }
+
+private:
+    void configure(Config const& cfg) {
+        auto ttl = static_cast<u_char>(cfg.ttl());
+        if (setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) == -1)
+            raise<std::runtime_error>("unable to set multicast TTL: {}", SysError{});
+
+        // The sender may run on the same host
+        u_char loopback{1};
+        if (setsockopt(fd_, IPPROTO_IP,
+                       IP_MULTICAST_LOOP, &loopback, sizeof(loopback)) == -1)
+            raise<std::runtime_error>(
+                    "unable to set loopback mode on socket: {}", SysError{});
+
+        in_addr intfAddr{.s_addr = cfg.intfAddr().to_nl()};
+        if (setsockopt(fd_, IPPROTO_IP,
+                       IP_MULTICAST_IF, &intfAddr, sizeof(intfAddr)) == -1)
+            raise<std::runtime_error>(
+                    "unable to make {} ({}) multicast output interface: {}",
+                    cfg.intf(), cfg.intfAddr(), SysError{});
+
+        auto const& reflect = cfg.reflect();
+        sockaddr_in dst{};
+        dst.sin_family = AF_INET;
+        dst.sin_port = htons(reflect.dport);
+        dst.sin_addr.s_addr = reflect.group.to_nl();
+        if (connect(fd_, reinterpret_cast<sockaddr*>(&dst), sizeof(dst)) == -1)
+            raise<std::runtime_error>(
+                    "unable to connect reflect socket to {}:{}: {}",
+                    reflect.group, reflect.dport, SysError{});
+    }
+
+private:
+    int fd_;
+    ReflectStats stats_;
+};
+
+} // namespace pimc
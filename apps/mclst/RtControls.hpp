@@ -0,0 +1,127 @@
+#pragma once
+
+#include "pimc/unix/CapState.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/Fmt.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+namespace pimc {
+
+/*!
+ * The outcome of a control of the receive or the send thread requested
+ * to make the latencies deterministic.
+ */
+struct RtControl final {
+    std::string name;
+    bool applied;
+    // What has been applied or why the control has been refused
+    std::string detail;
+};
+
+using RtControls = std::vector<RtControl>;
+
+#ifdef __linux__
+/*!
+ * \brief Pins the calling thread to the CPU \p cpu.
+ */
+inline RtControl pinThread(std::string name, unsigned cpu) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (rc != 0)
+        return {std::move(name), false, fmt::format("CPU {}: {}", cpu, SysError{rc})};
+
+    return {std::move(name), true, fmt::format("CPU {}", cpu)};
+}
+
+/*!
+ * \brief Runs the calling thread under the `SCHED_FIFO` policy at the
+ * priority \p priority.
+ *
+ * The policy requires `CAP_SYS_NICE` unless `RLIMIT_RTPRIO` allows the
+ * priority, so the policy is set even if the capability cannot be raised.
+ */
+inline RtControl setFifo(std::string name, unsigned priority, char const* progname) {
+    auto r = CapState::program(progname).raise(CAP_(SYS_NICE));
+
+    sched_param param{};
+    param.sched_priority = static_cast<int>(priority);
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc == 0)
+        return {std::move(name), true, fmt::format("priority {}", priority)};
+
+    std::string reason;
+    if (rc != EPERM) reason = fmt::format("{}", SysError{rc});
+    else if (not r) reason = r.error();
+    else reason = fmt::format("{}, CAP_SYS_NICE is required", SysError{rc});
+    return {std::move(name), false, std::move(reason)};
+}
+
+/*!
+ * \brief Locks all the memory of the process.
+ *
+ * The memory mapped so far is faulted in and locked right away, whereas
+ * the later mappings are only locked as they are faulted in, so that the
+ * overflow areas of the receive buffers, which are mapped with
+ * `MAP_NORESERVE`, do not take memory until they are used. The receive
+ * buffers are prefaulted when they are created and each thread
+ * prefaults its stack with prefaultStack().
+ */
+inline RtControl lockMemory(char const* progname) {
+    std::string name{"mlockall"};
+    auto r = CapState::program(progname).raise(CAP_(IPC_LOCK));
+
+    if (mlockall(MCL_CURRENT) == -1 or
+        mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == -1) {
+        auto ec = errno;
+        // Nothing is locked if the limit is exceeded halfway
+        munlockall();
+        std::string reason;
+        if (ec != EPERM and ec != ENOMEM) reason = fmt::format("{}", SysError{ec});
+        else if (not r) reason = r.error();
+        else reason = fmt::format(
+                "{}, CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK is required",
+                SysError{ec});
+        return {std::move(name), false, std::move(reason)};
+    }
+
+    std::ifstream status{"/proc/self/status"};
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.starts_with("VmLck:")) {
+            auto kib = std::strtoull(line.c_str() + 6, nullptr, 10);
+            return {std::move(name), true,
+                    fmt::format("{} KiB locked, later mappings on fault", kib)};
+        }
+    }
+
+    return {std::move(name), true, "later mappings on fault"};
+}
+#endif
+
+/*!
+ * \brief Faults in the top of the stack of the calling thread, which
+ * is then locked if the memory is locked.
+ */
+PIMC_NO_INLINE inline void prefaultStack() {
+    constexpr std::size_t StackPrefault{256 * 1024};
+    uint8_t stack[StackPrefault];
+    memset(stack, 0, sizeof(stack));
+    // Keeps the stores, which are otherwise dead
+    asm volatile("" : : "r"(stack) : "memory");
+}
+
+} // namespace pimc
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+#include "MappedBuffer.hpp"
+#include "PacketInfo.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The size of a receive buffer, which accommodates an IPv4 packet
+ * of the standard Ethernet MTU along with its headers.
+ */
+constexpr std::size_t RxSlotSize{2048};
+
+static_assert(RxSlotSize < BufferSize);
+
+/*!
+ * \brief A preallocated set of receive buffers, one per packet slot,
+ * which are reused for every receive call.
+ *
+ * Each slot is backed by an MTU sized buffer in a contiguous slab, which
+ * receives the vast majority of the packets. The reassembled datagrams,
+ * which do not fit in it, overflow into the second I/O vector element,
+ * which points into a `BufferSize` overflow area of the slot. The
+ * overflow areas are mapped with `MAP_NORESERVE`, so they only take
+ * memory once a large datagram is actually received.
+ *
+ * The overflow area of a slot starts with the room for the slot buffer,
+ * so a datagram which has overflowed is made contiguous by copying just
+ * the slot buffer in front of the overflowed part.
+ *
+ * The slab is prefaulted and may be backed by the huge pages on the NUMA
+ * node of the receive thread, see MappedBuffer.
+ */
+class RxArena final {
+public:
+    explicit RxArena(unsigned slots, bool hugePages = false, int node = -1)
+    : slab_{slots * RxSlotSize, hugePages, node}
+    , iovs_(slots * 2u)
+    , overflow_{nullptr}
+    , overflowSize_{slots * BufferSize} {
+        int flags = MAP_PRIVATE | MAP_ANON;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#endif
+        auto* overflow = mmap(
+                nullptr, overflowSize_, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (overflow == MAP_FAILED)
+            raise<std::runtime_error>(
+                    "unable to map receive overflow buffers: {}", SysError{});
+        overflow_ = static_cast<uint8_t*>(overflow);
+
+        for (std::size_t i = 0; i < slots; ++i) {
+            iovs_[2*i].iov_base = slab_.data() + i * RxSlotSize;
+            iovs_[2*i].iov_len = RxSlotSize;
+            iovs_[2*i + 1].iov_base = overflow_ + i * BufferSize + RxSlotSize;
+            iovs_[2*i + 1].iov_len = BufferSize - RxSlotSize;
+        }
+    }
+
+    RxArena(RxArena const&) = delete;
+    RxArena(RxArena&&) = delete;
+    RxArena& operator= (RxArena const&) = delete;
+    RxArena& operator= (RxArena&&) = delete;
+
+    ~RxArena() {
+        if (overflow_ != nullptr)
+            munmap(overflow_, overflowSize_);
+    }
+
+    /*!
+     * @return the two I/O vector elements to receive into the slot \p i
+     */
+    [[nodiscard]]
+    iovec* iov(std::size_t i) { return &iovs_[2*i]; }
+
+    /*!
+     * @return the number of the I/O vector elements returned by iov()
+     */
+    [[nodiscard]]
+    static constexpr std::size_t iovLen() { return 2; }
+
+    /*!
+     * \brief Returns the contiguous data of the packet of size \p size
+     * received into the slot \p i.
+     *
+     * @param i the slot into which the packet has been received
+     * @param size the size of the received packet
+     * @return the pointer to the first byte of the packet
+     */
+    [[nodiscard]]
+    uint8_t const* data(std::size_t i, std::size_t size) {
+        auto* slot = slab_.data() + i * RxSlotSize;
+        if (PIMC_LIKELY(size <= RxSlotSize)) return slot;
+
+        auto* overflow = overflow_ + i * BufferSize;
+        memcpy(overflow, slot, RxSlotSize);
+        return overflow;
+    }
+
+    /*!
+     * @return the slab of the MTU sized receive buffers
+     */
+    [[nodiscard]]
+    MappedBuffer const& slab() const { return slab_; }
+
+private:
+    MappedBuffer slab_;
+    std::vector<iovec> iovs_;
+    uint8_t* overflow_;
+    std::size_t overflowSize_;
+};
+
+} // namespace pimc
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "PacketInfo.hpp"
+#include "RxArena.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The size of the control message buffer of a single received packet.
+ *
+ * The buffer must accommodate the TTL, the UDP GRO segment size, the
+ * socket drop counter, the packet info and the receive timestamps, the
+ * largest of which are the three `timespec` structures delivered with
+ * `SO_TIMESTAMPING`.
+ */
+constexpr std::size_t CmsgBufferSize{
+    CMSG_SPACE(sizeof(int)) +
+    CMSG_SPACE(sizeof(int)) +
+    CMSG_SPACE(sizeof(uint32_t)) +
+    CMSG_SPACE(sizeof(in_pktinfo)) +
+    CMSG_SPACE(3 * sizeof(timespec)) + 64ul};
+
+#ifdef __linux__
+
+/*!
+ * \brief A set of packet slots which is filled by a single `recvmmsg()`
+ * call.
+ *
+ * All the buffers, including the message headers, the receive buffers,
+ * the sender addresses and the control message buffers are allocated
+ * once when the batch is created and are reused for every `recvmmsg()`
+ * call.
+ */
+class RxBatch final {
+public:
+    explicit RxBatch(unsigned size, bool hugePages = false, int node = -1)
+    : slots_(size)
+    , msgs_(size)
+    , arena_{size, hugePages, node}
+    , senders_(size)
+    , cmsgBufs_(size * CmsgBufferSize) {}
+
+    RxBatch(RxBatch const&) = delete;
+    RxBatch(RxBatch&&) = delete;
+    RxBatch& operator= (RxBatch const&) = delete;
+    RxBatch& operator= (RxBatch&&) = delete;
+
+    /*!
+     * \brief Receives up to size() packets from the non-blocking socket
+     * \p socket.
+     *
+     * @param socket the socket from which to receive the packets
+     * @return the number of received packets or -1 in which case `errno`
+     * is set accordingly
+     */
+    int recv(int socket) {
+        for (std::size_t i = 0; i < slots_.size(); ++i) {
+            auto& hdr = msgs_[i].msg_hdr;
+            hdr.msg_name = &senders_[i];
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            hdr.msg_iov = arena_.iov(i);
+            hdr.msg_iovlen = RxArena::iovLen();
+            hdr.msg_control = &cmsgBufs_[i * CmsgBufferSize];
+            hdr.msg_controllen = CmsgBufferSize;
+            hdr.msg_flags = 0;
+            msgs_[i].msg_len = 0;
+        }
+
+        return recvmmsg(
+                socket, msgs_.data(), static_cast<unsigned>(msgs_.size()),
+                MSG_DONTWAIT, nullptr);
+    }
+
+    [[nodiscard]]
+    std::size_t size() const { return slots_.size(); }
+
+    [[nodiscard]]
+    PacketInfo& packet(std::size_t i) { return slots_[i]; }
+
+    [[nodiscard]]
+    msghdr const& header(std::size_t i) const { return msgs_[i].msg_hdr; }
+
+    [[nodiscard]]
+    unsigned length(std::size_t i) const { return msgs_[i].msg_len; }
+
+    /*!
+     * @return the contiguous data of the packet received into the slot \p i
+     */
+    [[nodiscard]]
+    uint8_t const* data(std::size_t i) { return arena_.data(i, msgs_[i].msg_len); }
+
+    [[nodiscard]]
+    sockaddr_in const& sender(std::size_t i) const { return senders_[i]; }
+
+    [[nodiscard]]
+    RxArena const& arena() const { return arena_; }
+
+private:
+    std::vector<PacketInfo> slots_;
+    std::vector<mmsghdr> msgs_;
+    RxArena arena_;
+    std::vector<sockaddr_in> senders_;
+    std::vector<uint8_t> cmsgBufs_;
+};
+
+#endif
+
+} // namespace pimc
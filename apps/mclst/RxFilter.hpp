@@ -0,0 +1,156 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "pimc/system/SysError.hpp"
+#include "pimc/packets/UDPHdrView.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+#include "Config.hpp"
+#include "OutputHandler.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief A classic BPF program which accepts only the packets matching
+ * the portless subscriptions.
+ *
+ * The program is attached to the sockets which receive the packets
+ * starting with the IPv4 header, i.e. the raw IP sockets and the
+ * `SOCK_DGRAM` packet sockets. It accepts the UDP packets destined for
+ * the subscribed groups, sent by the source of the subscription if the
+ * subscription is source specific, and destined for the configured range
+ * of the UDP ports. The rest of the packets are dropped in the kernel
+ * before they are queued to the socket.
+ *
+ * The groups are matched one by one, so the size of the program is
+ * linear in the number of the subscriptions. If the program exceeds the
+ * maximum size accepted by the kernel, it is not built and the packets
+ * are only filtered in the user space.
+ */
+class RxFilter final {
+public:
+    explicit RxFilter(Config const& cfg) {
+        auto subs = cfg.subscriptions();
+        std::sort(subs.begin(), subs.end(), [] (auto const& lhs, auto const& rhs) {
+            return lhs.group < rhs.group;
+        });
+
+        // ldb [9]: accept only UDP
+        stmt(BPF_LD | BPF_B | BPF_ABS, ProtocolOff);
+        jump(BPF_JMP | BPF_JEQ | BPF_K, UDPProto, 1, 0);
+        drop();
+
+        // ld [16]: the group branches follow one after another, each one
+        // jumping to the block matching the source of the subscription
+        stmt(BPF_LD | BPF_W | BPF_ABS, DaddrOff);
+        std::vector<std::size_t> groupJumps;
+        for (auto const& sub: subs) {
+            jump(BPF_JMP | BPF_JEQ | BPF_K, sub.group.value(), 0, 1);
+            groupJumps.push_back(prog_.size());
+            stmt(BPF_JMP | BPF_JA, 0);
+        }
+        drop();
+
+        std::vector<std::size_t> portsJumps;
+        for (std::size_t i = 0; i < subs.size(); ++i) {
+            auto const& sub = subs[i];
+            if (sub.sources.empty()) {
+                // The group jumps straight to the ports check
+                portsJumps.push_back(groupJumps[i]);
+                continue;
+            }
+
+            target(groupJumps[i]);
+            stmt(BPF_LD | BPF_W | BPF_ABS, SaddrOff);
+            for (auto source: sub.sources) {
+                jump(BPF_JMP | BPF_JEQ | BPF_K, source.value(), 0, 1);
+                portsJumps.push_back(prog_.size());
+                stmt(BPF_JMP | BPF_JA, 0);
+            }
+            drop();
+        }
+
+        for (auto pj: portsJumps)
+            target(pj);
+
+        auto dports = cfg.dports();
+        if (not dports.all()) {
+            // ldxb 4*([0]&0xf); ldh [x+2]: the UDP destination port
+            stmt(BPF_LDX | BPF_B | BPF_MSH, 0);
+            stmt(BPF_LD | BPF_H | BPF_IND, UDPDportOff);
+            jump(BPF_JMP | BPF_JGE | BPF_K, dports.first, 0, 2);
+            jump(BPF_JMP | BPF_JGT | BPF_K, dports.last, 1, 0);
+        }
+        stmt(BPF_RET | BPF_K, AcceptAll);
+        drop();
+
+        if (prog_.size() > BPF_MAXINSNS)
+            prog_.clear();
+    }
+
+    /*!
+     * \brief Attaches the program to the socket \p fd. If the program
+     * cannot be attached, a warning is shown and the packets are only
+     * filtered in the user space.
+     *
+     * @param fd the socket
+     * @param oh the output handler used to show the warning
+     */
+    void attach(int fd, OutputHandler& oh) const {
+        if (prog_.empty()) {
+            oh.warning(
+                    "too many subscriptions for the packet filter, filtering "
+                    "the traffic in the user space\n");
+            return;
+        }
+
+        sock_fprog fprog{
+            .len = static_cast<unsigned short>(prog_.size()),
+            .filter = prog_.data()
+        };
+        if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) == -1)
+            oh.warning(
+                    "unable to attach the packet filter, filtering the "
+                    "traffic in the user space: {}\n", SysError{});
+    }
+
+private:
+    void stmt(uint16_t code, uint32_t k) {
+        prog_.push_back(sock_filter{.code = code, .jt = 0, .jf = 0, .k = k});
+    }
+
+    void jump(uint16_t code, uint32_t k, uint8_t jt, uint8_t jf) {
+        prog_.push_back(sock_filter{.code = code, .jt = jt, .jf = jf, .k = k});
+    }
+
+    void drop() { stmt(BPF_RET | BPF_K, 0); }
+
+    /*!
+     * Points the `ja` instruction at \p pc to the next instruction
+     */
+    void target(std::size_t pc) {
+        prog_[pc].k = static_cast<uint32_t>(prog_.size() - pc - 1);
+    }
+
+private:
+    static constexpr uint32_t ProtocolOff{9};
+    static constexpr uint32_t SaddrOff{12};
+    static constexpr uint32_t DaddrOff{16};
+    static constexpr uint32_t UDPDportOff{2};
+    static constexpr uint32_t AcceptAll{0xffffffffu};
+
+    // The kernel takes a non-const pointer to the program
+    mutable std::vector<sock_filter> prog_;
+};
+
+} // namespace pimc
+
+#endif
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <sys/resource.h>
+
+#include <algorithm>
 #include <cstdint>
 #include <concepts>
 #include <functional>
 #include <unordered_map>
 #include <set>
+#include <vector>
 
 #include "pimc/core/CompilerUtils.hpp"
 #include "pimc/net/IPv4Address.hpp"
@@ -12,29 +16,36 @@
 
 namespace pimc {
 
-PIMC_ALWAYS_INLINE
-static constexpr uint64_t flowId(
-        IPv4Address src, uint16_t sport, uint16_t dport) {
-    return (static_cast<uint64_t>(dport) << 48u) +
-           (static_cast<uint64_t>(src.value()) << 16u) +
-           static_cast<uint64_t>(sport);
-}
-
-PIMC_ALWAYS_INLINE
-static constexpr IPv4Address flowSource(uint64_t flowId) {
-return IPv4Address{
-static_cast<uint32_t>((flowId >> 16u) & 0xFFFFFFFFul)};
-}
-
-PIMC_ALWAYS_INLINE
-static constexpr uint16_t flowSPort(uint64_t flowId) {
-return static_cast<uint16_t>(flowId & 0xFFFFu);
-}
-
-PIMC_ALWAYS_INLINE
-static constexpr uint16_t flowDPort(uint64_t flowId) {
-return static_cast<uint16_t>((flowId >> 48u) & 0xFFFFu);
-}
+/*!
+ * The key of a received flow: the destination group, the source
+ * and the source and destination UDP ports.
+ */
+struct FlowKey final {
+    IPv4Address group;
+    IPv4Address source;
+    uint16_t sport;
+    uint16_t dport;
+
+    constexpr bool operator== (FlowKey const&) const = default;
+
+    constexpr bool operator< (FlowKey const& rhs) const {
+        if (group != rhs.group) return group < rhs.group;
+        if (source != rhs.source) return source < rhs.source;
+        if (dport != rhs.dport) return dport < rhs.dport;
+        return sport < rhs.sport;
+    }
+};
+
+struct FlowKeyHash final {
+    PIMC_ALWAYS_INLINE
+    std::size_t operator() (FlowKey const& fk) const noexcept {
+        auto v = (static_cast<uint64_t>(fk.source.value()) << 32u) |
+                 (static_cast<uint64_t>(fk.dport) << 16u) |
+                 static_cast<uint64_t>(fk.sport);
+        v ^= static_cast<uint64_t>(fk.group.value()) * 0x9E3779B97F4A7C15ul;
+        return std::hash<uint64_t>{}(v);
+    }
+};
 
 class FlowStats final {
     constexpr static uint64_t withHeaders(uint64_t udpBytes) {
@@ -54,6 +65,134 @@ public:
         bytes_ += withHeaders(udpBytes);
     }
 
+    /*!
+     * \brief Accounts for the sequence number of a packet of the flow.
+     *
+     * The sequence numbers are tracked within a window of the last 64
+     * ones, so a packet which arrives late within the window fills the
+     * gap it has left rather than being counted as a duplicate. A packet
+     * older than the window cannot be told from a duplicate, so it is
+     * counted as reordered and its gap remains lost.
+     *
+     * The sender is taken to have restarted if the sequence number jumps
+     * back by RestartDistance or more, or if RestartRun consecutive
+     * sequence numbers arrive behind the last one, which a stray late or
+     * duplicated packet never does. The packets of such a run are then no
+     * longer counted as duplicates or reordered, and the tracking starts
+     * over from the first of them.
+     */
+    void sequence(uint64_t seq) {
+        if (PIMC_UNLIKELY(seqs_++ == 0)) {
+            restartSeq(seq);
+            return;
+        }
+
+        if (PIMC_LIKELY(seq > lastSeq_)) {
+            auto d = seq - lastSeq_;
+            lost_ += d - 1;
+            seqWindow_ = d >= SeqWindow ? 1 : (seqWindow_ << d) | 1;
+            lastSeq_ = seq;
+            run_.len = 0;
+            return;
+        }
+
+        auto d = lastSeq_ - seq;
+        if (PIMC_UNLIKELY(d >= RestartDistance)) {
+            ++restarts_;
+            restartSeq(seq);
+            return;
+        }
+
+        if (d >= SeqWindow or seq < firstSeq_) {
+            ++reordered_;
+            behind(seq, false);
+            return;
+        }
+
+        auto bit = uint64_t{1} << d;
+        if (seqWindow_ & bit) {
+            ++duplicates_;
+            behind(seq, true);
+            return;
+        }
+
+        // A late packet which fills its gap is not a part of a restart
+        seqWindow_ |= bit;
+        ++reordered_;
+        --lost_;
+        run_.len = 0;
+    }
+
+    /*!
+     * \brief Accounts for a packet whose CRC32C has been verified.
+     */
+    void verified(bool intact) {
+        ++verified_;
+        if (not intact) ++corrupt_;
+    }
+
+    /*!
+     * \brief Saves the TTL \p ttl of a packet of the flow received on the
+     * A or B \p line, unless it is unknown. The lines are compared
+     * separately, as they may reach the host over a different number of
+     * hops.
+     *
+     * @return true if the TTL differs from the one of the previous packet
+     * received on the same line
+     */
+    bool ttlChanged(int16_t ttl, unsigned line) {
+        if (ttl < 0) return false;
+
+        auto prev = ttl_[line];
+        ttl_[line] = ttl;
+        return prev != -1 and ttl != prev;
+    }
+
+    /*!
+     * \brief Saves the time \p ns when the last packet of the flow has
+     * arrived, see SilenceWheel.
+     */
+    void heard(uint64_t ns) { lastHeard_ = ns; }
+
+    /*!
+     * \brief Marks the flow silent.
+     */
+    void silenced() { silent_ = true; }
+
+    /*!
+     * \brief Accounts for an outage of the flow which lasted \p outageNs
+     * nanoseconds and has ended with the arrival of a packet.
+     */
+    void resumed(uint64_t outageNs) {
+        silent_ = false;
+        outage(outageNs);
+    }
+
+    /*!
+     * \brief Accounts for an outage of the flow which has lasted
+     * \p outageNs nanoseconds so far and has not ended.
+     */
+    void outage(uint64_t outageNs) {
+        ++outages_;
+        longestOutage_ = std::max(longestOutage_, outageNs);
+    }
+
+    void merge(FlowStats const& rhs) {
+        pkts_ += rhs.pkts_;
+        bytes_ += rhs.bytes_;
+        outages_ += rhs.outages_;
+        longestOutage_ = std::max(longestOutage_, rhs.longestOutage_);
+        silent_ = silent_ or rhs.silent_;
+        lastHeard_ = std::max(lastHeard_, rhs.lastHeard_);
+        verified_ += rhs.verified_;
+        corrupt_ += rhs.corrupt_;
+        seqs_ += rhs.seqs_;
+        lost_ += rhs.lost_;
+        duplicates_ += rhs.duplicates_;
+        reordered_ += rhs.reordered_;
+        restarts_ += rhs.restarts_;
+    }
+
     [[nodiscard]]
     uint64_t pkts() const { return pkts_; }
 
@@ -64,18 +203,183 @@ public:
     double aps() const {
         return static_cast<double>(bytes_) / static_cast<double>(pkts_); }
 
+    /*!
+     * @return the number of the packets which carry a sequence number
+     */
+    [[nodiscard]]
+    uint64_t seqs() const { return seqs_; }
+
+    /*!
+     * @return the number of the sequence numbers skipped and not received
+     * later within the window
+     */
+    [[nodiscard]]
+    uint64_t lost() const { return lost_; }
+
+    [[nodiscard]]
+    uint64_t duplicates() const { return duplicates_; }
+
+    /*!
+     * @return the number of the packets received after a packet with a
+     * higher sequence number
+     */
+    [[nodiscard]]
+    uint64_t reordered() const { return reordered_; }
+
+    /*!
+     * @return the number of the times the sequence numbers have restarted
+     */
+    [[nodiscard]]
+    uint64_t restarts() const { return restarts_; }
+
+    /*!
+     * @return the number of the packets whose CRC32C has been verified
+     */
+    [[nodiscard]]
+    uint64_t verified() const { return verified_; }
+
+    /*!
+     * @return the number of the packets whose CRC32C did not match
+     */
+    [[nodiscard]]
+    uint64_t corrupt() const { return corrupt_; }
+
+    /*!
+     * @return the host time in nanoseconds when the last packet of the
+     * flow has arrived, or 0 if the silence of the flows is not tracked
+     */
+    [[nodiscard]]
+    uint64_t lastHeard() const { return lastHeard_; }
+
+    /*!
+     * @return true if the flow has received no packets since it has been
+     * reported silent
+     */
+    [[nodiscard]]
+    bool silent() const { return silent_; }
+
+    /*!
+     * @return the number of the times the flow has gone silent
+     */
+    [[nodiscard]]
+    uint64_t outages() const { return outages_; }
+
+    /*!
+     * @return the length of the longest outage of the flow in nanoseconds
+     */
+    [[nodiscard]]
+    uint64_t longestOutage() const { return longestOutage_; }
+
+private:
+    static constexpr uint64_t SeqWindow{64};
+
+    /*!
+     * The distance by which the sequence number must jump back to be
+     * taken as a restart on its own.
+     */
+    static constexpr uint64_t RestartDistance{65536};
+
+    /*!
+     * The number of the consecutive sequence numbers behind the last one
+     * which are taken as a restart.
+     */
+    static constexpr unsigned RestartRun{8};
+
+    /*!
+     * The consecutive sequence numbers received behind the last one and
+     * how they have been counted so far.
+     */
+    struct SeqRun final {
+        uint64_t first;
+        uint64_t next;
+        unsigned len;
+        unsigned duplicates;
+    };
+
+    void restartSeq(uint64_t seq) {
+        firstSeq_ = seq;
+        lastSeq_ = seq;
+        seqWindow_ = 1;
+        run_.len = 0;
+    }
+
+    /*!
+     * \brief Accounts for the sequence number \p seq behind the last one,
+     * which has been counted as a duplicate if \p duplicate is true and
+     * as reordered otherwise, and restarts the tracking once the run of
+     * such sequence numbers is long enough.
+     */
+    void behind(uint64_t seq, bool duplicate) {
+        if (run_.len == 0 or seq != run_.next)
+            run_ = SeqRun{.first = seq, .next = seq, .len = 0, .duplicates = 0};
+
+        ++run_.next;
+        ++run_.len;
+        if (duplicate) ++run_.duplicates;
+
+        if (PIMC_LIKELY(run_.len < RestartRun)) return;
+
+        duplicates_ -= run_.duplicates;
+        reordered_ -= run_.len - run_.duplicates;
+        ++restarts_;
+        firstSeq_ = run_.first;
+        lastSeq_ = seq;
+        seqWindow_ = (uint64_t{1} << RestartRun) - 1;
+        run_.len = 0;
+    }
+
 private:
     uint64_t pkts_;
     uint64_t bytes_;
+    uint64_t seqs_{0};
+    uint64_t lost_{0};
+    uint64_t duplicates_{0};
+    uint64_t reordered_{0};
+    uint64_t restarts_{0};
+    uint64_t verified_{0};
+    uint64_t corrupt_{0};
+    uint64_t lastHeard_{0};
+    uint64_t outages_{0};
+    uint64_t longestOutage_{0};
+    bool silent_{false};
+    // The TTL of the last packet of each line or -1 if it is not known yet
+    int16_t ttl_[2]{-1, -1};
+    uint64_t firstSeq_{0};
+    uint64_t lastSeq_{0};
+    // The bit i is set if the sequence number lastSeq_ - i has been received
+    uint64_t seqWindow_{0};
+    SeqRun run_{.first = 0, .next = 0, .len = 0, .duplicates = 0};
+};
+
+/*!
+ * The kernel accounting of a receiving socket: the packets which the
+ * kernel has dropped because the socket receive queue was full and the
+ * peak memory taken by the queue.
+ */
+struct SocketStats final {
+    uint16_t dport;
+    // The number of the subscriptions joined on the socket
+    std::size_t subs;
+    uint64_t drops;
+    // The peak number of bytes taken by the queued packets
+    uint64_t peakQueue;
+    // The limit of the memory the queue may take
+    uint64_t rcvbuf;
 };
 
 class RxStats final {
 public:
+    /*!
+     * \brief Measures the duration of the receive and the CPU time used
+     * by the calling receive thread during it.
+     */
     class Timer final {
     public:
         explicit Timer(RxStats& rxStats)
                 : startNanos_{gethostnanos()}
-                , durationNanos_{rxStats.durationNanos_} {}
+                , rxStats_{rxStats} {
+            cpuNanos(startUserNanos_, startSysNanos_);
+        }
 
         Timer(Timer const&) = delete;
         Timer(Timer&&) = delete;
@@ -83,48 +387,128 @@ public:
         Timer& operator= (Timer&&) = delete;
 
         ~Timer() {
-            durationNanos_ = gethostnanos() - startNanos_;
+            rxStats_.durationNanos_ = gethostnanos() - startNanos_;
+
+            uint64_t userNanos, sysNanos;
+            cpuNanos(userNanos, sysNanos);
+            rxStats_.cpuUserNanos_ = userNanos - startUserNanos_;
+            rxStats_.cpuSysNanos_ = sysNanos - startSysNanos_;
         }
+    private:
+        static void cpuNanos(uint64_t& userNanos, uint64_t& sysNanos) {
+            rusage ru{};
+#ifdef __linux__
+            getrusage(RUSAGE_THREAD, &ru);
+#else
+            getrusage(RUSAGE_SELF, &ru);
+#endif
+            auto nanos = [] (timeval const& tv) {
+                return static_cast<uint64_t>(tv.tv_sec) * 1'000'000'000ul +
+                       static_cast<uint64_t>(tv.tv_usec) * 1'000ul;
+            };
+            userNanos = nanos(ru.ru_utime);
+            sysNanos = nanos(ru.ru_stime);
+        }
+
     private:
         uint64_t startNanos_;
-        uint64_t& durationNanos_;
+        uint64_t startUserNanos_{0};
+        uint64_t startSysNanos_{0};
+        RxStats& rxStats_;
     };
 
     friend class RxStats::Timer;
 
-    void update(IPv4Address source,
-                uint16_t sport, uint16_t dport, uint64_t udpBytes) {
-        auto fid = flowId(source, sport, dport);
+    /*!
+     * \brief Accounts for a received packet of the flow.
+     *
+     * @return the statistics of the flow
+     */
+    FlowStats& update(IPv4Address group, IPv4Address source,
+                      uint16_t sport, uint16_t dport, uint64_t udpBytes) {
+        FlowKey fk{.group = group, .source = source, .sport = sport, .dport = dport};
 
-        auto fme = fsMap_.emplace(fid, udpBytes);
+        auto fme = fsMap_.emplace(fk, udpBytes);
         if (not fme.second)
             fme.first->second.add(udpBytes);
-        else fids_.emplace(fid);
+        else fids_.emplace(fk);
+        return fme.first->second;
+    }
+
+    /*!
+     * \brief Merges the statistics collected by another receive thread
+     * into these statistics.
+     *
+     * The duration of the merged statistics is the longest of the two,
+     * whereas the CPU times are summed.
+     *
+     * @param rhs the statistics to merge
+     */
+    void merge(RxStats const& rhs) {
+        for (auto const& [fk, fs]: rhs.fsMap_) {
+            auto fme = fsMap_.emplace(fk, fs);
+            if (not fme.second)
+                fme.first->second.merge(fs);
+            else fids_.emplace(fk);
+        }
+
+        sockets_.insert(sockets_.end(), rhs.sockets_.begin(), rhs.sockets_.end());
+
+        durationNanos_ = std::max(durationNanos_, rhs.durationNanos_);
+        cpuUserNanos_ += rhs.cpuUserNanos_;
+        cpuSysNanos_ += rhs.cpuSysNanos_;
     }
 
     template <typename F>
     requires std::regular_invocable<
-            F, IPv4Address, uint16_t, uint16_t, FlowStats const&>
+            F, IPv4Address, IPv4Address, uint16_t, uint16_t, FlowStats const&>
     void forEach(F&& f) const {
-        for (const auto& fid: fids_) {
+        for (const auto& fk: fids_) {
             std::invoke(
                     std::forward<F>(f),
-                    flowSource(fid),
-                    flowSPort(fid), flowDPort(fid),
-                    fsMap_.find(fid)->second);
+                    fk.group, fk.source, fk.sport, fk.dport,
+                    fsMap_.find(fk)->second);
         }
     }
 
+    /*!
+     * \brief Invokes \p f with the key and the statistics of each flow in
+     * no particular order.
+     */
+    template <typename F>
+    requires std::invocable<F, FlowKey const&, FlowStats&>
+    void forEachFlow(F&& f) {
+        for (auto& [fk, fs]: fsMap_)
+            std::invoke(f, fk, fs);
+    }
+
+    void addSocket(SocketStats const& ss) { sockets_.push_back(ss); }
+
+    std::vector<SocketStats> const& sockets() const { return sockets_; }
+
     uint64_t durationNanos() const { return durationNanos_; }
 
+    /*!
+     * \brief Overrides the duration measured by the timer, e.g. with the
+     * time span of the packets read from a capture file.
+     */
+    void setDurationNanos(uint64_t durationNanos) { durationNanos_ = durationNanos; }
+
+    uint64_t cpuUserNanos() const { return cpuUserNanos_; }
+
+    uint64_t cpuSysNanos() const { return cpuSysNanos_; }
+
     std::size_t size() const { return fsMap_.size(); }
 
     explicit operator bool() const { return not fsMap_.empty(); }
 
 private:
-    std::unordered_map<uint64_t, FlowStats> fsMap_;
-    std::set<uint64_t> fids_;
-    uint64_t durationNanos_;
+    std::unordered_map<FlowKey, FlowStats, FlowKeyHash> fsMap_;
+    std::set<FlowKey> fids_;
+    std::vector<SocketStats> sockets_;
+    uint64_t durationNanos_{0};
+    uint64_t cpuUserNanos_{0};
+    uint64_t cpuSysNanos_{0};
 };
 
 } // namespace pimc
\ No newline at end of file
@@ -1,11 +1,13 @@
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
 #include <thread>
 #include <chrono>
 
 #include "pimc/core/Endian.hpp"
+#include "pimc/packets/Crc32c.hpp"
 #include "pimc/system/Exceptions.hpp"
 #include "pimc/system/SysError.hpp"
 #include "pimc/time/TimeUtils.hpp"
@@ -28,6 +30,16 @@ void Sender::init() {
     pkt_.hdr.dataLen = htobe16(static_cast<uint16_t>(msgLen));
     pktSize_ = sizeof(MclstBeaconHdr) + msgLen;
 
+    if (cfg_.fill() > 0) {
+        if (cfg_.fill() < pktSize_ + sizeof(uint32_t))
+            raise<std::runtime_error>(
+                    "payload size {} is too small for the beacon and its "
+                    "CRC32C, which take {} bytes",
+                    cfg_.fill(), pktSize_ + sizeof(uint32_t));
+        pkt_.hdr.magic = htobe64(MclstCrcMagic);
+        filled_.resize(cfg_.fill());
+    }
+
     socket_ = socket(AF_INET, SOCK_DGRAM, 0);
     if (socket_ == -1)
         raise<std::runtime_error>("unable to create socket: {}", SysError{});
@@ -52,27 +64,162 @@ void Sender::init() {
                 cfg_.intf(), cfg_.intfAddr(), SysError{});
 }
 
+void Sender::initRtt() {
+    auto const& rtt = cfg_.rtt();
+    sentAt_.resize(RttWindow);
+
+    rttSocket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (rttSocket_ == -1)
+        raise<std::runtime_error>("unable to create socket: {}", SysError{});
+
+    int flags = fcntl(rttSocket_, F_GETFL);
+    if (flags == -1 or fcntl(rttSocket_, F_SETFL, flags | O_NONBLOCK) == -1)
+        raise<std::runtime_error>(
+                "fcntl() failed to make socket non-blocking: {}", SysError{});
+
+    int allowReuse = 1;
+    if (setsockopt(rttSocket_, SOL_SOCKET, SO_REUSEADDR,
+                   &allowReuse, sizeof(allowReuse)) == -1)
+        raise<std::runtime_error>("cannot enable UDP port reuse: {}", SysError{});
+
+    // Binding to the group only receives the traffic destined for it
+    sockaddr_in src{};
+    src.sin_family = AF_INET;
+    src.sin_port = htons(rtt.dport);
+    src.sin_addr.s_addr = rtt.group.to_nl();
+    if (bind(rttSocket_, reinterpret_cast<sockaddr*>(&src), sizeof(src)) == -1)
+        raise<std::runtime_error>(
+                "unable to bind to {}:{}: {}", rtt.group, rtt.dport, SysError{});
+
+    ip_mreq mreq{};
+    mreq.imr_multiaddr.s_addr = rtt.group.to_nl();
+    mreq.imr_interface.s_addr = cfg_.intfAddr().to_nl();
+    if (setsockopt(rttSocket_, IPPROTO_IP,
+                   IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1)
+        raise<std::runtime_error>(
+                "unable to join {} on {} ({}): {}",
+                rtt.group, cfg_.intf(), cfg_.intfAddr(), SysError{});
+}
+
+void Sender::applyControls(char const* progname, RtControls& controls) {
+#ifdef __linux__
+    if (not cfg_.cpus().empty())
+        controls.push_back(pinThread("CPU affinity", cfg_.cpus()[0]));
+
+    if (cfg_.fifo() > 0)
+        controls.push_back(setFifo("SCHED_FIFO", cfg_.fifo(), progname));
+#else
+    (void)progname;
+    (void)controls;
+#endif
+
+    if (cfg_.mlock()) prefaultStack();
+}
+
 void Sender::sendLoop() {
     sockaddr_in dst{};
     dst.sin_family = AF_INET;
     dst.sin_port = htons(cfg_.dport());
     dst.sin_addr.s_addr = cfg_.group().to_nl();
 
+    Poller poller;
+    if (rttSocket_ != -1)
+        poller.add(rttSocket_, 0);
+
     while (not stopped_) {
-        pkt_.hdr.timeNs = htobe64(gethostnanos());
+        auto timeNs = gethostnanos();
+        pkt_.hdr.timeNs = htobe64(timeNs);
         pkt_.hdr.seq = htobe64(seq_);
-        if (sendto(socket_, &pkt_, pktSize_, 0,
+        void const* data = &pkt_;
+        auto size = pktSize_;
+        if (not filled_.empty()) {
+            fill();
+            data = filled_.data();
+            size = filled_.size();
+        }
+
+        if (sendto(socket_, data, size, 0,
                    reinterpret_cast<sockaddr*>(&dst), sizeof(dst)) == -1)
             raise<std::runtime_error>(
                     "failed to send packet to {}:{}: {}",
                     cfg_.group(), cfg_.dport(), SysError{});
 
+        if (rttSocket_ != -1)
+            sentAt_[seq_ % RttWindow] = timeNs;
+
         oh_.showSentPacket(gethostnanos(), seq_);
         ++seq_;
 
-        if (cfg_.count() != 0 && seq_ >= cfg_.count()) return;
+        bool last = cfg_.count() != 0 && seq_ >= cfg_.count();
+        // The reflections of the last beacon are waited for as well
+        if (rttSocket_ != -1)
+            waitReflections(poller, timeNs + NanosInSecond);
+        else if (not last)
+            std::this_thread::sleep_for(1s);
+
+        if (last) return;
+    }
+}
+
+void Sender::fill() {
+    memcpy(filled_.data(), &pkt_, pktSize_);
+
+    // A ramp starting from the sequence number, so that the corrupted
+    // bytes stand out in the hex dump
+    auto crcOffset = filled_.size() - sizeof(uint32_t);
+    for (auto i = pktSize_; i < crcOffset; ++i)
+        filled_[i] = static_cast<uint8_t>(seq_ + i);
+
+    auto crc = htobe32(crc32c(filled_.data(), crcOffset));
+    memcpy(filled_.data() + crcOffset, &crc, sizeof(crc));
+}
+
+void Sender::waitReflections(Poller& poller, uint64_t deadline) {
+    for (auto now = gethostnanos(); now < deadline and not stopped_; now = gethostnanos()) {
+        // Round up, so the poller does not return just before the deadline
+        auto waitMs = static_cast<unsigned>((deadline - now + 999'999) / 1'000'000);
+        int rc = poller.wait(waitMs);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+
+            raise<std::runtime_error>("poller failed: {}", SysError{});
+        }
+
+        if (rc > 0) receiveReflections();
+    }
+}
 
-        std::this_thread::sleep_for(1s);
+void Sender::receiveReflections() {
+    for (;;) {
+        sockaddr_in reflector{};
+        socklen_t reflectorLen = sizeof(reflector);
+        auto rsz = recvfrom(
+                rttSocket_, &rttPkt_, sizeof(rttPkt_), 0,
+                reinterpret_cast<sockaddr*>(&reflector), &reflectorLen);
+        auto now = gethostnanos();
+
+        if (rsz < 0) {
+            if (errno == EAGAIN or errno == EINTR) return;
+
+            raise<std::runtime_error>("recvfrom() failed: {}", SysError{});
+        }
+
+        auto magic = be64toh(rttPkt_.hdr.magic);
+        if (static_cast<size_t>(rsz) < sizeof(MclstBeaconHdr) or
+            (magic != MclstMagic and magic != MclstCrcMagic))
+            continue;
+
+        // Only the reflections of the own beacons which are still in the
+        // window are matched, as the return group may be shared
+        auto seq = be64toh(rttPkt_.hdr.seq);
+        auto timeNs = be64toh(rttPkt_.hdr.timeNs);
+        if (seq >= seq_ or seq_ - seq > RttWindow or sentAt_[seq % RttWindow] != timeNs)
+            continue;
+
+        auto rtt = now - timeNs;
+        auto source = IPv4Address::from_nl(reflector.sin_addr.s_addr);
+        rttStats_.reflectors[source].record(rtt);
+        oh_.showReflection(now, source, seq, rtt);
     }
 }
 
@@ -1,34 +1,95 @@
 #pragma once
 
+#include <vector>
+
 #include "MclstBase.hpp"
+#include "Poller.hpp"
+#include "Reflector.hpp"
+#include "RtControls.hpp"
 
 namespace pimc {
 
 class Sender final: private MclstBase {
 public:
-    constexpr Sender(Config const& cfg, OutputHandler& oh, bool& stopped)
-    : MclstBase{cfg, oh, stopped}, seq_{0} {}
+    Sender(Config const& cfg, OutputHandler& oh, bool& stopped)
+    : MclstBase{cfg, oh, stopped}, seq_{0}, rttSocket_{-1} {}
+
+    ~Sender() { closeSocket(rttSocket_); }
 
-    void run() {
+    void run(char const* progname) {
+        // The buffers are allocated after the memory is locked
+        RtControls controls;
+#ifdef __linux__
+        if (cfg_.mlock()) controls.push_back(lockMemory(progname));
+#endif
         init();
+        if (cfg_.rtt()) initRtt();
+        applyControls(progname, controls);
+        if (not controls.empty()) oh_.showRtControls(controls);
         sendLoop();
         oh_.showTxStats(seq_+1, stopped_);
+        if (cfg_.rtt()) oh_.showRttStats(rttStats_);
     }
 
 private:
     void init();
 
+    /*!
+     * \brief Joins the group on which the reflections of the beacons are
+     * received.
+     */
+    void initRtt();
+
+    /*!
+     * \brief Pins the sending thread to its CPU, sets its scheduling
+     * policy and prefaults its stack.
+     */
+    void applyControls(char const* progname, RtControls& controls);
+
     void sendLoop();
+
+    /*!
+     * \brief Receives the reflections of the beacons until the host time
+     * \p deadline in nanoseconds.
+     */
+    void waitReflections(Poller& poller, uint64_t deadline);
+
+    /*!
+     * \brief Receives the reflections queued on the socket and measures
+     * the round trip time of each of them.
+     */
+    void receiveReflections();
+
+    /*!
+     * \brief Copies the beacon into the padded packet, fills the padding
+     * with the pattern of the sequence number and ends the packet with
+     * the CRC32C of the rest of it.
+     */
+    void fill();
 private:
     struct MclstBeaconPacket  {
         MclstBeaconHdr hdr;
         char message[1024];
     } __attribute__((__aligned__(1), __packed__));
 
+    /*!
+     * The number of the last beacons whose send times are kept to match
+     * their reflections.
+     */
+    static constexpr uint64_t RttWindow{1024};
+
 private:
     MclstBeaconPacket pkt_;
     uint64_t seq_;
     size_t pktSize_;
+    // The beacon padded to the configured size, empty if not padded
+    std::vector<uint8_t> filled_;
+    int rttSocket_;
+    // The receive buffer of the reflections
+    MclstBeaconPacket rttPkt_;
+    // The send times of the last beacons indexed by the sequence number
+    std::vector<uint64_t> sentAt_;
+    RttStats rttStats_;
 };
 
 
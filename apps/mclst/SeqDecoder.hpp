@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/core/Endian.hpp"
+
+#include "Config.hpp"
+#include "PacketInfo.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief Extracts the sequence number of a received packet, either that
+ * of the mclst beacon or that of the configured field of the UDP payload.
+ *
+ * The size, the byte order and whether the magic bytes are checked are
+ * known at startup, so the extraction is specialized for each of their
+ * combinations and the specialization is selected once. Extracting the
+ * sequence number of a packet then takes a single load and a byte swap,
+ * plus the comparison of the magic bytes if configured.
+ */
+class SeqDecoder final {
+public:
+    explicit SeqDecoder(SeqField const& sf): sf_{sf}, decode_{select(sf)} {}
+
+    /*!
+     * \brief Extracts the sequence number of the packet.
+     *
+     * @param pktInfo the dissected packet
+     * @param seq the sequence number of the packet
+     * @return false if the packet carries no sequence number
+     */
+    PIMC_ALWAYS_INLINE
+    bool decode(PacketInfo const& pktInfo, uint64_t& seq) const {
+        return decode_(sf_, pktInfo, seq);
+    }
+
+private:
+    using DecodeFn = bool (*)(SeqField const&, PacketInfo const&, uint64_t&);
+
+    static bool decodeBeacon(SeqField const&, PacketInfo const& pktInfo, uint64_t& seq) {
+        seq = pktInfo.remoteSeq;
+        return pktInfo.mclstBeacon;
+    }
+
+    template <unsigned Size, bool LittleEndian>
+    PIMC_ALWAYS_INLINE
+    static uint64_t load(uint8_t const* p) {
+        if constexpr (Size == 1) {
+            return *p;
+        } else if constexpr (Size == 2) {
+            uint16_t v;
+            memcpy(&v, p, sizeof(v));
+            return LittleEndian ? le16toh(v) : be16toh(v);
+        } else if constexpr (Size == 4) {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return LittleEndian ? le32toh(v) : be32toh(v);
+        } else {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            return LittleEndian ? le64toh(v) : be64toh(v);
+        }
+    }
+
+    template <unsigned Size, bool LittleEndian, bool Magic>
+    static bool decodeField(SeqField const& sf, PacketInfo const& pktInfo, uint64_t& seq) {
+        auto const* payload = pktInfo.payload();
+        if constexpr (Magic) {
+            if (pktInfo.payloadSize < sf.magicOffset + sf.magicSize or
+                memcmp(payload + sf.magicOffset, sf.magic.data(), sf.magicSize) != 0)
+                return false;
+        }
+
+        if (PIMC_UNLIKELY(pktInfo.payloadSize < sf.offset + Size))
+            return false;
+
+        seq = load<Size, LittleEndian>(payload + sf.offset);
+        return true;
+    }
+
+    template <unsigned Size>
+    static DecodeFn select(bool littleEndian, bool magic) {
+        if (littleEndian)
+            return magic ? decodeField<Size, true, true> : decodeField<Size, true, false>;
+        return magic ? decodeField<Size, false, true> : decodeField<Size, false, false>;
+    }
+
+    static DecodeFn select(SeqField const& sf) {
+        bool magic = sf.magicSize > 0;
+        switch (sf.size) {
+        case 0:
+            return decodeBeacon;
+        case 1:
+            // A single byte has no byte order
+            return select<1>(false, magic);
+        case 2:
+            return select<2>(sf.littleEndian, magic);
+        case 4:
+            return select<4>(sf.littleEndian, magic);
+        default:
+            return select<8>(sf.littleEndian, magic);
+        }
+    }
+
+private:
+    SeqField sf_;
+    DecodeFn decode_;
+};
+
+} // namespace pimc
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+
+#include "RxStats.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief Detects the flows which have received no packets for longer
+ * than the silence threshold with a hashed timing wheel.
+ *
+ * Each flow is placed in the slot of the tick by which it goes silent
+ * unless another packet arrives. A packet only saves its arrival time in
+ * the flow, whereas the flow is moved to the slot of its new deadline
+ * lazily, once the wheel reaches its old slot. Each tick thus visits a
+ * single slot and only the flows placed in it, however many flows are
+ * tracked. The silent flows leave the wheel until their next packet, so
+ * the wheel holds at most one entry per flow, and the flows which are
+ * still silent when the receive ends are found in the flow statistics.
+ *
+ * The ticks are an eighth of the threshold long, so a flow is reported
+ * at most an eighth of the threshold late. The wheel spans 32 thresholds,
+ * so each slot only holds the flows due within its current round.
+ */
+class SilenceWheel final {
+    struct Entry {
+        FlowKey key;
+        FlowStats* fs;
+    };
+
+public:
+    SilenceWheel(uint64_t thresholdNs, uint64_t nowNs)
+    : thresholdNs_{thresholdNs}
+    , tickNs_{std::max<uint64_t>(thresholdNs / 8, 1'000'000)}
+    , nextTick_{nowNs / tickNs_ + 1}
+    , slots_(Slots) {}
+
+    /*!
+     * \brief Accounts for a packet of the flow \p fk which has arrived at
+     * \p ns and starts tracking the flow on its first packet.
+     *
+     * @param resumed the callable taking the flow key and the length of
+     * the outage in nanoseconds, which is invoked if the flow was silent
+     */
+    template <typename F>
+    PIMC_ALWAYS_INLINE
+    void onPacket(FlowKey const& fk, FlowStats& fs, uint64_t ns, F&& resumed) {
+        auto last = fs.lastHeard();
+        fs.heard(ns);
+
+        if (PIMC_LIKELY(last != 0 and not fs.silent())) return;
+
+        if (last != 0) {
+            auto outageNs = ns > last ? ns - last : 0;
+            fs.resumed(outageNs);
+            resumed(fk, outageNs);
+        }
+        schedule(Entry{.key = fk, .fs = &fs}, ns + thresholdNs_);
+    }
+
+    /*!
+     * \brief Visits the slots of the ticks which have passed by \p nowNs
+     * and marks the flows which have gone silent.
+     *
+     * @param silent the callable taking the flow key and the time in
+     * nanoseconds since the last packet of the flow, which is invoked for
+     * each flow which has gone silent
+     */
+    template <typename F>
+    void advance(uint64_t nowNs, F&& silent) {
+        auto nowTick = nowNs / tickNs_;
+        // Each slot is visited once at most, as the flows due in the
+        // skipped ticks are all found in the slots visited anyway
+        if (nowTick >= nextTick_ + Slots)
+            nextTick_ = nowTick - Slots + 1;
+
+        for (; nextTick_ <= nowTick; ++nextTick_) {
+            auto tickNs = nextTick_ * tickNs_;
+            auto& slot = slots_[nextTick_ % Slots];
+            std::size_t kept{0};
+            for (auto const& e: slot) {
+                auto dueNs = e.fs->lastHeard() + thresholdNs_;
+                if (dueNs <= tickNs) {
+                    e.fs->silenced();
+                    silent(e.key, nowNs - e.fs->lastHeard());
+                    continue;
+                }
+
+                auto dueTick = (dueNs + tickNs_ - 1) / tickNs_;
+                if (dueTick % Slots == nextTick_ % Slots) slot[kept++] = e;
+                else slots_[dueTick % Slots].push_back(e);
+            }
+            slot.resize(kept);
+        }
+    }
+
+    /*!
+     * @return the host time in nanoseconds of the next tick
+     */
+    [[nodiscard]]
+    uint64_t deadline() const { return nextTick_ * tickNs_; }
+
+    /*!
+     * \brief Accounts for the outages of the flows in \p rxStats which
+     * are silent when the receive ends at \p nowNs.
+     */
+    void finish(RxStats& rxStats, uint64_t nowNs) {
+        rxStats.forEachFlow([nowNs] (FlowKey const&, FlowStats& fs) {
+            if (fs.silent())
+                fs.outage(nowNs - fs.lastHeard());
+        });
+    }
+
+private:
+    void schedule(Entry const& e, uint64_t dueNs) {
+        // A packet timestamped before the last tick is due in the next one
+        auto dueTick = std::max((dueNs + tickNs_ - 1) / tickNs_, nextTick_);
+        slots_[dueTick % Slots].push_back(e);
+    }
+
+private:
+    static constexpr uint64_t Slots{256};
+
+    uint64_t thresholdNs_;
+    uint64_t tickNs_;
+    // The next tick whose slot is visited
+    uint64_t nextTick_;
+    std::vector<std::vector<Entry>> slots_;
+};
+
+} // namespace pimc
@@ -33,6 +33,12 @@ public:
      */
     void save() { timestampNs_ = gethostnanos(); }
 
+    /*!
+     * This function saves the time \p ns in place of the host time, so
+     * that the capture time of the replayed packets is reported instead.
+     */
+    void save(uint64_t ns) { timestampNs_ = ns; }
+
     /*!
      * This function should be called after receiving a packet of interest
      * or right after reporting the timeout.
@@ -0,0 +1,379 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <linux/io_uring.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+#include "MappedBuffer.hpp"
+#include "PacketInfo.hpp"
+#include "RxBatch.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief Receives the packets from multiple sockets using an `io_uring`
+ * instance with multishot `IORING_OP_RECVMSG` requests and a ring of
+ * provided buffers.
+ *
+ * A single request per socket keeps producing completions, each of which
+ * refers to a buffer picked by the kernel from the provided buffer ring,
+ * so the packets keep arriving without resubmitting the requests and
+ * without a system call per packet. The packets are processed in place
+ * in the buffers, which are returned to the buffer ring afterwards.
+ *
+ * The buffers are sized for the largest datagram expected, e.g. for the
+ * standard MTU, so that enough of them fit in a small prefaulted mapping
+ * to absorb the bursts between the drains. A datagram which does not fit
+ * in a buffer is truncated and reported as such.
+ *
+ * The instance is created disabled and is enabled by the thread which
+ * then becomes its only submitter. The `io_uring` file descriptor becomes
+ * readable when there are completions, so it can be watched by a Poller.
+ *
+ * The `io_uring` system calls are used directly, `liburing` is not
+ * required. The constructor throws `std::runtime_error` if the kernel
+ * does not support the features needed, i.e. if it is older than 6.0.
+ */
+class UringRx final {
+public:
+    /*!
+     * \brief A packet received in a provided buffer.
+     */
+    struct Completion final {
+        // The ID of the socket passed to recv()
+        uint32_t id;
+        sockaddr_in const* sender;
+        // The header describing the control messages of the packet
+        msghdr const* hdr;
+        uint8_t const* data;
+        unsigned size;
+        // True if the datagram did not fit in the buffer
+        bool truncated;
+    };
+
+    /*!
+     * @param buffers the number of the provided buffers, a power of 2
+     * @param payloadSize the largest datagram the buffers accommodate
+     * @param hugePages true if the buffers are backed by the huge pages
+     * @param node the NUMA node on which the buffers are allocated or -1
+     */
+    UringRx(unsigned buffers, std::size_t payloadSize, bool hugePages, int node)
+    : fd_{-1}
+    , bufferCount_{buffers}
+    , payloadSize_{static_cast<unsigned>(payloadSize)}
+    , bufferSize_{alignedSize(
+            sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) +
+            CmsgBufferSize + payloadSize)}
+    , buffers_{std::size_t{buffers} * bufferSize_, hugePages, node} {
+        io_uring_params params{};
+        // SINGLE_ISSUER is only supported since 6.0, which is also the
+        // first version to support the multishot recvmsg
+        params.flags =
+                IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_R_DISABLED |
+                IORING_SETUP_CQSIZE;
+        // Each provided buffer is referred to by at most one completion,
+        // so the completion queue only overflows if more than the number
+        // of the buffers requests stop at once
+        params.cq_entries = 2 * buffers;
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, SqEntries, &params));
+        if (fd_ == -1)
+            raise<std::runtime_error>("io_uring_setup() failed: {}", SysError{});
+
+        try {
+            mapRings(params);
+            registerBuffers();
+        } catch (...) {
+            close();
+            throw;
+        }
+
+        msg_.msg_namelen = sizeof(sockaddr_in);
+        msg_.msg_controllen = CmsgBufferSize;
+    }
+
+    UringRx(UringRx const&) = delete;
+    UringRx(UringRx&&) = delete;
+    UringRx& operator= (UringRx const&) = delete;
+    UringRx& operator= (UringRx&&) = delete;
+
+    ~UringRx() { close(); }
+
+    /*!
+     * @return the file descriptor which becomes readable when there are
+     * completions
+     */
+    [[nodiscard]]
+    int fd() const { return fd_; }
+
+    /*!
+     * @return the mapping of the provided buffers
+     */
+    [[nodiscard]]
+    MappedBuffer const& buffers() const { return buffers_; }
+
+    /*!
+     * @return the largest datagram which is received without truncation
+     */
+    [[nodiscard]]
+    unsigned payloadSize() const { return payloadSize_; }
+
+    /*!
+     * \brief Enables the instance, making the calling thread its only
+     * submitter. Must be called before recv().
+     */
+    void enable() {
+        if (syscall(__NR_io_uring_register, fd_,
+                    IORING_REGISTER_ENABLE_RINGS, nullptr, 0) == -1)
+            raise<std::runtime_error>("unable to enable io_uring: {}", SysError{});
+    }
+
+    /*!
+     * \brief Submits a multishot receive request on the socket \p socket.
+     *
+     * @param socket the socket
+     * @param id the ID of the socket which is reported in the completions
+     */
+    void recv(int socket, uint32_t id) {
+        if (sockets_.size() <= id) sockets_.resize(id + 1, -1);
+        sockets_[id] = socket;
+
+        auto tail = *sqTail_;
+        auto idx = tail & *sqMask_;
+        auto& sqe = sqes_[idx];
+        sqe = io_uring_sqe{};
+        sqe.opcode = IORING_OP_RECVMSG;
+        sqe.fd = socket;
+        sqe.addr = reinterpret_cast<uint64_t>(&msg_);
+        sqe.len = 1;
+        sqe.ioprio = IORING_RECV_MULTISHOT;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = BufferGroup;
+        sqe.user_data = id;
+        sqArray_[idx] = idx;
+        std::atomic_ref<uint32_t>{*sqTail_}.store(tail + 1, std::memory_order_release);
+
+        enter(1, 0);
+    }
+
+    /*!
+     * \brief Calls \p f for each completion and returns the buffers back
+     * to the kernel. The requests which stopped producing completions,
+     * e.g. because the provided buffers ran out, are resubmitted.
+     *
+     * @param f the callable taking a Completion const& and returning true
+     * to stop processing the completions
+     * @return true if the processing was stopped by \p f, false otherwise
+     */
+    template <typename F>
+    bool drain(F&& f) {
+        // The completions which did not fit into the completion queue are
+        // kept by the kernel until the queue is flushed
+        if (PIMC_UNLIKELY(std::atomic_ref<uint32_t>{*sqFlags_}.load(
+                std::memory_order_relaxed) & IORING_SQ_CQ_OVERFLOW))
+            enter(0, IORING_ENTER_GETEVENTS);
+
+        auto head = *cqHead_;
+        auto tail = std::atomic_ref<uint32_t>{*cqTail_}.load(std::memory_order_acquire);
+
+        bool stop{false};
+        for (; head != tail and not stop; ++head) {
+            auto const& cqe = cqes_[head & *cqMask_];
+            auto id = static_cast<uint32_t>(cqe.user_data);
+            bool rearm = (cqe.flags & IORING_CQE_F_MORE) == 0;
+
+            if (PIMC_LIKELY(cqe.flags & IORING_CQE_F_BUFFER)) {
+                auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                if (PIMC_LIKELY(cqe.res >= 0))
+                    stop = f(completion(id, buffer(bid)));
+                recycle(bid);
+            } else if (cqe.res < 0 and cqe.res != -ENOBUFS) {
+                std::atomic_ref<uint32_t>{*cqHead_}.store(
+                        head + 1, std::memory_order_release);
+                raise<std::runtime_error>(
+                        "multishot recvmsg failed: {}", SysError{-cqe.res});
+            }
+
+            if (rearm and not stop) recv(sockets_[id], id);
+        }
+
+        std::atomic_ref<uint32_t>{*cqHead_}.store(head, std::memory_order_release);
+        return stop;
+    }
+
+private:
+    void enter(unsigned toSubmit, unsigned flags) {
+        while (syscall(__NR_io_uring_enter, fd_, toSubmit, 0, flags, nullptr, 0) == -1) {
+            if (errno != EINTR)
+                raise<std::runtime_error>("io_uring_enter() failed: {}", SysError{});
+        }
+    }
+
+    void mapRings(io_uring_params const& params) {
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0)
+            raise<std::runtime_error>("io_uring does not support single mmap");
+
+        auto sqSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        auto cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ringSize_ = std::max(sqSize, cqSize);
+        ring_ = map(ringSize_, IORING_OFF_SQ_RING);
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqesSize_, IORING_OFF_SQES));
+
+        auto* r = static_cast<uint8_t*>(ring_);
+        sqTail_ = reinterpret_cast<uint32_t*>(r + params.sq_off.tail);
+        sqMask_ = reinterpret_cast<uint32_t*>(r + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<uint32_t*>(r + params.sq_off.array);
+        sqFlags_ = reinterpret_cast<uint32_t*>(r + params.sq_off.flags);
+        cqHead_ = reinterpret_cast<uint32_t*>(r + params.cq_off.head);
+        cqTail_ = reinterpret_cast<uint32_t*>(r + params.cq_off.tail);
+        cqMask_ = reinterpret_cast<uint32_t*>(r + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(r + params.cq_off.cqes);
+    }
+
+    void registerBuffers() {
+        bufRingSize_ = bufferCount_ * sizeof(io_uring_buf);
+        bufRing_ = static_cast<io_uring_buf*>(map(bufRingSize_, -1));
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(bufRing_);
+        reg.ring_entries = bufferCount_;
+        reg.bgid = BufferGroup;
+        if (syscall(__NR_io_uring_register, fd_,
+                    IORING_REGISTER_PBUF_RING, &reg, 1) == -1)
+            raise<std::runtime_error>(
+                    "unable to register io_uring provided buffers: {}", SysError{});
+
+        for (unsigned i = 0; i < bufferCount_; ++i)
+            recycle(static_cast<uint16_t>(i));
+    }
+
+    void* map(std::size_t size, long long offset) {
+        void* p = offset == -1
+                ? mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0)
+                : mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd_, offset);
+        if (p == MAP_FAILED)
+            raise<std::runtime_error>("unable to map io_uring memory: {}", SysError{});
+        return p;
+    }
+
+    [[nodiscard]]
+    uint8_t* buffer(uint16_t bid) {
+        return buffers_.data() + static_cast<std::size_t>(bid) * bufferSize_;
+    }
+
+    /*!
+     * Adds the buffer \p bid back to the provided buffer ring
+     */
+    void recycle(uint16_t bid) {
+        // The tail of the buffer ring overlays the reserved field of the
+        // first buffer
+        auto* tailp = reinterpret_cast<uint16_t*>(
+                reinterpret_cast<uint8_t*>(bufRing_) + offsetof(io_uring_buf, resv));
+        auto tail = *tailp;
+
+        auto& buf = bufRing_[tail & (bufferCount_ - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(buffer(bid));
+        buf.len = bufferSize_;
+        buf.bid = bid;
+        std::atomic_ref<uint16_t>{*tailp}.store(
+                static_cast<uint16_t>(tail + 1), std::memory_order_release);
+    }
+
+    [[nodiscard]]
+    Completion completion(uint32_t id, uint8_t* buf) {
+        // The buffer contains the header, the sender address, the control
+        // messages and the payload laid out according to msg_
+        auto const* out = reinterpret_cast<io_uring_recvmsg_out const*>(buf);
+        auto* name = buf + sizeof(io_uring_recvmsg_out);
+        auto* control = name + msg_.msg_namelen;
+        auto const* payload = control + msg_.msg_controllen;
+
+        hdr_.msg_control = control;
+        hdr_.msg_controllen = out->controllen;
+        hdr_.msg_flags = static_cast<int>(out->flags);
+
+        return Completion{
+            .id = id,
+            .sender = reinterpret_cast<sockaddr_in const*>(name),
+            .hdr = &hdr_,
+            .data = payload,
+            .size = std::min(out->payloadlen, payloadSize_),
+            .truncated = out->payloadlen > payloadSize_
+        };
+    }
+
+    /*!
+     * @return \p size rounded up to the cache line size, so that each
+     * buffer starts on its own cache line
+     */
+    static unsigned alignedSize(std::size_t size) {
+        return static_cast<unsigned>((size + 63u) & ~std::size_t{63});
+    }
+
+    void close() {
+        if (bufRing_ != nullptr) munmap(bufRing_, bufRingSize_);
+        if (sqes_ != nullptr) munmap(sqes_, sqesSize_);
+        if (ring_ != nullptr) munmap(ring_, ringSize_);
+
+        int rc;
+        do {
+            rc = ::close(fd_);
+        } while (rc == -1 and errno == EINTR);
+    }
+
+private:
+    static constexpr unsigned SqEntries{64};
+    static constexpr uint16_t BufferGroup{0};
+
+    int fd_;
+    unsigned bufferCount_;
+    unsigned payloadSize_;
+    unsigned bufferSize_;
+    MappedBuffer buffers_;
+
+    void* ring_{nullptr};
+    std::size_t ringSize_{0};
+    io_uring_sqe* sqes_{nullptr};
+    std::size_t sqesSize_{0};
+    uint32_t* sqTail_{nullptr};
+    uint32_t* sqMask_{nullptr};
+    uint32_t* sqArray_{nullptr};
+    uint32_t* sqFlags_{nullptr};
+    uint32_t* cqHead_{nullptr};
+    uint32_t* cqTail_{nullptr};
+    uint32_t* cqMask_{nullptr};
+    io_uring_cqe* cqes_{nullptr};
+
+    io_uring_buf* bufRing_{nullptr};
+    std::size_t bufRingSize_{0};
+
+    // The template of the multishot receive requests
+    msghdr msg_{};
+    // The header passed in the completions
+    msghdr hdr_{};
+    // The sockets by their IDs
+    std::vector<int> sockets_;
+};
+
+} // namespace pimc
+
+#endif
@@ -0,0 +1,300 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+#include "Config.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief An XDP program which redirects the IPv4 UDP packets destined for
+ * the subscribed groups to the `AF_XDP` sockets of the receive queues on
+ * which they arrive, and passes the rest of the traffic to the kernel
+ * stack.
+ *
+ * Like RxFilter, the program matches the groups, the sources of the source
+ * specific subscriptions and the configured range of the destination
+ * ports, so the traffic of the other applications on the host is left to
+ * the kernel stack, even if it is destined for the same groups. The IPv4
+ * fragments are passed to the kernel stack, as they cannot be
+ * reassembled in an `AF_XDP` socket, so the fragmented datagrams are not
+ * received.
+ *
+ * The program is assembled by hand and loaded with the `bpf()` system
+ * call, so neither `libbpf` nor `libxdp` is required. It is attached to
+ * the interface through a BPF link, so it is detached as soon as the link
+ * is closed, even if the process is killed.
+ */
+class XdpProgram final {
+public:
+    /*!
+     * \brief Loads the program and attaches it to the interface.
+     *
+     * @param cfg the configuration with the subscriptions
+     * @param ifIndex the index of the interface
+     * @param queues the number of receive queues of the interface
+     * @param skbMode if true, the program is attached in the generic mode,
+     * which works on any interface, otherwise in the native mode
+     */
+    XdpProgram(Config const& cfg, unsigned ifIndex, unsigned queues, bool skbMode)
+    : mapFd_{-1}, progFd_{-1}, linkFd_{-1} {
+        try {
+            createMap(queues);
+            load(cfg);
+            attach(ifIndex, skbMode);
+        } catch (...) {
+            close();
+            throw;
+        }
+    }
+
+    XdpProgram(XdpProgram const&) = delete;
+    XdpProgram(XdpProgram&&) = delete;
+    XdpProgram& operator= (XdpProgram const&) = delete;
+    XdpProgram& operator= (XdpProgram&&) = delete;
+
+    ~XdpProgram() { close(); }
+
+    /*!
+     * \brief Makes the program redirect the packets received on the queue
+     * \p queue to the `AF_XDP` socket \p xsk.
+     */
+    void redirect(unsigned queue, int xsk) {
+        bpf_attr attr{};
+        attr.map_fd = static_cast<uint32_t>(mapFd_);
+        attr.key = reinterpret_cast<uint64_t>(&queue);
+        attr.value = reinterpret_cast<uint64_t>(&xsk);
+        attr.flags = BPF_ANY;
+        if (bpf(BPF_MAP_UPDATE_ELEM, attr) == -1)
+            raise<std::runtime_error>(
+                    "unable to add AF_XDP socket of queue {} to XDP map: {}",
+                    queue, SysError{});
+    }
+
+private:
+    void createMap(unsigned queues) {
+        bpf_attr attr{};
+        attr.map_type = BPF_MAP_TYPE_XSKMAP;
+        attr.key_size = sizeof(uint32_t);
+        attr.value_size = sizeof(uint32_t);
+        attr.max_entries = queues;
+        mapFd_ = bpf(BPF_MAP_CREATE, attr);
+        if (mapFd_ == -1) {
+            if (errno == EPERM)
+                raise<std::runtime_error>(
+                        "permission to create XDP map denied, "
+                        "try running under sudo");
+            raise<std::runtime_error>("unable to create XDP map: {}", SysError{});
+        }
+    }
+
+    void load(Config const& cfg) {
+        auto subs = cfg.subscriptions();
+        std::sort(subs.begin(), subs.end(), [] (auto const& lhs, auto const& rhs) {
+            return lhs.group < rhs.group;
+        });
+
+        std::vector<std::size_t> passJumps;
+
+        // r6 = ctx; r2 = ctx->data; r3 = ctx->data_end
+        alu64(BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0);
+        ldx(BPF_W, BPF_REG_2, BPF_REG_6, DataOff);
+        ldx(BPF_W, BPF_REG_3, BPF_REG_6, DataEndOff);
+        // The Ethernet and the fixed part of the IPv4 header must be there
+        alu64(BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0);
+        alu64(BPF_ADD | BPF_K, BPF_REG_4, 0, MinSize);
+        passJumps.push_back(jump(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0));
+
+        // The values loaded from the packet are in the network byte order
+        ldx(BPF_H, BPF_REG_5, BPF_REG_2, EtherTypeOff);
+        passJumps.push_back(jump(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_5, 0, htons(ETH_P_IP)));
+        ldx(BPF_B, BPF_REG_5, BPF_REG_2, ProtocolOff);
+        passJumps.push_back(jump(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_5, 0, IPPROTO_UDP));
+        ldx(BPF_H, BPF_REG_5, BPF_REG_2, FragOff);
+        passJumps.push_back(jump(BPF_JMP32 | BPF_JSET | BPF_K, BPF_REG_5, 0, htons(IP_MF | IP_OFFMASK)));
+
+        // The group branches follow one after another, each one jumping to
+        // the block matching the source of the subscription
+        ldx(BPF_W, BPF_REG_5, BPF_REG_2, DaddrOff);
+        std::vector<std::size_t> groupJumps;
+        for (auto const& sub: subs)
+            groupJumps.push_back(
+                    jump(BPF_JMP32 | BPF_JEQ | BPF_K, BPF_REG_5, 0, sub.group.to_nl()));
+        passJumps.push_back(jump(BPF_JMP | BPF_JA, 0, 0, 0));
+
+        std::vector<std::size_t> portsJumps;
+        for (std::size_t i = 0; i < subs.size(); ++i) {
+            auto const& sub = subs[i];
+            target(groupJumps[i]);
+            if (sub.sources.empty()) {
+                portsJumps.push_back(jump(BPF_JMP | BPF_JA, 0, 0, 0));
+                continue;
+            }
+
+            ldx(BPF_W, BPF_REG_5, BPF_REG_2, SaddrOff);
+            for (auto source: sub.sources)
+                portsJumps.push_back(
+                        jump(BPF_JMP32 | BPF_JEQ | BPF_K, BPF_REG_5, 0, source.to_nl()));
+            passJumps.push_back(jump(BPF_JMP | BPF_JA, 0, 0, 0));
+        }
+
+        for (auto pj: portsJumps)
+            target(pj);
+
+        auto dports = cfg.dports();
+        if (not dports.all()) {
+            // r4 = data + 4 * IHL, the start of the UDP header less the
+            // Ethernet header, whose end the verifier needs checked
+            ldx(BPF_B, BPF_REG_4, BPF_REG_2, ETH_HLEN);
+            alu64(BPF_AND | BPF_K, BPF_REG_4, 0, 0xf);
+            alu64(BPF_LSH | BPF_K, BPF_REG_4, 0, 2);
+            alu64(BPF_ADD | BPF_X, BPF_REG_4, BPF_REG_2, 0);
+            alu64(BPF_MOV | BPF_X, BPF_REG_5, BPF_REG_4, 0);
+            alu64(BPF_ADD | BPF_K, BPF_REG_5, 0, ETH_HLEN + UDPHdrSize);
+            passJumps.push_back(jump(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_5, BPF_REG_3, 0));
+
+            ldx(BPF_H, BPF_REG_5, BPF_REG_4, ETH_HLEN + UDPDportOff);
+            emit(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_5, 0, 0, 16);
+            passJumps.push_back(jump(BPF_JMP32 | BPF_JLT | BPF_K, BPF_REG_5, 0, dports.first));
+            passJumps.push_back(jump(BPF_JMP32 | BPF_JGT | BPF_K, BPF_REG_5, 0, dports.last));
+        }
+
+        // return bpf_redirect_map(&xsks, ctx->rx_queue_index, XDP_PASS)
+        ldx(BPF_W, BPF_REG_2, BPF_REG_6, RxQueueIndexOff);
+        // The 64 bit immediate load takes two instructions
+        emit(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, mapFd_);
+        emit(0, 0, 0, 0, 0);
+        // The action taken if there is no socket for the queue
+        alu64(BPF_MOV | BPF_K, BPF_REG_3, 0, XDP_PASS);
+        emit(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+        emit(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+        // return XDP_PASS
+        for (auto pj: passJumps)
+            target(pj);
+        alu64(BPF_MOV | BPF_K, BPF_REG_0, 0, XDP_PASS);
+        emit(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+        char const license[] = "GPL";
+        bpf_attr attr{};
+        attr.prog_type = BPF_PROG_TYPE_XDP;
+        attr.insn_cnt = static_cast<uint32_t>(prog_.size());
+        attr.insns = reinterpret_cast<uint64_t>(prog_.data());
+        attr.license = reinterpret_cast<uint64_t>(license);
+        progFd_ = bpf(BPF_PROG_LOAD, attr);
+        if (progFd_ == -1)
+            raise<std::runtime_error>("unable to load XDP program: {}", SysError{});
+    }
+
+    void attach(unsigned ifIndex, bool skbMode) {
+        bpf_attr attr{};
+        attr.link_create.prog_fd = static_cast<uint32_t>(progFd_);
+        attr.link_create.target_ifindex = ifIndex;
+        attr.link_create.attach_type = BPF_XDP;
+        attr.link_create.flags = skbMode ? XDP_FLAGS_SKB_MODE : XDP_FLAGS_DRV_MODE;
+        linkFd_ = bpf(BPF_LINK_CREATE, attr);
+        if (linkFd_ == -1) {
+            if (errno == EBUSY)
+                raise<std::runtime_error>(
+                        "unable to attach XDP program: another XDP program "
+                        "is attached to the interface");
+            raise<std::runtime_error>("unable to attach XDP program: {}", SysError{});
+        }
+    }
+
+    static int bpf(int cmd, bpf_attr& attr) {
+        return static_cast<int>(syscall(__NR_bpf, cmd, &attr, sizeof(attr)));
+    }
+
+    void emit(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm) {
+        bpf_insn insn{};
+        insn.code = code;
+        // The registers are 4 bit fields
+        insn.dst_reg = dst & 0xfu;
+        insn.src_reg = src & 0xfu;
+        insn.off = off;
+        insn.imm = imm;
+        prog_.push_back(insn);
+    }
+
+    void alu64(uint8_t op, uint8_t dst, uint8_t src, int32_t imm) {
+        emit(static_cast<uint8_t>(BPF_ALU64 | op), dst, src, 0, imm);
+    }
+
+    void ldx(uint8_t size, uint8_t dst, uint8_t src, int16_t off) {
+        emit(static_cast<uint8_t>(BPF_LDX | BPF_MEM | size), dst, src, off, 0);
+    }
+
+    /*!
+     * Adds a jump instruction the target of which is set by target()
+     *
+     * @return the index of the jump instruction
+     */
+    std::size_t jump(uint8_t code, uint8_t dst, uint8_t src, uint32_t imm) {
+        emit(code, dst, src, 0, static_cast<int32_t>(imm));
+        return prog_.size() - 1;
+    }
+
+    /*!
+     * Points the jump instruction at \p pc to the next instruction
+     */
+    void target(std::size_t pc) {
+        auto off = prog_.size() - pc - 1;
+        if (off > static_cast<std::size_t>(std::numeric_limits<int16_t>::max()))
+            raise<std::runtime_error>(
+                    "too many subscriptions for the XDP program, the jumps "
+                    "span more than {} instructions",
+                    std::numeric_limits<int16_t>::max());
+        prog_[pc].off = static_cast<int16_t>(off);
+    }
+
+    void close() {
+        for (auto fd: {linkFd_, progFd_, mapFd_}) {
+            if (fd != -1) ::close(fd);
+        }
+    }
+
+private:
+    // The offsets of the fields of xdp_md
+    static constexpr int16_t DataOff{0};
+    static constexpr int16_t DataEndOff{4};
+    static constexpr int16_t RxQueueIndexOff{16};
+    // The offsets in the Ethernet frame
+    static constexpr int16_t EtherTypeOff{12};
+    static constexpr int16_t FragOff{ETH_HLEN + 6};
+    static constexpr int16_t ProtocolOff{ETH_HLEN + 9};
+    static constexpr int16_t SaddrOff{ETH_HLEN + 12};
+    static constexpr int16_t DaddrOff{ETH_HLEN + 16};
+    static constexpr int32_t MinSize{ETH_HLEN + 20};
+    // The offsets in the UDP header
+    static constexpr int16_t UDPDportOff{2};
+    static constexpr int32_t UDPHdrSize{8};
+
+    int mapFd_;
+    int progFd_;
+    int linkFd_;
+    std::vector<bpf_insn> prog_;
+};
+
+} // namespace pimc
+
+#endif
@@ -0,0 +1,154 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <net/if.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "pimc/unix/CapState.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+#include "IPv4UdpDissector.hpp"
+#include "ReceiverBase.hpp"
+#include "XdpProgram.hpp"
+#include "XdpSocket.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The portless receiver provider which receives the packets from
+ * `AF_XDP` sockets, bypassing the kernel network stack.
+ *
+ * An XdpProgram attached to the interface redirects the UDP packets
+ * destined for the subscribed groups to an `AF_XDP` socket per receive
+ * queue of the interface and leaves the rest of the traffic to the
+ * kernel. The receive queues are dealt to the receive threads
+ * round-robin.
+ *
+ * The sockets opened with openSocket() are only used to join the groups
+ * and never receive any traffic.
+ */
+template <Limiter Limit, OutputPolicy Output>
+class XdpReceiver: public ReceiverBase<XdpReceiver<Limit, Output>, Limit, Output> {
+    using Base = ReceiverBase<XdpReceiver<Limit, Output>, Limit, Output>;
+
+public:
+    XdpReceiver(Config const& cfg, OutputHandler& oh, bool& stopped)
+    : Base{cfg, oh, stopped}, dissector_{cfg, oh}, ifIndex_{0}, queues_{0} {}
+
+protected:
+    using Base::cfg_;
+    using Base::dissectMclstBeaconPayload;
+
+public:
+    auto openSocket(char const*) -> int {
+        int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+        if (s == -1)
+            raise<std::runtime_error>("unable to create socket: {}", SysError{});
+
+        return s;
+    }
+
+    /*!
+     * \brief Opens the `AF_XDP` sockets of the receive queues assigned to
+     * the receive thread \p shardId. The XDP program is attached to the
+     * interface when the sockets of the first receive thread are opened.
+     *
+     * @param progname the name of the program used to raise capabilities
+     * @param shardId the index of the receive thread
+     * @return the `AF_XDP` sockets
+     */
+    auto openXdp(char const* progname, unsigned shardId)
+            -> std::vector<std::unique_ptr<XdpSocket>> {
+#ifdef CAP_BPF
+        auto r = CapState::program(progname).raise(
+                CAP_(NET_ADMIN), CAP_(NET_RAW), CAP_(BPF));
+#else
+        auto r = CapState::program(progname).raise(
+                CAP_(NET_ADMIN), CAP_(NET_RAW), CAP_(SYS_ADMIN));
+#endif
+        if (not r)
+            throw std::runtime_error{r.error()};
+
+        bool skbMode = cfg_.xdp() == XdpMode::Skb;
+        if (not program_) {
+            ifIndex_ = if_nametoindex(cfg_.intf().c_str());
+            if (ifIndex_ == 0)
+                raise<std::runtime_error>(
+                        "unable to query the index of interface {}: {}",
+                        cfg_.intf(), SysError{});
+
+            queues_ = rxQueues();
+            if (queues_ < cfg_.threads())
+                raise<std::runtime_error>(
+                        "interface {} has {} receive queues, which is fewer "
+                        "than {} receive threads",
+                        cfg_.intf(), queues_, cfg_.threads());
+
+            program_ = std::make_unique<XdpProgram>(cfg_, ifIndex_, queues_, skbMode);
+        }
+
+        std::vector<std::unique_ptr<XdpSocket>> xsks;
+        for (auto q = shardId; q < queues_; q += cfg_.threads()) {
+            xsks.push_back(std::make_unique<XdpSocket>(ifIndex_, q, skbMode));
+            program_->redirect(q, xsks.back()->fd());
+        }
+
+        return xsks;
+    }
+
+    auto processPacket(
+            sockaddr_in const&, PacketInfo& pktInfo) -> PacketStatus {
+        auto ps = dissector_.dissect(pktInfo);
+        if (ps == PacketStatus::AcceptedShow)
+            dissectMclstBeaconPayload(pktInfo);
+
+        return ps;
+    };
+
+private:
+    /*!
+     * @return the number of the receive queues of the interface
+     */
+    unsigned rxQueues() const {
+        namespace fs = std::filesystem;
+
+        std::error_code ec;
+        fs::directory_iterator it{
+            fs::path{"/sys/class/net"} / cfg_.intf() / "queues", ec};
+        if (ec)
+            raise<std::runtime_error>(
+                    "unable to query the receive queues of interface {}: {}",
+                    cfg_.intf(), ec.message());
+
+        unsigned queues{0};
+        for (auto const& entry: it) {
+            if (entry.path().filename().string().starts_with("rx-"))
+                ++queues;
+        }
+
+        return std::max(queues, 1u);
+    }
+
+private:
+    IPv4UdpDissector dissector_;
+    unsigned ifIndex_;
+    unsigned queues_;
+    // Destroyed before the sockets of the receive threads, which are owned
+    // by the base, so the program is detached before they are closed
+    std::unique_ptr<XdpProgram> program_;
+};
+
+} // namespace pimc
+
+#endif
@@ -0,0 +1,263 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <linux/if_xdp.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+
+#include "pimc/core/CompilerUtils.hpp"
+#include "pimc/system/Exceptions.hpp"
+#include "pimc/system/SysError.hpp"
+#include "pimc/formatters/SysErrorFormatter.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief An `AF_XDP` socket receiving the packets redirected by
+ * XdpProgram from a single receive queue of the interface.
+ *
+ * The socket has its own UMEM, an area of fixed size frames into which
+ * the packets are written. The frames are handed to the kernel through
+ * the fill ring and come back with the packets through the receive
+ * ring, where they are processed in place and then put back to the fill
+ * ring, so the receive path does not allocate or copy anything.
+ */
+class XdpSocket final {
+public:
+    /*!
+     * \brief A packet received in a UMEM frame.
+     */
+    struct Frame final {
+        // The IPv4 packet starting with the IPv4 header
+        uint8_t const* data;
+        unsigned size;
+    };
+
+    /*!
+     * \brief Creates the socket and binds it to the queue \p queue of the
+     * interface \p ifIndex.
+     *
+     * @param ifIndex the index of the interface
+     * @param queue the receive queue
+     * @param copyMode if true, the packets are always copied into UMEM,
+     * which is required in the generic XDP mode, otherwise the zero copy
+     * mode is used if the driver supports it
+     */
+    XdpSocket(unsigned ifIndex, unsigned queue, bool copyMode)
+    : socket_{socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0)}
+    , ifIndex_{ifIndex}
+    , queue_{queue}
+    , umem_{nullptr} {
+        if (socket_ == -1) {
+            if (errno == EPERM)
+                raise<std::runtime_error>(
+                        "permission to open AF_XDP socket denied, "
+                        "try running under sudo");
+            raise<std::runtime_error>("unable to open AF_XDP socket: {}", SysError{});
+        }
+
+        try {
+            setup(ifIndex, copyMode);
+        } catch (...) {
+            close();
+            throw;
+        }
+    }
+
+    XdpSocket(XdpSocket const&) = delete;
+    XdpSocket(XdpSocket&&) = delete;
+    XdpSocket& operator= (XdpSocket const&) = delete;
+    XdpSocket& operator= (XdpSocket&&) = delete;
+
+    ~XdpSocket() { close(); }
+
+    /*!
+     * @return the socket which becomes readable when there are packets in
+     * the receive ring
+     */
+    [[nodiscard]]
+    int fd() const { return socket_; }
+
+    /*!
+     * @return the index of the interface to which the socket is bound
+     */
+    [[nodiscard]]
+    unsigned ifIndex() const { return ifIndex_; }
+
+    /*!
+     * @return the receive queue to which the socket is bound
+     */
+    [[nodiscard]]
+    unsigned queue() const { return queue_; }
+
+    /*!
+     * \brief Calls \p f for each packet in the receive ring and returns
+     * the frames of the packets to the fill ring.
+     *
+     * The frames are only valid until \p f returns. If \p f returns true,
+     * the iteration stops early and the rest of the packets are left in
+     * the receive ring.
+     *
+     * @param f the callable taking a Frame const& and returning bool
+     * @return true if the iteration was stopped by \p f, false otherwise
+     */
+    template <typename F>
+    bool drain(F&& f) {
+        auto prod = std::atomic_ref<uint32_t>{*rx_.producer}.load(
+                std::memory_order_acquire);
+        auto cons = *rx_.consumer;
+        auto fillProd = *fill_.producer;
+
+        bool stop{false};
+        while (cons != prod and not stop) {
+            auto const& desc = rx_.descs<xdp_desc>()[cons & RingMask];
+            auto const* data = umem_ + desc.addr;
+            ++cons;
+
+            // The XDP program only redirects the IPv4 packets
+            stop = f(Frame{.data = data + ETH_HLEN, .size = desc.len - ETH_HLEN});
+
+            fill_.descs<uint64_t>()[fillProd & RingMask] = desc.addr & ~(FrameSize - 1);
+            ++fillProd;
+        }
+
+        std::atomic_ref<uint32_t>{*fill_.producer}.store(
+                fillProd, std::memory_order_release);
+        std::atomic_ref<uint32_t>{*rx_.consumer}.store(
+                cons, std::memory_order_release);
+
+        return stop;
+    }
+
+private:
+    /*!
+     * A ring shared with the kernel
+     */
+    struct Ring final {
+        void* map{nullptr};
+        std::size_t size{0};
+        uint32_t* producer{nullptr};
+        uint32_t* consumer{nullptr};
+        uint8_t* desc{nullptr};
+
+        template <typename T>
+        T* descs() const { return reinterpret_cast<T*>(desc); }
+    };
+
+    void setup(unsigned ifIndex, bool copyMode) {
+        auto* umem = mmap(
+                nullptr, UmemSize, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (umem == MAP_FAILED)
+            raise<std::runtime_error>("unable to allocate UMEM: {}", SysError{});
+        umem_ = static_cast<uint8_t*>(umem);
+
+        xdp_umem_reg reg{};
+        reg.addr = reinterpret_cast<uint64_t>(umem_);
+        reg.len = UmemSize;
+        reg.chunk_size = FrameSize;
+        reg.headroom = 0;
+        setOption(XDP_UMEM_REG, &reg, sizeof(reg), "register UMEM");
+
+        unsigned ringSize{RingSize};
+        setOption(XDP_UMEM_FILL_RING, &ringSize, sizeof(ringSize), "create fill ring");
+        // The completion ring is only used for transmitting, but the
+        // socket cannot be bound without it
+        setOption(XDP_UMEM_COMPLETION_RING, &ringSize, sizeof(ringSize),
+                  "create completion ring");
+        setOption(XDP_RX_RING, &ringSize, sizeof(ringSize), "create receive ring");
+
+        xdp_mmap_offsets offsets{};
+        socklen_t len = sizeof(offsets);
+        if (getsockopt(socket_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &len) == -1)
+            raise<std::runtime_error>(
+                    "unable to query AF_XDP ring offsets: {}", SysError{});
+
+        fill_ = mapRing(offsets.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING);
+        completion_ = mapRing(
+                offsets.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING);
+        rx_ = mapRing(offsets.rx, sizeof(xdp_desc), XDP_PGOFF_RX_RING);
+
+        // The whole UMEM is given to the kernel up front
+        for (uint32_t i = 0; i < RingSize; ++i)
+            fill_.descs<uint64_t>()[i] = static_cast<uint64_t>(i) * FrameSize;
+        std::atomic_ref<uint32_t>{*fill_.producer}.store(
+                RingSize, std::memory_order_release);
+
+        sockaddr_xdp sxdp{};
+        sxdp.sxdp_family = AF_XDP;
+        sxdp.sxdp_flags = copyMode ? XDP_COPY : 0;
+        sxdp.sxdp_ifindex = ifIndex;
+        sxdp.sxdp_queue_id = queue_;
+        if (bind(socket_, reinterpret_cast<sockaddr*>(&sxdp), sizeof(sxdp)) == -1)
+            raise<std::runtime_error>(
+                    "unable to bind AF_XDP socket to queue {}: {}", queue_, SysError{});
+    }
+
+    void setOption(int opt, void const* val, socklen_t len, char const* what) {
+        if (setsockopt(socket_, SOL_XDP, opt, val, len) == -1)
+            raise<std::runtime_error>("unable to {}: {}", what, SysError{});
+    }
+
+    Ring mapRing(xdp_ring_offset const& off, std::size_t descSize, off_t pgoff) {
+        Ring ring;
+        ring.size = off.desc + RingSize * descSize;
+        ring.map = mmap(
+                nullptr, ring.size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, socket_, pgoff);
+        if (ring.map == MAP_FAILED) {
+            ring.map = nullptr;
+            raise<std::runtime_error>("unable to map AF_XDP ring: {}", SysError{});
+        }
+
+        auto* base = static_cast<uint8_t*>(ring.map);
+        ring.producer = reinterpret_cast<uint32_t*>(base + off.producer);
+        ring.consumer = reinterpret_cast<uint32_t*>(base + off.consumer);
+        ring.desc = base + off.desc;
+        return ring;
+    }
+
+    void close() {
+        for (auto const* ring: {&rx_, &completion_, &fill_}) {
+            if (ring->map != nullptr) munmap(ring->map, ring->size);
+        }
+
+        int rc;
+        do {
+            rc = ::close(socket_);
+        } while (rc == -1 and errno == EINTR);
+
+        // The UMEM may only be unmapped once the socket is closed
+        if (umem_ != nullptr)
+            munmap(umem_, UmemSize);
+    }
+
+private:
+    // The number of the entries of each of the rings, which is also the
+    // number of the frames in UMEM
+    static constexpr uint32_t RingSize{4096};
+    static constexpr uint32_t RingMask{RingSize - 1};
+    // The size of a UMEM frame, a packet must fit in a single frame
+    static constexpr uint32_t FrameSize{4096};
+    static constexpr std::size_t UmemSize{
+        static_cast<std::size_t>(RingSize) * FrameSize};
+
+    int socket_;
+    unsigned ifIndex_;
+    unsigned queue_;
+    uint8_t* umem_;
+    Ring fill_;
+    Ring completion_;
+    Ring rx_;
+};
+
+} // namespace pimc
+
+#endif
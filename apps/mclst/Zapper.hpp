@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "pimc/net/IPv4Address.hpp"
+#include "pimc/time/TimeUtils.hpp"
+
+#include "Config.hpp"
+#include "LatencyHistogram.hpp"
+
+namespace pimc {
+
+/*!
+ * \brief The join and leave latencies measured by the zappers of the
+ * receive threads.
+ */
+struct ZapStats final {
+    // From the join to the first packet of the subscription
+    LatencyHistogram joins;
+    // From the leave to the last packet of the subscription
+    LatencyHistogram leaves;
+    // The joins which received no packet before the subscription was left
+    uint64_t missed{0};
+
+    void merge(ZapStats const& other) {
+        joins.merge(other.joins);
+        leaves.merge(other.leaves);
+        missed += other.missed;
+    }
+};
+
+/*!
+ * \brief Joins the subscriptions of a receive thread one at a time,
+ * emulating a viewer zapping through the IPTV channels, and measures how
+ * soon the traffic starts after a join and stops after a leave.
+ *
+ * Each subscription is joined for the dwell time, then left and the next
+ * one is joined right away. A single subscription is left for the dwell
+ * time and then rejoined. The traffic of the subscription which has been
+ * left is watched until the next zap, so the leave latency is the time
+ * from the leave to the last packet received within one dwell time, or 0
+ * if no packet is received after the leave.
+ *
+ * The zapper does not join and leave itself, it tells the receiver which
+ * subscription to join and leave through the callables passed to zap().
+ */
+class Zapper final {
+public:
+    /*!
+     * \brief A subscription along with the socket on which it is joined.
+     */
+    struct Channel final {
+        int fd;
+        Subscription sub;
+    };
+
+    explicit Zapper(unsigned dwellMs)
+    : dwellNs_{static_cast<uint64_t>(dwellMs) * 1'000'000ul}
+    , deadline_{0}, next_{0}, current_{None}, leaving_{None}
+    , joinedAt_{0}, leftAt_{0}, lastAfterLeave_{0}, joinLatency_{0}
+    , seen_{false} {}
+
+    void add(int fd, Subscription const& sub) {
+        channels_.push_back(Channel{.fd = fd, .sub = sub});
+    }
+
+    [[nodiscard]]
+    bool empty() const { return channels_.empty(); }
+
+    /*!
+     * @return the host time in nanoseconds when zap() is to be called next
+     */
+    [[nodiscard]]
+    uint64_t deadline() const { return deadline_; }
+
+    /*!
+     * \brief Leaves the joined subscription and joins the next one.
+     *
+     * @param now the current host time in nanoseconds
+     * @param join the callable taking the Channel const& to join
+     * @param leave the callable taking the Channel const& to leave
+     */
+    template <typename Join, typename Leave>
+    void zap(uint64_t now, Join&& join, Leave&& leave) {
+        if (leaving_ != None) {
+            stats_.leaves.record(
+                    lastAfterLeave_ > leftAt_ ? lastAfterLeave_ - leftAt_ : 0);
+            leaving_ = None;
+        }
+
+        deadline_ = now + dwellNs_;
+
+        if (current_ != None) {
+            leave(channels_[current_]);
+            if (not seen_) ++stats_.missed;
+            leaving_ = current_;
+            leftAt_ = now;
+            lastAfterLeave_ = 0;
+            current_ = None;
+
+            // A single subscription stays left for the dwell time
+            if (channels_.size() == 1) return;
+        }
+
+        current_ = next_;
+        next_ = (next_ + 1) % channels_.size();
+        joinedAt_ = gethostnanos();
+        seen_ = false;
+        join(channels_[current_]);
+    }
+
+    /*!
+     * \brief Accounts for a packet of the subscription (\p source, \p group)
+     * received at \p ts.
+     *
+     * @return true if the packet is the first one since the subscription
+     * was joined, in which case joinLatency() returns the latency of the
+     * join, false otherwise
+     */
+    bool onPacket(IPv4Address group, IPv4Address source, uint64_t ts) {
+        if (current_ != None and not seen_ and ts >= joinedAt_ and
+            matches(channels_[current_], group, source)) {
+            seen_ = true;
+            joinLatency_ = ts - joinedAt_;
+            stats_.joins.record(joinLatency_);
+            return true;
+        }
+
+        if (leaving_ != None and ts >= leftAt_ and
+            matches(channels_[leaving_], group, source))
+            lastAfterLeave_ = ts;
+
+        return false;
+    }
+
+    /*!
+     * @return the subscription which is currently joined, valid only if
+     * onPacket() has returned true
+     */
+    [[nodiscard]]
+    Channel const& joined() const { return channels_[current_]; }
+
+    /*!
+     * @return the latency of the last join in nanoseconds
+     */
+    [[nodiscard]]
+    uint64_t joinLatency() const { return joinLatency_; }
+
+    [[nodiscard]]
+    ZapStats const& stats() const { return stats_; }
+
+    [[nodiscard]]
+    ZapStats& stats() { return stats_; }
+
+private:
+    static bool matches(
+            Channel const& ch, IPv4Address group, IPv4Address source) {
+        return ch.sub.group == group and ch.sub.accepts(source);
+    }
+
+private:
+    static constexpr std::size_t None{std::numeric_limits<std::size_t>::max()};
+
+    std::vector<Channel> channels_;
+    uint64_t dwellNs_;
+    uint64_t deadline_;
+    std::size_t next_;
+    std::size_t current_;
+    std::size_t leaving_;
+    uint64_t joinedAt_;
+    uint64_t leftAt_;
+    uint64_t lastAfterLeave_;
+    uint64_t joinLatency_;
+    bool seen_;
+    ZapStats stats_;
+};
+
+} // namespace pimc
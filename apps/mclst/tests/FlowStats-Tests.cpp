@@ -0,0 +1,121 @@
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "../RxStats.hpp"
+
+namespace pimc::testing {
+
+class FlowStatsTests: public ::testing::Test {
+protected:
+    static void sequence(FlowStats& fs, uint64_t first, uint64_t last) {
+        for (auto seq = first; seq <= last; ++seq)
+            fs.sequence(seq);
+    }
+};
+
+TEST_F(FlowStatsTests, InOrder) {
+    FlowStats fs{0};
+    sequence(fs, 1, 1000);
+
+    EXPECT_EQ(fs.seqs(), 1000u);
+    EXPECT_EQ(fs.lost(), 0u);
+    EXPECT_EQ(fs.duplicates(), 0u);
+    EXPECT_EQ(fs.reordered(), 0u);
+    EXPECT_EQ(fs.restarts(), 0u);
+}
+
+TEST_F(FlowStatsTests, GapFilledWithinWindow) {
+    FlowStats fs{0};
+    sequence(fs, 1, 10);
+    sequence(fs, 14, 20);
+    EXPECT_EQ(fs.lost(), 3u);
+
+    // The late packets fill the gap, even though they are consecutive
+    sequence(fs, 11, 13);
+    sequence(fs, 21, 30);
+
+    EXPECT_EQ(fs.lost(), 0u);
+    EXPECT_EQ(fs.reordered(), 3u);
+    EXPECT_EQ(fs.restarts(), 0u);
+}
+
+TEST_F(FlowStatsTests, Duplicates) {
+    FlowStats fs{0};
+    sequence(fs, 1, 100);
+    fs.sequence(100);
+    fs.sequence(90);
+    sequence(fs, 101, 110);
+
+    EXPECT_EQ(fs.lost(), 0u);
+    EXPECT_EQ(fs.duplicates(), 2u);
+    EXPECT_EQ(fs.restarts(), 0u);
+}
+
+TEST_F(FlowStatsTests, LatePacketOlderThanWindow) {
+    FlowStats fs{0};
+    sequence(fs, 1, 1000);
+    fs.sequence(900);
+    sequence(fs, 1001, 1100);
+
+    EXPECT_EQ(fs.lost(), 0u);
+    EXPECT_EQ(fs.duplicates(), 0u);
+    EXPECT_EQ(fs.reordered(), 1u);
+    EXPECT_EQ(fs.restarts(), 0u);
+}
+
+TEST_F(FlowStatsTests, FewLatePacketsOlderThanWindow) {
+    FlowStats fs{0};
+    sequence(fs, 1, 1000);
+    sequence(fs, 900, 903);
+    sequence(fs, 1001, 1100);
+
+    EXPECT_EQ(fs.lost(), 0u);
+    EXPECT_EQ(fs.reordered(), 4u);
+    EXPECT_EQ(fs.restarts(), 0u);
+}
+
+TEST_F(FlowStatsTests, RestartFarBack) {
+    FlowStats fs{0};
+    sequence(fs, 1'000'000, 1'000'100);
+    sequence(fs, 1, 100);
+
+    EXPECT_EQ(fs.lost(), 0u);
+    EXPECT_EQ(fs.duplicates(), 0u);
+    EXPECT_EQ(fs.reordered(), 0u);
+    EXPECT_EQ(fs.restarts(), 1u);
+}
+
+TEST_F(FlowStatsTests, RestartBehindLast) {
+    FlowStats fs{0};
+    sequence(fs, 1, 1000);
+    sequence(fs, 1, 100);
+
+    EXPECT_EQ(fs.lost(), 0u);
+    EXPECT_EQ(fs.duplicates(), 0u);
+    EXPECT_EQ(fs.reordered(), 0u);
+    EXPECT_EQ(fs.restarts(), 1u);
+}
+
+TEST_F(FlowStatsTests, RestartWithinWindow) {
+    FlowStats fs{0};
+    sequence(fs, 1, 1000);
+    sequence(fs, 990, 1100);
+
+    EXPECT_EQ(fs.lost(), 0u);
+    EXPECT_EQ(fs.duplicates(), 0u);
+    EXPECT_EQ(fs.reordered(), 0u);
+    EXPECT_EQ(fs.restarts(), 1u);
+}
+
+TEST_F(FlowStatsTests, GapAfterRestart) {
+    FlowStats fs{0};
+    sequence(fs, 1, 1000);
+    sequence(fs, 1, 50);
+    sequence(fs, 53, 60);
+
+    EXPECT_EQ(fs.lost(), 2u);
+    EXPECT_EQ(fs.restarts(), 1u);
+}
+
+} // namespace pimc::testing
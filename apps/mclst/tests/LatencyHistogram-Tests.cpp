@@ -0,0 +1,147 @@
+#include <cstdint>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "../LatencyHistogram.hpp"
+
+namespace pimc::testing {
+
+class LatencyHistogramTests: public ::testing::Test {
+protected:
+    static constexpr uint64_t Max{std::numeric_limits<uint64_t>::max()};
+
+    /*!
+     * Returns the upper bound of the bucket of \p v, which is the p50 of
+     * \p v and a larger value.
+     */
+    static uint64_t upperBound(uint64_t v) {
+        LatencyHistogram h;
+        h.record(v);
+        h.record(Max);
+        return h.percentile(0.5);
+    }
+
+    // The percentile is within the relative error of the bucket
+    static void expectNear(uint64_t actual, uint64_t expected) {
+        EXPECT_GE(actual, expected);
+        EXPECT_LE(actual, expected + expected / 32);
+    }
+};
+
+TEST_F(LatencyHistogramTests, Empty) {
+    LatencyHistogram h;
+
+    EXPECT_FALSE(h);
+    EXPECT_EQ(h.count(), 0u);
+    EXPECT_EQ(h.min(), 0u);
+    EXPECT_EQ(h.max(), 0u);
+    EXPECT_EQ(h.mean(), 0u);
+    EXPECT_EQ(h.percentile(0.5), 0u);
+    EXPECT_EQ(h.percentile(0.99), 0u);
+}
+
+TEST_F(LatencyHistogramTests, ExactSmallValues) {
+    for (uint64_t v = 0; v < 32; ++v)
+        EXPECT_EQ(upperBound(v), v);
+}
+
+TEST_F(LatencyHistogramTests, PowerOfTwoEdges) {
+    EXPECT_EQ(upperBound(32), 32u);
+    EXPECT_EQ(upperBound(63), 63u);
+    EXPECT_EQ(upperBound(64), 65u);
+    EXPECT_EQ(upperBound(65), 65u);
+    EXPECT_EQ(upperBound(66), 67u);
+    EXPECT_EQ(upperBound(127), 127u);
+    EXPECT_EQ(upperBound(128), 131u);
+
+    for (unsigned e = 6; e < 63; ++e) {
+        auto low = uint64_t{1} << e;
+        auto width = uint64_t{1} << (e - 5);
+        EXPECT_EQ(upperBound(low - 1), low - 1) << "2^" << e << " - 1";
+        EXPECT_EQ(upperBound(low), low + width - 1) << "2^" << e;
+        EXPECT_EQ(upperBound(low + width), low + 2 * width - 1) << "2^" << e << " + width";
+    }
+}
+
+TEST_F(LatencyHistogramTests, TopBucket) {
+    // The upper bound of the last bucket wraps around to the maximum
+    EXPECT_EQ(upperBound(uint64_t{1} << 63u), (uint64_t{1} << 63u) + (uint64_t{1} << 58u) - 1);
+    EXPECT_EQ(upperBound(Max - (uint64_t{1} << 58u) + 1), Max);
+    EXPECT_EQ(upperBound(Max), Max);
+
+    LatencyHistogram h;
+    h.record(Max);
+    EXPECT_EQ(h.count(), 1u);
+    EXPECT_EQ(h.min(), Max);
+    EXPECT_EQ(h.percentile(0.5), Max);
+    EXPECT_EQ(h.percentile(1.0), Max);
+}
+
+TEST_F(LatencyHistogramTests, Uniform) {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 1000; ++v)
+        h.record(v * 1000);
+
+    EXPECT_EQ(h.count(), 1000u);
+    EXPECT_EQ(h.min(), 1000u);
+    EXPECT_EQ(h.max(), 1'000'000u);
+    EXPECT_EQ(h.mean(), 500'500u);
+    expectNear(h.percentile(0.5), 500'000);
+    expectNear(h.percentile(0.99), 990'000);
+    EXPECT_EQ(h.percentile(1.0), 1'000'000u);
+    expectNear(h.percentile(0.0), 1000);
+}
+
+TEST_F(LatencyHistogramTests, LongTail) {
+    // 98% of the values are 10us, 2% are 5ms
+    LatencyHistogram h;
+    for (unsigned i = 0; i < 980; ++i)
+        h.record(10'000);
+    for (unsigned i = 0; i < 20; ++i)
+        h.record(5'000'000);
+
+    expectNear(h.percentile(0.5), 10'000);
+    expectNear(h.percentile(0.97), 10'000);
+    // The percentiles are clamped to the exact maximum
+    EXPECT_EQ(h.percentile(0.99), 5'000'000u);
+    EXPECT_EQ(h.max(), 5'000'000u);
+}
+
+TEST_F(LatencyHistogramTests, Merge) {
+    LatencyHistogram all;
+    LatencyHistogram odd;
+    LatencyHistogram even;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        all.record(v * 100);
+        (v % 2 == 1 ? odd : even).record(v * 100);
+    }
+
+    odd.merge(even);
+    EXPECT_EQ(odd.count(), all.count());
+    EXPECT_EQ(odd.min(), all.min());
+    EXPECT_EQ(odd.max(), all.max());
+    EXPECT_EQ(odd.mean(), all.mean());
+    for (auto p: {0.0, 0.25, 0.5, 0.9, 0.99, 0.999, 1.0})
+        EXPECT_EQ(odd.percentile(p), all.percentile(p)) << p;
+}
+
+TEST_F(LatencyHistogramTests, MergeEmpty) {
+    LatencyHistogram h;
+    h.record(100);
+    h.record(200);
+
+    h.merge(LatencyHistogram{});
+    EXPECT_EQ(h.count(), 2u);
+    EXPECT_EQ(h.min(), 100u);
+    EXPECT_EQ(h.max(), 200u);
+
+    LatencyHistogram empty;
+    empty.merge(h);
+    EXPECT_EQ(empty.count(), 2u);
+    EXPECT_EQ(empty.min(), 100u);
+    EXPECT_EQ(empty.max(), 200u);
+    expectNear(empty.percentile(0.5), 100);
+}
+
+} // namespace pimc::testing
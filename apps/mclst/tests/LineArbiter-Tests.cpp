@@ -0,0 +1,185 @@
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "../LineArbiter.hpp"
+
+namespace pimc::testing {
+
+class LineArbiterTests: public ::testing::Test {
+protected:
+    static constexpr unsigned IfIndexA{2};
+    static constexpr unsigned IfIndexB{3};
+    // The sequence numbers of the mclst beacons
+    static constexpr SeqField Beacons{
+        .offset = 0, .size = 0, .littleEndian = false,
+        .magicOffset = 0, .magicSize = 0, .magic = {}};
+
+    LineArbiterTests(): arbiter_{IfIndexA, IfIndexB, Beacons} {}
+
+    void packet(unsigned ifIndex, uint64_t seq, uint64_t timestamp) {
+        PacketInfo pktInfo{};
+        pktInfo.reset();
+        pktInfo.timestamp = timestamp;
+        pktInfo.group = IPv4Address{239, 1, 1, 1};
+        pktInfo.dport = 5000;
+        pktInfo.ifIndex = ifIndex;
+        pktInfo.mclstBeacon = true;
+        pktInfo.remoteSeq = seq;
+        arbiter_.onPacket(pktInfo);
+    }
+
+    // Both lines receive the sequence numbers in order, A ahead of B by
+    // the delay
+    void both(uint64_t first, uint64_t last, uint64_t delay = 100) {
+        for (auto seq = first; seq <= last; ++seq) {
+            packet(IfIndexA, seq, seq * 1000);
+            packet(IfIndexB, seq, seq * 1000 + delay);
+        }
+    }
+
+    [[nodiscard]]
+    LineFlowStats flow() const {
+        auto ls = arbiter_.stats();
+        EXPECT_EQ(ls.flows.size(), 1u);
+        return *ls.flows.begin();
+    }
+
+    LineArbiter arbiter_;
+};
+
+TEST_F(LineArbiterTests, Winners) {
+    // The odd packets arrive on A first, the even ones on B first
+    for (uint64_t seq = 1; seq <= 10; ++seq) {
+        auto first = seq % 2 == 1 ? IfIndexA : IfIndexB;
+        auto second = seq % 2 == 1 ? IfIndexB : IfIndexA;
+        packet(first, seq, seq * 1000);
+        packet(second, seq, seq * 1000 + 50);
+    }
+
+    auto fs = flow();
+    EXPECT_EQ(fs.seqs, 10u);
+    EXPECT_EQ(fs.merged, 10u);
+    EXPECT_EQ(fs.received[0], 10u);
+    EXPECT_EQ(fs.received[1], 10u);
+    EXPECT_EQ(fs.won[0], 5u);
+    EXPECT_EQ(fs.won[1], 5u);
+    EXPECT_EQ(fs.duplicates[0], 0u);
+    EXPECT_EQ(fs.duplicates[1], 0u);
+    EXPECT_EQ(fs.restarts, 0u);
+}
+
+TEST_F(LineArbiterTests, LossOfOneLine) {
+    both(1, 10);
+    // B misses 11 and 12, which A still delivers
+    packet(IfIndexA, 11, 11000);
+    packet(IfIndexA, 12, 12000);
+    both(13, 20);
+
+    auto fs = flow();
+    EXPECT_EQ(fs.seqs, 20u);
+    EXPECT_EQ(fs.merged, 20u);
+    EXPECT_EQ(fs.received[0], 20u);
+    EXPECT_EQ(fs.received[1], 18u);
+    EXPECT_EQ(fs.won[0], 20u);
+    EXPECT_EQ(fs.won[1], 0u);
+}
+
+TEST_F(LineArbiterTests, Duplicates) {
+    both(1, 10);
+    packet(IfIndexA, 10, 10500);
+    packet(IfIndexB, 5, 10600);
+    packet(IfIndexB, 6, 10700);
+
+    auto fs = flow();
+    EXPECT_EQ(fs.merged, 10u);
+    EXPECT_EQ(fs.received[0], 10u);
+    EXPECT_EQ(fs.received[1], 10u);
+    EXPECT_EQ(fs.duplicates[0], 1u);
+    EXPECT_EQ(fs.duplicates[1], 2u);
+}
+
+TEST_F(LineArbiterTests, Delays) {
+    both(1, 100, 250);
+    packet(IfIndexB, 101, 101000);
+    packet(IfIndexA, 101, 101000 + 40);
+
+    auto ls = arbiter_.stats();
+    EXPECT_EQ(ls.bAfterA.count(), 100u);
+    EXPECT_EQ(ls.bAfterA.min(), 250u);
+    EXPECT_EQ(ls.bAfterA.max(), 250u);
+    EXPECT_EQ(ls.aAfterB.count(), 1u);
+    EXPECT_EQ(ls.aAfterB.max(), 40u);
+}
+
+TEST_F(LineArbiterTests, OtherInterfaceIgnored) {
+    both(1, 10);
+    packet(IfIndexB + 1, 11, 11000);
+
+    auto fs = flow();
+    EXPECT_EQ(fs.seqs, 10u);
+    EXPECT_EQ(fs.merged, 10u);
+}
+
+TEST_F(LineArbiterTests, StrayOldPacketIgnored) {
+    both(1, 5000);
+    packet(IfIndexA, 10, 5000500);
+    both(5001, 5010);
+
+    auto fs = flow();
+    EXPECT_EQ(fs.seqs, 5010u);
+    EXPECT_EQ(fs.merged, 5010u);
+    EXPECT_EQ(fs.received[0], 5010u);
+    EXPECT_EQ(fs.duplicates[0], 0u);
+    EXPECT_EQ(fs.restarts, 0u);
+}
+
+TEST_F(LineArbiterTests, RestartOnOneLine) {
+    both(1, 5000);
+    // The first RestartRun - 1 old packets of A are ignored, the next one
+    // starts the window over
+    for (uint64_t seq = 1; seq <= 20; ++seq)
+        packet(IfIndexA, seq, 6'000'000 + seq * 1000);
+    for (uint64_t seq = 1; seq <= 20; ++seq)
+        packet(IfIndexB, seq, 6'000'000 + seq * 1000 + 100);
+
+    auto fs = flow();
+    EXPECT_EQ(fs.restarts, 1u);
+    EXPECT_EQ(fs.seqs, 5020u);
+    EXPECT_EQ(fs.merged, 5020u);
+    EXPECT_EQ(fs.received[0], 5013u);
+    EXPECT_EQ(fs.received[1], 5020u);
+    EXPECT_EQ(fs.duplicates[1], 0u);
+}
+
+TEST_F(LineArbiterTests, RestartOnBothLines) {
+    both(1, 5000);
+    // A single old packet on each line is enough
+    packet(IfIndexA, 1, 6'000'000);
+    packet(IfIndexB, 1, 6'000'100);
+    both(2, 10);
+
+    auto fs = flow();
+    EXPECT_EQ(fs.restarts, 1u);
+    EXPECT_EQ(fs.seqs, 5010u);
+    EXPECT_EQ(fs.merged, 5010u);
+    EXPECT_EQ(fs.received[0], 5009u);
+    EXPECT_EQ(fs.received[1], 5010u);
+    EXPECT_EQ(fs.won[1], 1u);
+}
+
+TEST_F(LineArbiterTests, InWindowPacketResetsRun) {
+    both(1, 5000);
+    // The old packets of A interleaved with the current ones are strays
+    for (uint64_t seq = 1; seq <= 20; ++seq) {
+        packet(IfIndexA, seq, 6'000'000 + seq * 1000);
+        packet(IfIndexA, 5000 + seq, 6'000'000 + seq * 1000 + 10);
+    }
+
+    auto fs = flow();
+    EXPECT_EQ(fs.restarts, 0u);
+    EXPECT_EQ(fs.seqs, 5020u);
+    EXPECT_EQ(fs.received[0], 5020u);
+}
+
+} // namespace pimc::testing
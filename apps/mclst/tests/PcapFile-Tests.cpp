@@ -0,0 +1,337 @@
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../PcapFile.hpp"
+
+namespace pimc::testing {
+
+class PcapFileTests: public ::testing::Test {
+protected:
+    static constexpr unsigned LinkEthernet{1};
+    static constexpr unsigned LinkRaw{101};
+    static constexpr unsigned LinkLinuxSll{113};
+    static constexpr unsigned LinkLinuxSll2{276};
+
+    /*!
+     * Builds the capture in memory in either byte order.
+     */
+    struct Capture final {
+        bool swapped;
+        std::vector<uint8_t> bytes{};
+
+        void u8(uint8_t v) { bytes.push_back(v); }
+
+        void u16(uint16_t v) {
+            if (swapped) v = __builtin_bswap16(v);
+            append(&v, sizeof(v));
+        }
+
+        void u32(uint32_t v) {
+            if (swapped) v = __builtin_bswap32(v);
+            append(&v, sizeof(v));
+        }
+
+        void data(std::vector<uint8_t> const& d) {
+            bytes.insert(bytes.end(), d.begin(), d.end());
+        }
+
+        void pad() {
+            while (bytes.size() % 4 != 0)
+                bytes.push_back(0);
+        }
+
+        void append(void const* p, std::size_t n) {
+            auto const* b = static_cast<uint8_t const*>(p);
+            bytes.insert(bytes.end(), b, b + n);
+        }
+    };
+
+    struct Read final {
+        std::vector<std::vector<uint8_t>> packets{};
+        std::vector<uint64_t> timestamps{};
+        uint64_t frames{0};
+        uint64_t skipped{0};
+        bool truncated{false};
+    };
+
+    void TearDown() override {
+        for (auto const& fn: fns_)
+            unlink(fn.c_str());
+    }
+
+    // A minimal IPv4 header whose last byte tells the packets apart
+    static std::vector<uint8_t> ipv4(uint8_t id) {
+        std::vector<uint8_t> pkt(20, 0);
+        pkt[0] = 0x45;
+        pkt[19] = id;
+        return pkt;
+    }
+
+    static std::vector<uint8_t> withHeader(
+            std::initializer_list<uint8_t> hdr, std::vector<uint8_t> const& pkt) {
+        std::vector<uint8_t> frame{hdr};
+        frame.insert(frame.end(), pkt.begin(), pkt.end());
+        return frame;
+    }
+
+    static Capture pcap(bool swapped, bool nanos, unsigned linkType) {
+        Capture c{.swapped = swapped};
+        c.u32(nanos ? 0xa1b23c4d : 0xa1b2c3d4);
+        c.u16(2);
+        c.u16(4);
+        c.u32(0);
+        c.u32(0);
+        c.u32(65535);
+        c.u32(linkType);
+        return c;
+    }
+
+    static void record(Capture& c, uint32_t sec, uint32_t frac,
+                       std::vector<uint8_t> const& frame) {
+        c.u32(sec);
+        c.u32(frac);
+        c.u32(static_cast<uint32_t>(frame.size()));
+        c.u32(static_cast<uint32_t>(frame.size()));
+        c.data(frame);
+    }
+
+    static Capture pcapng(bool swapped) {
+        Capture c{.swapped = swapped};
+        c.u32(0x0a0d0d0a);
+        c.u32(28);
+        c.u32(0x1a2b3c4d);
+        c.u16(1);
+        c.u16(0);
+        c.u32(0xffffffff);
+        c.u32(0xffffffff);
+        c.u32(28);
+        return c;
+    }
+
+    static void idb(Capture& c, unsigned linkType, uint8_t tsResol) {
+        c.u32(1);
+        c.u32(32);
+        c.u16(static_cast<uint16_t>(linkType));
+        c.u16(0);
+        c.u32(0);
+        // The if_tsresol option and the end of the options
+        c.u16(9);
+        c.u16(1);
+        c.u8(tsResol);
+        c.pad();
+        c.u32(0);
+        c.u32(32);
+    }
+
+    static void epb(Capture& c, uint32_t intf, uint64_t ticks,
+                    std::vector<uint8_t> const& frame) {
+        auto len = static_cast<uint32_t>(32 + ((frame.size() + 3) & ~std::size_t{3}));
+        c.u32(6);
+        c.u32(len);
+        c.u32(intf);
+        c.u32(static_cast<uint32_t>(ticks >> 32u));
+        c.u32(static_cast<uint32_t>(ticks));
+        c.u32(static_cast<uint32_t>(frame.size()));
+        c.u32(static_cast<uint32_t>(frame.size()));
+        c.data(frame);
+        c.pad();
+        c.u32(len);
+    }
+
+    Read read(std::vector<uint8_t> const& bytes) {
+        std::string fn{"/tmp/PcapFile-Tests.XXXXXX"};
+        int fd = mkstemp(fn.data());
+        if (fd == -1) {
+            ADD_FAILURE() << "unable to create a temporary file";
+            return {};
+        }
+        fns_.push_back(fn);
+
+        auto written = write(fd, bytes.data(), bytes.size());
+        close(fd);
+        EXPECT_EQ(written, static_cast<ssize_t>(bytes.size()));
+
+        Read r{};
+        PcapFile pf{fn};
+        pf.forEach([&r] (PcapFile::Frame const& f) {
+            r.packets.emplace_back(f.data, f.data + f.size);
+            r.timestamps.push_back(f.timestamp);
+            return false;
+        });
+        r.frames = pf.frames();
+        r.skipped = pf.skipped();
+        r.truncated = pf.truncated();
+        return r;
+    }
+
+private:
+    std::vector<std::string> fns_;
+};
+
+TEST_F(PcapFileTests, PcapMicroseconds) {
+    auto c = pcap(false, false, LinkRaw);
+    record(c, 10, 123456, ipv4(1));
+    record(c, 11, 999999, ipv4(2));
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 2u);
+    EXPECT_EQ(r.packets[0], ipv4(1));
+    EXPECT_EQ(r.packets[1], ipv4(2));
+    EXPECT_EQ(r.timestamps[0], 10'123'456'000u);
+    EXPECT_EQ(r.timestamps[1], 11'999'999'000u);
+    EXPECT_EQ(r.frames, 2u);
+    EXPECT_EQ(r.skipped, 0u);
+    EXPECT_FALSE(r.truncated);
+}
+
+TEST_F(PcapFileTests, PcapNanosecondsSwapped) {
+    auto c = pcap(true, true, LinkRaw);
+    record(c, 10, 123456789, ipv4(1));
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 1u);
+    EXPECT_EQ(r.packets[0], ipv4(1));
+    EXPECT_EQ(r.timestamps[0], 10'123'456'789u);
+    EXPECT_FALSE(r.truncated);
+}
+
+TEST_F(PcapFileTests, EthernetVlanTags) {
+    auto c = pcap(false, false, LinkEthernet);
+    std::initializer_list<uint8_t> const macs{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    std::vector<uint8_t> frame{macs};
+    // The 802.1ad and 802.1Q tags
+    frame.insert(frame.end(), {0x88, 0xa8, 0x00, 0x64, 0x81, 0x00, 0x00, 0xc8, 0x08, 0x00});
+    auto pkt = ipv4(1);
+    frame.insert(frame.end(), pkt.begin(), pkt.end());
+    record(c, 1, 0, frame);
+
+    std::vector<uint8_t> arp{macs};
+    arp.insert(arp.end(), {0x08, 0x06, 0, 0, 0, 0});
+    record(c, 2, 0, arp);
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 1u);
+    EXPECT_EQ(r.packets[0], ipv4(1));
+    EXPECT_EQ(r.frames, 2u);
+    EXPECT_EQ(r.skipped, 1u);
+}
+
+TEST_F(PcapFileTests, LinuxCooked) {
+    auto c = pcap(false, false, LinkLinuxSll);
+    record(c, 1, 0, withHeader(
+            {0, 0, 0, 1, 0, 6, 0, 1, 2, 3, 4, 5, 0, 0, 0x08, 0x00}, ipv4(1)));
+    record(c, 2, 0, withHeader(
+            {0, 0, 0, 1, 0, 6, 0, 1, 2, 3, 4, 5, 0, 0, 0x86, 0xdd}, ipv4(2)));
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 1u);
+    EXPECT_EQ(r.packets[0], ipv4(1));
+    EXPECT_EQ(r.skipped, 1u);
+
+    auto c2 = pcap(false, false, LinkLinuxSll2);
+    record(c2, 1, 0, withHeader(
+            {0x08, 0x00, 0, 0, 0, 0, 0, 2, 0, 1, 0, 6, 0, 1, 2, 3, 4, 5, 0, 0}, ipv4(3)));
+
+    auto r2 = read(c2.bytes);
+    ASSERT_EQ(r2.packets.size(), 1u);
+    EXPECT_EQ(r2.packets[0], ipv4(3));
+}
+
+TEST_F(PcapFileTests, RawSkipsNonIPv4) {
+    auto c = pcap(false, false, LinkRaw);
+    auto v6 = ipv4(1);
+    v6[0] = 0x60;
+    record(c, 1, 0, v6);
+    record(c, 2, 0, ipv4(2));
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 1u);
+    EXPECT_EQ(r.packets[0], ipv4(2));
+    EXPECT_EQ(r.frames, 2u);
+    EXPECT_EQ(r.skipped, 1u);
+}
+
+TEST_F(PcapFileTests, TruncatedLastRecord) {
+    auto c = pcap(false, false, LinkRaw);
+    record(c, 1, 0, ipv4(1));
+    record(c, 2, 0, ipv4(2));
+    c.bytes.resize(c.bytes.size() - 5);
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 1u);
+    EXPECT_EQ(r.packets[0], ipv4(1));
+    EXPECT_TRUE(r.truncated);
+
+    // The file ends in the middle of the record header
+    auto c2 = pcap(false, false, LinkRaw);
+    record(c2, 1, 0, ipv4(1));
+    c2.u32(2);
+
+    auto r2 = read(c2.bytes);
+    EXPECT_EQ(r2.packets.size(), 1u);
+    EXPECT_TRUE(r2.truncated);
+}
+
+TEST_F(PcapFileTests, PcapngResolutions) {
+    auto c = pcapng(false);
+    // The default microseconds, the nanoseconds and the picoseconds
+    idb(c, LinkRaw, 6);
+    idb(c, LinkRaw, 9);
+    idb(c, LinkRaw, 12);
+    epb(c, 0, 10'123'456ul, ipv4(1));
+    epb(c, 1, 10'123'456'789ul, ipv4(2));
+    epb(c, 2, 10'123'456'789'400ul, ipv4(3));
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 3u);
+    EXPECT_EQ(r.packets[0], ipv4(1));
+    EXPECT_EQ(r.packets[1], ipv4(2));
+    EXPECT_EQ(r.packets[2], ipv4(3));
+    EXPECT_EQ(r.timestamps[0], 10'123'456'000u);
+    EXPECT_EQ(r.timestamps[1], 10'123'456'789u);
+    EXPECT_EQ(r.timestamps[2], 10'123'456'789u);
+    EXPECT_FALSE(r.truncated);
+}
+
+TEST_F(PcapFileTests, PcapngSwappedSections) {
+    // The second section is in the other byte order and has its own
+    // interfaces
+    auto c = pcapng(false);
+    idb(c, LinkRaw, 9);
+    epb(c, 0, 1'000'000'001ul, ipv4(1));
+
+    auto c2 = pcapng(true);
+    idb(c2, LinkLinuxSll2, 6);
+    epb(c2, 0, 2'000'001ul, withHeader(
+            {0x08, 0x00, 0, 0, 0, 0, 0, 2, 0, 1, 0, 6, 0, 1, 2, 3, 4, 5, 0, 0}, ipv4(2)));
+    c.data(c2.bytes);
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 2u);
+    EXPECT_EQ(r.packets[0], ipv4(1));
+    EXPECT_EQ(r.packets[1], ipv4(2));
+    EXPECT_EQ(r.timestamps[0], 1'000'000'001u);
+    EXPECT_EQ(r.timestamps[1], 2'000'001'000u);
+}
+
+TEST_F(PcapFileTests, PcapngTruncatedLastBlock) {
+    auto c = pcapng(false);
+    idb(c, LinkRaw, 9);
+    epb(c, 0, 1, ipv4(1));
+    epb(c, 0, 2, ipv4(2));
+    c.bytes.resize(c.bytes.size() - 8);
+
+    auto r = read(c.bytes);
+    ASSERT_EQ(r.packets.size(), 1u);
+    EXPECT_EQ(r.packets[0], ipv4(1));
+    EXPECT_TRUE(r.truncated);
+}
+
+} // namespace pimc::testing
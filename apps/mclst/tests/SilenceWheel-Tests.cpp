@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../SilenceWheel.hpp"
+
+namespace pimc::testing {
+
+class SilenceWheelTests: public ::testing::Test {
+protected:
+    static constexpr uint64_t Ms{1'000'000};
+    static constexpr uint64_t Threshold{80 * Ms};
+    // An eighth of the threshold
+    static constexpr uint64_t Tick{10 * Ms};
+    static constexpr uint64_t Start{1'000 * Ms};
+
+    SilenceWheelTests(): wheel_{Threshold, Start}, now_{Start} {}
+
+    static FlowKey key(unsigned n) {
+        return FlowKey{
+            .group = IPv4Address{239, 1, static_cast<uint8_t>(n >> 8u),
+                                 static_cast<uint8_t>(n)},
+            .source = IPv4Address{10, 0, 0, 1},
+            .sport = 4000,
+            .dport = 5000};
+    }
+
+    FlowStats& packet(unsigned n, uint64_t ns) {
+        auto fk = key(n);
+        auto& fs = rxStats_.update(fk.group, fk.source, fk.sport, fk.dport, 100);
+        wheel_.onPacket(fk, fs, ns, [this, ns] (FlowKey const& k, uint64_t outageNs) {
+            resumed_.push_back(Report{.key = k, .ns = outageNs, .at = ns});
+        });
+        return fs;
+    }
+
+    // Advances the time to ns in steps, of a millisecond by default
+    void advanceTo(uint64_t ns, uint64_t step = Ms) {
+        while (now_ < ns) {
+            now_ = std::min(now_ + step, ns);
+            advance();
+        }
+    }
+
+    void advance() {
+        wheel_.advance(now_, [this] (FlowKey const& k, uint64_t silentNs) {
+            silent_.push_back(Report{.key = k, .ns = silentNs, .at = now_});
+        });
+    }
+
+    [[nodiscard]]
+    std::map<FlowKey, unsigned> silentCounts() const {
+        std::map<FlowKey, unsigned> counts;
+        for (auto const& r: silent_)
+            ++counts[r.key];
+        return counts;
+    }
+
+    struct Report final {
+        FlowKey key;
+        uint64_t ns;
+        uint64_t at;
+    };
+
+    SilenceWheel wheel_;
+    RxStats rxStats_;
+    uint64_t now_;
+    std::vector<Report> silent_;
+    std::vector<Report> resumed_;
+};
+
+TEST_F(SilenceWheelTests, ReportedWithinThresholdPlusTick) {
+    auto heard = Start + 3 * Ms;
+    advanceTo(heard);
+    packet(1, heard);
+
+    advanceTo(heard + Threshold - Ms);
+    EXPECT_TRUE(silent_.empty());
+
+    advanceTo(heard + Threshold + Tick);
+    ASSERT_EQ(silent_.size(), 1u);
+    EXPECT_EQ(silent_[0].key, key(1));
+    EXPECT_GE(silent_[0].at, heard + Threshold);
+    EXPECT_LE(silent_[0].at, heard + Threshold + Tick);
+    EXPECT_EQ(silent_[0].ns, silent_[0].at - heard);
+}
+
+TEST_F(SilenceWheelTests, ReportedOnce) {
+    auto& fs = packet(1, Start);
+    advanceTo(Start + 100 * Threshold);
+
+    ASSERT_EQ(silent_.size(), 1u);
+    EXPECT_TRUE(fs.silent());
+    EXPECT_EQ(fs.outages(), 0u);
+
+    // The outage which has not ended is accounted at the end
+    wheel_.finish(rxStats_, now_);
+    EXPECT_EQ(fs.outages(), 1u);
+    EXPECT_EQ(fs.longestOutage(), 100 * Threshold);
+}
+
+TEST_F(SilenceWheelTests, PacketsKeepFlowAlive) {
+    for (auto ns = Start; ns < Start + 100 * Threshold; ns += Threshold / 2) {
+        advanceTo(ns);
+        packet(1, ns);
+    }
+
+    EXPECT_TRUE(silent_.empty());
+    EXPECT_TRUE(resumed_.empty());
+}
+
+TEST_F(SilenceWheelTests, ResumesWithOutage) {
+    auto& fs = packet(1, Start);
+    advanceTo(Start + 5 * Threshold);
+    ASSERT_EQ(silent_.size(), 1u);
+
+    auto back = Start + 5 * Threshold + 7 * Ms;
+    packet(1, back);
+    ASSERT_EQ(resumed_.size(), 1u);
+    EXPECT_EQ(resumed_[0].key, key(1));
+    EXPECT_EQ(resumed_[0].ns, back - Start);
+    EXPECT_FALSE(fs.silent());
+    EXPECT_EQ(fs.outages(), 1u);
+    EXPECT_EQ(fs.longestOutage(), back - Start);
+
+    // The resumed flow is tracked again
+    advanceTo(back + Threshold + Tick);
+    ASSERT_EQ(silent_.size(), 2u);
+    EXPECT_GE(silent_[1].at, back + Threshold);
+}
+
+TEST_F(SilenceWheelTests, JumpBeyondWheel) {
+    constexpr unsigned Flows{500};
+    for (unsigned n = 0; n < Flows; ++n)
+        packet(n, Start + n * 100'000);
+
+    // The first half of the flows is heard just before the jump of more
+    // than 256 ticks, which is taken at once
+    auto jump = Start + 300 * Tick;
+    for (unsigned n = 0; n < Flows / 2; ++n)
+        packet(n, jump - Ms);
+    now_ = jump;
+    advance();
+
+    auto counts = silentCounts();
+    EXPECT_EQ(counts.size(), Flows / 2);
+    for (unsigned n = Flows / 2; n < Flows; ++n)
+        EXPECT_EQ(counts[key(n)], 1u) << n;
+
+    advanceTo(jump + Threshold + Tick);
+    counts = silentCounts();
+    EXPECT_EQ(silent_.size(), Flows);
+    for (unsigned n = 0; n < Flows; ++n)
+        EXPECT_EQ(counts[key(n)], 1u) << n;
+
+    // Nothing is left in the wheel
+    advanceTo(jump + 1000 * Tick, Tick);
+    EXPECT_EQ(silent_.size(), Flows);
+}
+
+TEST_F(SilenceWheelTests, RepeatedJumps) {
+    constexpr unsigned Flows{100};
+    for (unsigned round = 0; round < 5; ++round) {
+        for (unsigned n = 0; n < Flows; ++n)
+            packet(n, now_ + n * Ms);
+        now_ += 1000 * Tick;
+        advance();
+        EXPECT_EQ(silent_.size(), (round + 1) * Flows);
+    }
+
+    auto counts = silentCounts();
+    for (unsigned n = 0; n < Flows; ++n)
+        EXPECT_EQ(counts[key(n)], 5u) << n;
+    EXPECT_EQ(resumed_.size(), 4 * Flows);
+}
+
+} // namespace pimc::testing
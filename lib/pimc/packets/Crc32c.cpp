@@ -0,0 +1,116 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "pimc/packets/Crc32c.hpp"
+
+namespace pimc {
+
+namespace {
+
+// The reflected CRC32C polynomial
+constexpr uint32_t Poly{0x82f63b78};
+
+using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+/*
+ * The tables of the slicing-by-8 algorithm: tables[0] is the classic
+ * byte-wise table, and tables[k][i] is the CRC of the byte i followed by
+ * k zero bytes.
+ */
+constexpr Tables makeTables() {
+    Tables tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; ++j)
+            crc = (crc >> 1u) ^ ((crc & 1u) ? Poly : 0u);
+        tables[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (std::size_t k = 1; k < 8; ++k)
+            tables[k][i] = (tables[k - 1][i] >> 8u) ^ tables[0][tables[k - 1][i] & 0xffu];
+    }
+
+    return tables;
+}
+
+constexpr Tables tables = makeTables();
+
+uint32_t crc32cSw(uint8_t const* p, std::size_t length, uint32_t crc) {
+    while (length >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, sizeof(lo));
+        memcpy(&hi, p + 4, sizeof(hi));
+        // The tables are indexed by the bytes in the little endian order
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= crc;
+        crc = tables[7][lo & 0xffu] ^ tables[6][(lo >> 8u) & 0xffu] ^
+              tables[5][(lo >> 16u) & 0xffu] ^ tables[4][lo >> 24u] ^
+              tables[3][hi & 0xffu] ^ tables[2][(hi >> 8u) & 0xffu] ^
+              tables[1][(hi >> 16u) & 0xffu] ^ tables[0][hi >> 24u];
+        p += 8;
+        length -= 8;
+    }
+
+    while (length-- > 0)
+        crc = (crc >> 8u) ^ tables[0][(crc ^ *p++) & 0xffu];
+
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+uint32_t crc32cHw(uint8_t const* p, std::size_t length, uint32_t crc) {
+    uint64_t crc64 = crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        length -= 8;
+    }
+
+    crc = static_cast<uint32_t>(crc64);
+    while (length-- > 0)
+        crc = _mm_crc32_u8(crc, *p++);
+
+    return crc;
+}
+#endif
+
+using Crc32cFn = uint32_t (*)(uint8_t const*, std::size_t, uint32_t);
+
+Crc32cFn selectCrc32c() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+        return crc32cHw;
+#endif
+    return crc32cSw;
+}
+
+Crc32cFn const crc32cImpl = selectCrc32c();
+
+} // anon.namespace
+
+uint32_t crc32c(void const* data, std::size_t length, uint32_t crc) {
+    return ~crc32cImpl(static_cast<uint8_t const*>(data), length, ~crc);
+}
+
+uint32_t crc32cPortable(void const* data, std::size_t length, uint32_t crc) {
+    return ~crc32cSw(static_cast<uint8_t const*>(data), length, ~crc);
+}
+
+bool crc32cAccelerated() {
+    return crc32cImpl != crc32cSw;
+}
+
+} // namespace pimc
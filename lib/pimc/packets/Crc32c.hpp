@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pimc {
+
+/**
+ * \brief Compute the CRC32C (Castagnoli) checksum of the data pointed to
+ * by \p data.
+ *
+ * The checksum is computed with the SSE4.2 `crc32` instructions if the
+ * CPU supports them, and with the portable table driven implementation
+ * otherwise. The checksum of the data split into several parts may be
+ * computed by passing the checksum of the preceding parts as \p crc.
+ *
+ * @param data a pointer to the data
+ * @param length the length of the data
+ * @param crc the checksum of the preceding data or 0
+ * @return the CRC32C checksum
+ */
+uint32_t crc32c(void const* data, std::size_t length, uint32_t crc = 0);
+
+/**
+ * \brief Compute the CRC32C checksum of the data pointed to by \p data
+ * with the portable table driven implementation.
+ *
+ * @see crc32c()
+ */
+uint32_t crc32cPortable(void const* data, std::size_t length, uint32_t crc = 0);
+
+/**
+ * @return true if crc32c() uses the CRC32C instructions of the CPU
+ */
+bool crc32cAccelerated();
+
+} // namespace pimc
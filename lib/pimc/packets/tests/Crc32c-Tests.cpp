@@ -0,0 +1,67 @@
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "pimc/packets/Crc32c.hpp"
+
+namespace pimc::testing {
+
+class Crc32cTests: public ::testing::Test {
+protected:
+};
+
+// The check values of RFC 3720, B.4
+TEST_F(Crc32cTests, KnownValues) {
+    char const* digits{"123456789"};
+    EXPECT_EQ(crc32c(digits, strlen(digits)), 0xe3069283u);
+    EXPECT_EQ(crc32cPortable(digits, strlen(digits)), 0xe3069283u);
+
+    std::vector<uint8_t> data(32, 0);
+    EXPECT_EQ(crc32c(data.data(), data.size()), 0x8a9136aau);
+    EXPECT_EQ(crc32cPortable(data.data(), data.size()), 0x8a9136aau);
+
+    std::fill(data.begin(), data.end(), 0xff);
+    EXPECT_EQ(crc32c(data.data(), data.size()), 0x62a8ab43u);
+    EXPECT_EQ(crc32cPortable(data.data(), data.size()), 0x62a8ab43u);
+
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i);
+    EXPECT_EQ(crc32c(data.data(), data.size()), 0x46dd794eu);
+    EXPECT_EQ(crc32cPortable(data.data(), data.size()), 0x46dd794eu);
+
+    EXPECT_EQ(crc32c(data.data(), 0), 0u);
+}
+
+TEST_F(Crc32cTests, Chained) {
+    std::vector<uint8_t> data(1000);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 31 + 7);
+
+    auto whole = crc32c(data.data(), data.size());
+    for (std::size_t split: {0ul, 1ul, 7ul, 8ul, 333ul, 999ul, 1000ul}) {
+        auto crc = crc32c(data.data(), split);
+        EXPECT_EQ(crc32c(data.data() + split, data.size() - split, crc), whole);
+    }
+}
+
+TEST_F(Crc32cTests, AcceleratedMatchesPortable) {
+    std::vector<uint8_t> data(4096 + 16);
+    uint32_t x{12345};
+    for (auto& b: data) {
+        x = x * 1103515245u + 12345u;
+        b = static_cast<uint8_t>(x >> 24u);
+    }
+
+    // All the alignments and the lengths of the tails
+    for (std::size_t offset = 0; offset < 16; ++offset) {
+        for (std::size_t length: {0ul, 1ul, 3ul, 8ul, 15ul, 64ul, 1500ul, 4096ul}) {
+            EXPECT_EQ(
+                    crc32c(data.data() + offset, length),
+                    crc32cPortable(data.data() + offset, length))
+                    << "offset " << offset << ", length " << length;
+        }
+    }
+}
+
+} // namespace pimc::testing